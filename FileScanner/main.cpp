@@ -44,7 +44,11 @@ void uploadFiles(const directory_entry& entry, bool mkdir) {
     }
 }
 
-int main() {
+/**
+ * @param argv[1] 可选。布局文件（如记录下来的启动时访问顺序）。
+ *                给出时，上传完毕后按其顺序整理映像。
+ */
+int main(int argc, char* argv[]) {
     cout << "f" << endl; // 格式化。
     cout << "k |kernel.bin|" << endl; // 写入内核文件。
     cout << "b |boot.bin|" << endl; // 写入 bootloader。
@@ -57,6 +61,12 @@ int main() {
 
     uploadFiles(directory_entry(root), false);
 
+    if (argc > 1) {
+        // 按布局文件排列 inode、目录与文件。
+        cout << "o |layout| |" << absolute(path(argv[1])).string() << "|" << endl;
+        cout << "d" << endl;
+    }
+
     cout << "x" << endl; // 退出。
     return 0;
 }
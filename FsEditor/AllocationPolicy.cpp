@@ -0,0 +1,180 @@
+/*
+ * 盘块与 inode 分配策略 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include "./AllocationPolicy.h"
+#include "./FileSystemAdapter.h"
+#include "./SidecarCache.h"
+#include "./MachineProps.h"
+
+using namespace std;
+
+AllocationPolicy* AllocationPolicy::create(const string& name) {
+    if (name == "first-fit") {
+        return new FirstFitPolicy;
+    } else if (name == "locality") {
+        return new LocalityPolicy;
+    } else if (name == "pack") {
+        return new PackPolicy;
+    }
+
+    return nullptr;
+}
+
+void AllocationPolicy::build(FileSystemAdapter& adapter) {
+    zoneBegin = adapter.superBlock.data_zone_begin;
+    zoneEnd = adapter.superBlock.data_zone_begin + adapter.superBlock.data_zone_blocks;
+    freeMap.assign(MachineProps::diskBlocks(), false);
+    freeCount = 0;
+
+    // 附属缓存中有现成的空闲位图。
+    SidecarCache* cache = adapter.warmCache();
+    if (cache != nullptr) {
+        for (int idx = zoneBegin; idx < zoneEnd && idx < (int) freeMap.size(); idx++) {
+            if (cache->isBlockFree(idx)) {
+                freeMap[idx] = true;
+                freeCount++;
+            }
+        }
+
+        return;
+    }
+
+    // s_nfree 为 0 时，链接块不会被标记为在用。
+    vector<bool> live;
+    uint32_t nfree = adapter.superBlock.s_nfree;
+    adapter.superBlock.s_nfree = 0;
+    adapter.markLiveBlocks(live);
+    adapter.superBlock.s_nfree = nfree;
+
+    for (int idx = zoneBegin; idx < zoneEnd && idx < (int) live.size(); idx++) {
+        if (!live[idx]) {
+            freeMap[idx] = true;
+            freeCount++;
+        }
+    }
+}
+
+int AllocationPolicy::allocateBlock(FileSystemAdapter& adapter, const AllocationContext& context) {
+    if (freeCount == 0) {
+        return -1;
+    }
+
+    int blockIdx = pickBlock(adapter, context);
+    if (!isFree(blockIdx)) {
+        return -1;
+    }
+
+    freeMap[blockIdx] = false;
+    freeCount--;
+    return blockIdx;
+}
+
+void AllocationPolicy::releaseBlock(int blockIdx) {
+    if (blockIdx >= zoneBegin && blockIdx < zoneEnd && !freeMap[blockIdx]) {
+        freeMap[blockIdx] = true;
+        freeCount++;
+    }
+}
+
+int AllocationPolicy::pickInode(FileSystemAdapter& adapter, const AllocationContext&) {
+    const int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    for (int idx = adapter.ROOT_INODE_IDX + 1; idx < inodeCount; idx++) {
+        if (adapter.inodes[idx].ialloc == 0) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+int AllocationPolicy::findRun(int from, int length) const {
+    if (from < zoneBegin || from >= zoneEnd) {
+        from = zoneBegin;
+    }
+
+    // 两趟：[from, zoneEnd) 与 [zoneBegin, from)。
+    for (int pass = 0; pass < 2; pass++) {
+        int begin = pass == 0 ? from : zoneBegin;
+        int end = pass == 0 ? zoneEnd : from;
+
+        int runBegin = -1;
+        for (int idx = begin; idx < end; idx++) {
+            if (!freeMap[idx]) {
+                runBegin = -1;
+                continue;
+            }
+
+            if (runBegin < 0) {
+                runBegin = idx;
+            }
+
+            if (idx - runBegin + 1 >= length) {
+                return runBegin;
+            }
+        }
+    }
+
+    return -1;
+}
+
+int AllocationPolicy::nextFree(int from) const {
+    return findRun(from, 1);
+}
+
+int FirstFitPolicy::pickBlock(FileSystemAdapter&, const AllocationContext& context) {
+    if (isFree(context.goal)) {
+        return context.goal; // 接着上一块。
+    }
+
+    int blockIdx = findRun(zoneBegin, context.blocksWanted);
+    return blockIdx >= 0 ? blockIdx : nextFree(zoneBegin);
+}
+
+int LocalityPolicy::pickBlock(FileSystemAdapter& adapter, const AllocationContext& context) {
+    if (isFree(context.goal)) {
+        return context.goal;
+    }
+
+    // 从所在目录的第一个盘块往后找。目录本身没有盘块时，从目录 inode 在 inode 区中的相对位置估计。
+    const int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    int target = zoneBegin;
+    if (context.parentIno > 0 && context.parentIno < inodeCount) {
+        int dirBlockIdx = adapter.inodes[context.parentIno].direct_index[0];
+        if (dirBlockIdx >= zoneBegin && dirBlockIdx < zoneEnd) {
+            target = dirBlockIdx;
+        } else {
+            target = zoneBegin + 1LL * (zoneEnd - zoneBegin) * context.parentIno / inodeCount;
+        }
+    }
+
+    int blockIdx = findRun(target, context.blocksWanted);
+    return blockIdx >= 0 ? blockIdx : nextFree(target);
+}
+
+int LocalityPolicy::pickInode(FileSystemAdapter& adapter, const AllocationContext& context) {
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    int from = context.parentIno > adapter.ROOT_INODE_IDX && context.parentIno < inodeCount 
+        ? context.parentIno + 1 
+        : adapter.ROOT_INODE_IDX + 1;
+
+    for (int step = 0; step < inodeCount; step++) {
+        int idx = from + step;
+        if (idx >= inodeCount) {
+            idx -= inodeCount - adapter.ROOT_INODE_IDX - 1;
+        }
+
+        if (idx > adapter.ROOT_INODE_IDX && idx < inodeCount && adapter.inodes[idx].ialloc == 0) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+int PackPolicy::pickBlock(FileSystemAdapter&, const AllocationContext&) {
+    cursor = nextFree(cursor);
+    return cursor++;
+}
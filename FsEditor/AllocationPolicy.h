@@ -0,0 +1,172 @@
+/*
+ * 盘块与 inode 分配策略 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include "./MachineProps.h"
+
+/**
+ * 分配时的上下文。由适配器在写文件、建文件时填写。
+ */
+class AllocationContext {
+public:
+    /** 正在写入的文件的 inode 号。0 表示未知。 */
+    int ino = 0;
+
+    /** 所在目录的 inode 号。0 表示未知。 */
+    int parentIno = 0;
+
+    /** 希望分配到的盘块：通常是本文件上一次分配到的盘块的下一块。0 表示没有。 */
+    int goal = 0;
+
+    /** 本文件还需要的盘块数（估计值，至少为 1）。 */
+    int blocksWanted = 1;
+
+public:
+    /**
+     * 存放指定大小的文件需要的盘块数，含索引块。至少为 1。
+     */
+    static inline int blocksForFileSize(long long filesize) {
+        const int blockSize = MachineProps::BLOCK_SIZE;
+        const int entriesPerIdxBlock = blockSize / sizeof(uint32_t);
+
+        long long dataBlocks = (filesize + blockSize - 1) / blockSize;
+        long long idxBlocks = 0;
+        if (dataBlocks > 6) { // 一级索引块。
+            idxBlocks += (dataBlocks - 6 + entriesPerIdxBlock - 1) / entriesPerIdxBlock;
+        }
+
+        if (dataBlocks > 6 + 2 * entriesPerIdxBlock) { // 二级索引块。
+            idxBlocks += (dataBlocks - 6 - 2 * entriesPerIdxBlock + entriesPerIdxBlock * entriesPerIdxBlock - 1) 
+                / (entriesPerIdxBlock * entriesPerIdxBlock);
+        }
+
+        return std::max(1LL, dataBlocks + idxBlocks);
+    }
+};
+
+/**
+ * 分配策略。
+ * 
+ * 默认情况下（不设置策略），适配器按 V6++ 的方式从 s_free 栈顶取盘块。
+ * 设置策略后，空闲盘块由策略内的位图管理，s_free 与空闲盘块链在 sync 时按升序重新生成，
+ * 因此内核看到的始终是一份有效的空闲表。
+ */
+class AllocationPolicy {
+public:
+    virtual ~AllocationPolicy() {}
+
+    /**
+     * 创建策略。
+     * 
+     * @param name first-fit、locality 或 pack。
+     * @return 策略对象。名字无效时返回 nullptr。
+     */
+    static AllocationPolicy* create(const std::string& name);
+
+    /** 策略名。 */
+    virtual const char* name() const = 0;
+
+    /**
+     * 按文件系统当前状态重建空闲位图。
+     * 空闲盘块链上的链接块同样视为空闲：策略生效期间以位图为准，磁盘上的空闲表在 sync 时重新生成。
+     */
+    void build(class FileSystemAdapter& adapter);
+
+    /**
+     * 分配一个盘块。
+     * 
+     * @return 盘块号。-1 表示盘满。
+     */
+    int allocateBlock(class FileSystemAdapter& adapter, const AllocationContext& context);
+
+    /** 释放一个盘块。 */
+    void releaseBlock(int blockIdx);
+
+    /**
+     * 选择一个空闲 inode。默认取编号最小的。
+     * 
+     * @return inode 号。-1 表示没有空闲 inode。
+     */
+    virtual int pickInode(class FileSystemAdapter& adapter, const AllocationContext& context);
+
+    /** 位图中的空闲盘块数。策略生效期间磁盘上的空闲表要到 sync 才更新，以它为准。 */
+    inline int freeBlocks() const {
+        return freeCount;
+    }
+
+protected:
+    /**
+     * 选择一个空闲盘块。调用时保证至少有一个空闲盘块。
+     */
+    virtual int pickBlock(class FileSystemAdapter& adapter, const AllocationContext& context) = 0;
+
+    inline bool isFree(int blockIdx) const {
+        return blockIdx >= zoneBegin && blockIdx < zoneEnd && freeMap[blockIdx];
+    }
+
+    /**
+     * 从 from 开始向后寻找第一段长度不小于 length 的连续空闲盘块，到末尾后从头绕回。
+     * 
+     * @return 起始盘块号。找不到时返回 -1。
+     */
+    int findRun(int from, int length) const;
+
+    /**
+     * 从 from 开始向后寻找第一个空闲盘块，到末尾后从头绕回。
+     */
+    int nextFree(int from) const;
+
+protected:
+    std::vector<bool> freeMap;
+    int zoneBegin = 0;
+    int zoneEnd = 0;
+    int freeCount = 0;
+};
+
+/**
+ * 首次适应：新文件放在第一段足够长的连续空闲区里，之后紧接着上一块继续分配。
+ */
+class FirstFitPolicy : public AllocationPolicy {
+public:
+    const char* name() const override { return "first-fit"; }
+
+protected:
+    int pickBlock(class FileSystemAdapter& adapter, const AllocationContext& context) override;
+};
+
+/**
+ * 目录局部性：文件的盘块放在所在目录的盘块附近，inode 放在所在目录的 inode 之后。
+ */
+class LocalityPolicy : public AllocationPolicy {
+public:
+    const char* name() const override { return "locality"; }
+
+    int pickInode(class FileSystemAdapter& adapter, const AllocationContext& context) override;
+
+protected:
+    int pickBlock(class FileSystemAdapter& adapter, const AllocationContext& context) override;
+};
+
+/**
+ * 按写入顺序紧密排列：游标只向前走，跳过在用的盘块，不回头填补前面的空隙。
+ * 游标走到数据区末尾后才回到开头，使用前面的空隙，避免还有空闲盘块时分配失败。
+ * 适合构建映像：文件按写入顺序首尾相接。
+ */
+class PackPolicy : public AllocationPolicy {
+public:
+    const char* name() const override { return "pack"; }
+
+protected:
+    int pickBlock(class FileSystemAdapter& adapter, const AllocationContext& context) override;
+
+private:
+    int cursor = 0;
+};
@@ -0,0 +1,53 @@
+/*
+ * 按操作复用的内存区 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <cstdint>
+#include <algorithm>
+#include "./Arena.h"
+
+using namespace std;
+
+Arena::~Arena() {
+    for (Chunk& chunk : chunks) {
+        delete[] chunk.data;
+    }
+}
+
+Arena& Arena::local() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    while (current < chunks.size()) {
+        Chunk& chunk = chunks[current];
+        uintptr_t base = (uintptr_t) chunk.data;
+        size_t aligned = ((base + offset + align - 1) & ~(uintptr_t) (align - 1)) - base;
+        if (aligned + bytes <= chunk.capacity) {
+            offset = aligned + bytes;
+            return chunk.data + aligned;
+        }
+
+        // 当前块放不下，换到下一块（之前归还的块会被复用）。
+        current++;
+        offset = 0;
+    }
+
+    size_t capacity = max(MIN_CHUNK_BYTES, bytes + align);
+    chunks.push_back({ new char[capacity], capacity });
+    current = chunks.size() - 1;
+    offset = 0;
+    return allocate(bytes, align);
+}
+
+Arena::Marker Arena::mark() const {
+    return { current, offset };
+}
+
+void Arena::release(const Marker& marker) {
+    current = marker.chunk;
+    offset = marker.offset;
+}
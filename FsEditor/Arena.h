@@ -0,0 +1,83 @@
+/*
+ * 按操作复用的内存区 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * 线性分配的内存区。每个线程一个（Arena::local），在一次操作内分配，
+ * 通过 ArenaScope 在作用域结束时整体归还。内存块保留下来，供之后的操作复用，
+ * 因此递归删除、遍历等反复加载目录的操作不会频繁向堆申请和释放内存。
+ *
+ * 归还必须按栈的顺序：后开始的作用域先结束。
+ */
+class Arena {
+public:
+    /** 分配位置。用于归还。 */
+    struct Marker {
+        size_t chunk;
+        size_t offset;
+    };
+
+public:
+    ~Arena();
+
+    /** 当前线程的内存区。 */
+    static Arena& local();
+
+    /**
+     * 分配内存。内容未初始化。
+     *
+     * @param align 对齐，须为 2 的幂。
+     */
+    void* allocate(size_t bytes, size_t align = 32);
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return (T*) allocate(sizeof(T) * count, alignof(T) > 32 ? alignof(T) : 32);
+    }
+
+    Marker mark() const;
+
+    /** 归还 marker 之后分配的所有内存。 */
+    void release(const Marker& marker);
+
+private:
+    /** 最小的内存块大小。 */
+    static constexpr size_t MIN_CHUNK_BYTES = 64 * 1024;
+
+    struct Chunk {
+        char* data;
+        size_t capacity;
+    };
+
+    std::vector<Chunk> chunks;
+
+    /** 正在使用的内存块及其中已分配的字节数。 */
+    size_t current = 0;
+    size_t offset = 0;
+};
+
+/**
+ * 内存区作用域。析构时归还作用域内分配的内存。
+ */
+class ArenaScope {
+public:
+    inline ArenaScope(Arena& arena = Arena::local()) : arena(arena), marker(arena.mark()) {}
+
+    inline ~ArenaScope() {
+        arena.release(marker);
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator = (const ArenaScope&) = delete;
+
+private:
+    Arena& arena;
+    Arena::Marker marker;
+};
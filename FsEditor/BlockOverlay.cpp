@@ -0,0 +1,285 @@
+/*
+ * 写时复制覆盖层 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include "./BlockOverlay.h"
+#include "./structures/Block.h"
+
+using namespace std;
+
+BlockOverlay::BlockOverlay(const char* overlayPath, istream& base, int diskBlocks) {
+    this->diskBlocks = diskBlocks;
+    this->path = overlayPath;
+    this->baseChecksum = imageChecksum(base);
+
+    // 不存在则新建。
+    if (!filesystem::exists(overlayPath)) {
+        ofstream(overlayPath, ios::out | ios::binary);
+    }
+
+    fileStream.open(overlayPath, ios::in | ios::out | ios::binary);
+    if (!fileStream.is_open()) {
+        throw runtime_error("failed to open overlay file!");
+    }
+
+    fileStream.seekg(0, ios::end);
+    if (fileStream.tellg() == 0) {
+        flush(); // 新覆盖层：写入文件头。
+        return;
+    }
+
+    BlockOverlayHeader header;
+    if (!loadIndex(fileStream, header, blockOfSlot) || header.diskBlocks != diskBlocks) {
+        fileStream.close();
+        throw runtime_error("bad overlay file.");
+    }
+
+    if (header.baseChecksum != baseChecksum) {
+        fileStream.close();
+        throw runtime_error("overlay was made against a different base image.");
+    }
+
+    for (int slot = 0; slot < blockOfSlot.size(); slot++) {
+        slotOfBlock[blockOfSlot[slot]] = slot;
+    }
+}
+
+BlockOverlay::~BlockOverlay() {
+    if (fileStream.is_open()) {
+        flush();
+        fileStream.close();
+    }
+}
+
+bool BlockOverlay::loadIndex(fstream& f, BlockOverlayHeader& header, vector<uint32_t>& blockOfSlot) {
+    f.clear();
+    f.seekg(0, ios::beg);
+    f.read((char*) &header, sizeof(header));
+    if (f.gcount() != sizeof(header) 
+        || memcmp(header.magic, BlockOverlayHeader::MAGIC, sizeof(header.magic)) != 0
+        || header.blockSize != sizeof(Block)
+    ) {
+        return false;
+    }
+
+    if (header.slotCount > header.diskBlocks) {
+        return false;
+    }
+
+    blockOfSlot.resize(header.slotCount);
+    f.seekg(indexOffset(header.diskBlocks), ios::beg);
+    f.read((char*) blockOfSlot.data(), header.slotCount * sizeof(uint32_t));
+    if (f.gcount() != header.slotCount * sizeof(uint32_t)) {
+        return false;
+    }
+
+    for (uint32_t blockIdx : blockOfSlot) {
+        if (blockIdx >= header.diskBlocks) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint64_t BlockOverlay::imageChecksum(istream& image) {
+    const size_t bufferBytes = 1 << 20;
+    vector<uint64_t> buffer(bufferBytes / sizeof(uint64_t));
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    image.clear();
+    image.seekg(0, ios::beg);
+    while (image) {
+        image.read((char*) buffer.data(), bufferBytes);
+        size_t words = (image.gcount() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        if (image.gcount() % sizeof(uint64_t) != 0) {
+            buffer[words - 1] &= (1ULL << (image.gcount() % sizeof(uint64_t) * 8)) - 1;
+        }
+
+        for (size_t idx = 0; idx < words; idx++) {
+            hash = (hash ^ buffer[idx]) * 0x100000001b3ULL;
+        }
+    }
+
+    image.clear();
+    return hash;
+}
+
+void BlockOverlay::flush() {
+    lock_guard<std::mutex> lock(mutex);
+    BlockOverlayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BlockOverlayHeader::MAGIC, sizeof(header.magic));
+    header.blockSize = sizeof(Block);
+    header.diskBlocks = diskBlocks;
+    header.slotCount = blockOfSlot.size();
+    header.baseChecksum = baseChecksum;
+
+    // 先写对照表，再写文件头。
+    fileStream.clear();
+    fileStream.seekp(indexOffset(diskBlocks), ios::beg);
+    fileStream.write((const char*) blockOfSlot.data(), header.slotCount * sizeof(uint32_t));
+    fileStream.flush();
+    fileStream.seekp(0, ios::beg);
+    fileStream.write((const char*) &header, sizeof(header));
+    fileStream.flush();
+}
+
+bool BlockOverlay::readBlocks(
+    char* buffer, int blockIdx, int blockCount,
+    const function<bool (char* buffer, int blockIdx, int blockCount)>& baseReader
+) {
+    lock_guard<std::mutex> lock(mutex);
+    bool result = true;
+    int idx = 0;
+
+    while (idx < blockCount) {
+        auto it = slotOfBlock.find(blockIdx + idx);
+        int runBegin = idx;
+
+        if (it == slotOfBlock.end()) {
+            // 一段不在覆盖层中的盘块：一次从基础映像读取。
+            while (idx < blockCount && slotOfBlock.find(blockIdx + idx) == slotOfBlock.end()) {
+                idx++;
+            }
+
+            result &= baseReader(buffer + runBegin * sizeof(Block), blockIdx + runBegin, idx - runBegin);
+        } else {
+            // 一段槽位也连续的盘块：一次从覆盖层读取。
+            int slotBegin = it->second;
+            idx++;
+            while (idx < blockCount) {
+                auto next = slotOfBlock.find(blockIdx + idx);
+                if (next == slotOfBlock.end() || next->second != slotBegin + idx - runBegin) {
+                    break;
+                }
+
+                idx++;
+            }
+
+            int runBytes = (idx - runBegin) * sizeof(Block);
+            fileStream.clear();
+            fileStream.seekg((1LL + slotBegin) * sizeof(Block), ios::beg);
+            fileStream.read(buffer + runBegin * sizeof(Block), runBytes);
+            result &= fileStream.gcount() == runBytes;
+        }
+    }
+
+    return result;
+}
+
+bool BlockOverlay::writeBlocks(const char* buffer, int blockIdx, int blockCount) {
+    lock_guard<std::mutex> lock(mutex);
+    int idx = 0;
+
+    while (idx < blockCount) {
+        // 已有槽位原地覆盖，新盘块追加到末尾。连续的槽位合并成一次写入。
+        auto it = slotOfBlock.find(blockIdx + idx);
+        int slotBegin;
+        if (it != slotOfBlock.end()) {
+            slotBegin = it->second;
+        } else {
+            slotBegin = blockOfSlot.size();
+            slotOfBlock[blockIdx + idx] = slotBegin;
+            blockOfSlot.push_back(blockIdx + idx);
+        }
+
+        int runBegin = idx++;
+        while (idx < blockCount) {
+            int expectedSlot = slotBegin + idx - runBegin;
+            auto next = slotOfBlock.find(blockIdx + idx);
+            if (next != slotOfBlock.end()) {
+                if (next->second != expectedSlot) {
+                    break;
+                }
+            } else if (expectedSlot == blockOfSlot.size()) {
+                slotOfBlock[blockIdx + idx] = expectedSlot;
+                blockOfSlot.push_back(blockIdx + idx);
+            } else {
+                break;
+            }
+
+            idx++;
+        }
+
+        fileStream.clear();
+        fileStream.seekp((1LL + slotBegin) * sizeof(Block), ios::beg);
+        fileStream.write(buffer + runBegin * sizeof(Block), (idx - runBegin) * sizeof(Block));
+    }
+
+    return fileStream.good();
+}
+
+bool BlockOverlay::commit(const string& basePath, const string& overlayPath) {
+    fstream overlayFile(overlayPath, ios::in | ios::binary);
+    fstream baseFile(basePath, ios::in | ios::out | ios::binary);
+    if (!overlayFile.is_open() || !baseFile.is_open()) {
+        cout << "[error] 无法打开映像或覆盖层。" << endl;
+        return false;
+    }
+
+    BlockOverlayHeader header;
+    vector<uint32_t> blockOfSlot;
+    if (!loadIndex(overlayFile, header, blockOfSlot)) {
+        cout << "[error] 覆盖层格式错误。" << endl;
+        return false;
+    }
+
+    baseFile.seekg(0, ios::end);
+    if (baseFile.tellg() != 1LL * header.diskBlocks * sizeof(Block)) {
+        cout << "[error] 映像大小与覆盖层不符。" << endl;
+        return false;
+    }
+
+    if (imageChecksum(baseFile) != header.baseChecksum) {
+        cout << "[error] 映像不是创建覆盖层时的基础映像（或已写回过），拒绝写回。" << endl;
+        return false;
+    }
+
+    // 按盘块号排序，顺序写回。
+    vector<int> slots(blockOfSlot.size());
+    for (int slot = 0; slot < slots.size(); slot++) {
+        slots[slot] = slot;
+    }
+
+    sort(slots.begin(), slots.end(), [&] (int a, int b) {
+        return blockOfSlot[a] < blockOfSlot[b];
+    });
+
+    Block b;
+    for (int slot : slots) {
+        overlayFile.seekg((1LL + slot) * sizeof(Block), ios::beg);
+        overlayFile.read(b.asCharArray(), sizeof(b));
+        baseFile.seekp(1LL * blockOfSlot[slot] * sizeof(Block), ios::beg);
+        baseFile.write(b.asConstCharArray(), sizeof(b));
+    }
+
+    baseFile.flush();
+    if (!baseFile.good() || !overlayFile.good()) {
+        cout << "[error] 写回失败。" << endl;
+        return false;
+    }
+
+    cout << "[info] 已写回盘块：" << slots.size() << endl;
+    return true;
+}
+
+bool BlockOverlay::discard(const string& overlayPath) {
+    fstream overlayFile(overlayPath, ios::in | ios::binary);
+    BlockOverlayHeader header;
+    vector<uint32_t> blockOfSlot;
+    if (!overlayFile.is_open() || !loadIndex(overlayFile, header, blockOfSlot)) {
+        cout << "[error] 不是覆盖层文件：" << overlayPath << endl;
+        return false;
+    }
+
+    overlayFile.close();
+    return filesystem::remove(overlayPath);
+}
@@ -0,0 +1,141 @@
+/*
+ * 写时复制覆盖层 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <fstream>
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "./MacroDefines.h"
+#include "./MachineProps.h"
+
+/**
+ * 覆盖层文件头。占用覆盖层文件的第一个盘块。
+ */
+class BlockOverlayHeader {
+public:
+    static constexpr char MAGIC[8] = {'V', '6', 'P', 'P', 'O', 'V', 'L', '2'};
+
+public:
+    char magic[8];
+
+    /** 盘块尺寸（字节）。 */
+    uint32_t blockSize;
+
+    /** 基础映像盘块总数。 */
+    uint32_t diskBlocks;
+
+    /** 覆盖层中保存的盘块数。 */
+    uint32_t slotCount;
+
+    /** 创建覆盖层时基础映像的校验和。写回前核对，防止写到别的映像上。 */
+    uint64_t baseChecksum;
+
+    /** 空白填充。 */
+    uint8_t paddings[MachineProps::BLOCK_SIZE - 28];
+} __packed;
+
+/**
+ * 写时复制覆盖层。
+ * 
+ * 基础映像只读打开，写入的盘块全部保存在覆盖层文件里。读取时优先查覆盖层，
+ * 找不到再读基础映像。
+ * 
+ * 覆盖层文件格式：
+ *   盘块 0：BlockOverlayHeader。
+ *   盘块 1 ~ slotCount：各槽位保存的盘块内容。
+ *   盘块 1 + diskBlocks 起：slotCount 个 uint32_t，依次为每个槽位对应的基础映像盘块号。
+ * 每个盘块至多占一个槽位，槽位不会写到对照表上；两者之间是稀疏文件的空洞。
+ * 对照表只在 flush 时写出：先写对照表，再写文件头。已有槽位的对照关系不会改变，
+ * 因此中途崩溃时，文件头记录的槽位数与对照表总是一致的。
+ */
+class BlockOverlay {
+public:
+    /**
+     * 打开覆盖层文件。文件不存在或为空时新建。
+     * 
+     * @param overlayPath 覆盖层文件路径。
+     * @param base 基础映像。用于计算、核对校验和。
+     * @param diskBlocks 基础映像盘块总数。
+     * @exception runtime_error 文件打开失败，或者格式与基础映像不符。
+     */
+    BlockOverlay(const char* overlayPath, std::istream& base, int diskBlocks);
+
+    ~BlockOverlay();
+
+    /**
+     * 读取连续的盘块。
+     * 
+     * @param baseReader 读取基础映像中 [blockIdx, blockIdx + blockCount) 的盘块。
+     */
+    bool readBlocks(
+        char* buffer, int blockIdx, int blockCount,
+        const std::function<bool (char* buffer, int blockIdx, int blockCount)>& baseReader
+    );
+
+    /** 写入连续的盘块。已有的槽位原地覆盖，新盘块追加到槽位末尾。 */
+    bool writeBlocks(const char* buffer, int blockIdx, int blockCount);
+
+    /** 写出对照表和文件头。 */
+    void flush();
+
+    /** 覆盖层中保存的盘块数。 */
+    inline int size() const {
+        return blockOfSlot.size();
+    }
+
+    /**
+     * 将覆盖层中的盘块按盘块号顺序写回基础映像。
+     * 基础映像的校验和与创建覆盖层时不同时拒绝写回。
+     * 
+     * @return 是否成功。
+     */
+    static bool commit(const std::string& basePath, const std::string& overlayPath);
+
+    /**
+     * 丢弃覆盖层：确认文件确实是覆盖层后将其删除。
+     * 
+     * @return 是否成功。
+     */
+    static bool discard(const std::string& overlayPath);
+
+private:
+    /** 读取覆盖层文件头与对照表。 */
+    static bool loadIndex(
+        std::fstream& f, BlockOverlayHeader& header, std::vector<uint32_t>& blockOfSlot
+    );
+
+    /** 对照表在覆盖层文件中的位置（字节）。 */
+    static inline long long indexOffset(uint32_t diskBlocks) {
+        return (1LL + diskBlocks) * MachineProps::BLOCK_SIZE;
+    }
+
+    /** 映像内容的校验和（按 8 字节字计算的 FNV-1a）。 */
+    static uint64_t imageChecksum(std::istream& image);
+
+public:
+    std::fstream fileStream;
+
+    /** 覆盖层文件路径。 */
+    std::string path;
+
+    /** 盘块号 -> 槽位号。 */
+    std::unordered_map<int, int> slotOfBlock;
+
+    /** 保护对照表与文件流。读写可能来自多个线程。 */
+    std::mutex mutex;
+
+    /** 槽位号 -> 盘块号。 */
+    std::vector<uint32_t> blockOfSlot;
+
+    int diskBlocks;
+
+    uint64_t baseChecksum = 0;
+};
@@ -0,0 +1,82 @@
+/*
+ * 盘块归属反查表 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <fstream>
+#include <cstring>
+#include "./BlockOwnerMap.h"
+#include "./FileSystemAdapter.h"
+
+using namespace std;
+
+/** 附属文件头。 */
+static const char OWNER_MAP_MAGIC[8] = {'V', '6', 'P', 'P', 'O', 'W', 'N', '1'};
+
+BlockOwnerMap::BlockOwnerMap(int diskBlocks) : owners(diskBlocks) {
+    
+}
+
+void BlockOwnerMap::build(FileSystemAdapter& adapter) {
+    fill(owners.begin(), owners.end(), BlockOwner());
+
+    for (int ino = 0; ino < sizeof(adapter.inodes) / sizeof(Inode); ino++) {
+        Inode& inode = adapter.inodes[ino];
+        if (!inode.ialloc || inode.d_size == 0) {
+            continue;
+        }
+
+        adapter.iterateOverInodeDataBlocks(
+            inode,
+            [&] (int dataByteOffset, int blockIdx) {
+                this->set(blockIdx, ino, dataByteOffset / sizeof(Block));
+            },
+            [] (int prevBlockIdx) { return prevBlockIdx; },
+            [] (...) {},
+            [] (...) {},
+            [&] (const char*, int blockIndex) {
+                this->set(blockIndex, ino, BlockOwner::INDEX_BLOCK);
+            }
+        );
+    }
+}
+
+bool BlockOwnerMap::load(const string& path, uint64_t checksum) {
+    ifstream f(path, ios::in | ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+
+    char magic[8];
+    uint64_t savedChecksum;
+    uint32_t blockCount;
+    f.read(magic, sizeof(magic));
+    f.read((char*) &savedChecksum, sizeof(savedChecksum));
+    f.read((char*) &blockCount, sizeof(blockCount));
+
+    if (!f.good() 
+        || memcmp(magic, OWNER_MAP_MAGIC, sizeof(magic)) != 0 
+        || savedChecksum != checksum 
+        || blockCount != owners.size()
+    ) {
+        return false;
+    }
+
+    f.read((char*) owners.data(), owners.size() * sizeof(BlockOwner));
+    return f.gcount() == owners.size() * sizeof(BlockOwner);
+}
+
+bool BlockOwnerMap::save(const string& path, uint64_t checksum) const {
+    ofstream f(path, ios::out | ios::binary | ios::trunc);
+    if (!f.is_open()) {
+        return false;
+    }
+
+    uint32_t blockCount = owners.size();
+    f.write(OWNER_MAP_MAGIC, sizeof(OWNER_MAP_MAGIC));
+    f.write((const char*) &checksum, sizeof(checksum));
+    f.write((const char*) &blockCount, sizeof(blockCount));
+    f.write((const char*) owners.data(), owners.size() * sizeof(BlockOwner));
+    return f.good();
+}
@@ -0,0 +1,80 @@
+/*
+ * 盘块归属反查表 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "./MacroDefines.h"
+
+/**
+ * 盘块的归属。
+ */
+class BlockOwner {
+public:
+    /** 索引块的 fileBlock 取值。 */
+    static const int32_t INDEX_BLOCK = -1;
+
+public:
+    /** 所属文件的 inode 号。0 表示不属于任何文件。 */
+    uint32_t ino = 0;
+
+    /** 盘块在文件中的逻辑块号。索引块为 INDEX_BLOCK。 */
+    int32_t fileBlock = 0;
+} __packed;
+
+/**
+ * 盘块归属反查表：盘块号 -> (inode, 文件内逻辑块号)。
+ * 
+ * 开启后，适配器在遍历文件盘块时登记归属，在释放盘块时清除归属，因此表始终与文件系统一致。
+ * 表可以保存为映像旁的附属文件，下次打开时若校验值一致即可直接使用，无需重建。
+ */
+class BlockOwnerMap {
+public:
+    BlockOwnerMap(int diskBlocks);
+
+    /**
+     * 遍历 inode 表重建整张表。
+     */
+    void build(class FileSystemAdapter& adapter);
+
+    /**
+     * 登记归属。与已有记录相同时不写入：读取文件时也会经过这里，只持有共享锁的读者不能写共享内存。
+     */
+    inline void set(int blockIdx, uint32_t ino, int32_t fileBlock) {
+        if (blockIdx > 0 && blockIdx < (int) owners.size()
+            && (owners[blockIdx].ino != ino || owners[blockIdx].fileBlock != fileBlock)
+        ) {
+            owners[blockIdx].ino = ino;
+            owners[blockIdx].fileBlock = fileBlock;
+        }
+    }
+
+    inline void clear(int blockIdx) {
+        set(blockIdx, 0, 0);
+    }
+
+    inline const BlockOwner& get(int blockIdx) const {
+        return owners[blockIdx];
+    }
+
+    /**
+     * 从附属文件读取。
+     * 
+     * @param checksum 当前文件系统元数据的校验值。与文件中记录的不同时视为过期。
+     * @return 是否读取成功且未过期。
+     */
+    bool load(const std::string& path, uint64_t checksum);
+
+    /**
+     * 保存到附属文件。
+     */
+    bool save(const std::string& path, uint64_t checksum) const;
+
+public:
+    std::vector<BlockOwner> owners;
+};
@@ -0,0 +1,109 @@
+/*
+ * 盘块访问记录 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "./BlockTrace.h"
+#include "./MachineProps.h"
+
+using namespace std;
+
+static const char BLOCK_TRACE_MAGIC[8] = { 'V', '6', 'B', 'T', 'R', 'A', 'C', 'E' };
+static const uint32_t BLOCK_TRACE_VERSION = 1;
+
+thread_local BlockTrace::Tag BlockTraceTag::current = BlockTrace::TAG_OTHER;
+
+const char* BlockTrace::opName(int op) {
+    return op == READ ? "read" : op == WRITE ? "write" : "unknown";
+}
+
+const char* BlockTrace::tagName(int tag) {
+    switch (tag) {
+        case TAG_OTHER: return "other";
+        case TAG_METADATA: return "metadata";
+        case TAG_FORMAT: return "format";
+        case TAG_DIRECTORY: return "directory";
+        case TAG_FILE_READ: return "fileRead";
+        case TAG_FILE_WRITE: return "fileWrite";
+        case TAG_INDEX: return "index";
+        case TAG_FREE_LIST: return "freeList";
+        case TAG_BOOT: return "boot";
+        default: return "unknown";
+    }
+}
+
+BlockTrace::~BlockTrace() {
+    flush();
+}
+
+BlockTrace* BlockTrace::create(const string& path) {
+    BlockTrace* trace = new BlockTrace;
+    trace->file.open(path, ios::out | ios::binary | ios::trunc);
+    if (!trace->file.is_open()) {
+        delete trace;
+        return nullptr;
+    }
+
+    BlockTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BLOCK_TRACE_MAGIC, sizeof(header.magic));
+    header.version = BLOCK_TRACE_VERSION;
+    header.diskBlocks = MachineProps::diskBlocks();
+    header.blockSize = MachineProps::BLOCK_SIZE;
+    trace->file.write((const char*) &header, sizeof(header));
+
+    trace->buffer.reserve(BUFFER_RECORDS);
+    return trace;
+}
+
+bool BlockTrace::load(const string& path, BlockTraceHeader& header, vector<BlockTraceRecord>& records) {
+    ifstream f(path, ios::in | ios::binary | ios::ate);
+    if (!f.is_open()) {
+        return false;
+    }
+
+    long long fileSize = f.tellg();
+    f.seekg(0, ios::beg);
+    if (fileSize < (long long) sizeof(header)
+        || !f.read((char*) &header, sizeof(header))
+        || memcmp(header.magic, BLOCK_TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != BLOCK_TRACE_VERSION
+    ) {
+        return false;
+    }
+
+    // 末尾不完整的记录（例如记录时进程被中断）直接丢弃。
+    records.resize((fileSize - sizeof(header)) / sizeof(BlockTraceRecord));
+    f.read((char*) records.data(), records.size() * sizeof(BlockTraceRecord));
+    return f.good();
+}
+
+void BlockTrace::record(Op op, int blockIdx, int blockCount) {
+    lock_guard<std::mutex> lock(mutex);
+    while (blockCount > 0) {
+        BlockTraceRecord r;
+        r.op = op;
+        r.tag = BlockTraceTag::current;
+        r.blockCount = (uint16_t) min(blockCount, 0xffff);
+        r.blockIdx = blockIdx;
+        buffer.push_back(r);
+
+        blockIdx += r.blockCount;
+        blockCount -= r.blockCount;
+    }
+
+    if (buffer.size() >= BUFFER_RECORDS) {
+        file.write((const char*) buffer.data(), buffer.size() * sizeof(BlockTraceRecord));
+        buffer.clear();
+    }
+}
+
+void BlockTrace::flush() {
+    lock_guard<std::mutex> lock(mutex);
+    file.write((const char*) buffer.data(), buffer.size() * sizeof(BlockTraceRecord));
+    file.flush();
+    buffer.clear();
+}
@@ -0,0 +1,126 @@
+/*
+ * 盘块访问记录 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+#include "./MacroDefines.h"
+
+/**
+ * 记录文件头。
+ */
+class BlockTraceHeader {
+public:
+    char magic[8];
+    uint32_t version;
+    uint32_t diskBlocks;
+    uint32_t blockSize;
+    uint32_t reserved;
+} __packed;
+
+/**
+ * 一条记录：一次 readBlocks 或 writeBlocks。8 字节。
+ * 盘块数超过 65535 时拆成多条。
+ */
+class BlockTraceRecord {
+public:
+    uint8_t op;
+    uint8_t tag;
+    uint16_t blockCount;
+    uint32_t blockIdx;
+} __packed;
+
+/**
+ * 盘块访问记录。
+ *
+ * 开启后，适配器的每次盘块读写都以紧凑的二进制记录追加到文件中：
+ * 操作、起始盘块号、盘块数，以及调用方标签（由 BlockTraceTag 按作用域设置）。
+ * 记录下来的文件可以交给 fsreplay，在不同的读写方式与缓存容量下重放。
+ */
+class BlockTrace {
+public:
+    enum Op : uint8_t {
+        READ = 0,
+        WRITE = 1
+    };
+
+    /** 调用方标签。嵌套时以最内层为准。 */
+    enum Tag : uint8_t {
+        TAG_OTHER = 0,
+        TAG_METADATA,       // superblock 与 inode 表的加载、同步。
+        TAG_FORMAT,
+        TAG_DIRECTORY,      // 目录文件的加载与写回。
+        TAG_FILE_READ,
+        TAG_FILE_WRITE,
+        TAG_INDEX,          // 文件的索引块。
+        TAG_FREE_LIST,      // 空闲盘块链。
+        TAG_BOOT,           // 内核与启动引导。
+
+        TAG_COUNT
+    };
+
+    static const char* opName(int op);
+    static const char* tagName(int tag);
+
+public:
+    ~BlockTrace();
+
+    /**
+     * 创建记录文件。
+     *
+     * @return 记录对象。文件无法创建时返回 nullptr。
+     */
+    static BlockTrace* create(const std::string& path);
+
+    /**
+     * 读入记录文件。
+     *
+     * @return 是否成功。文件格式不对时返回 false。
+     */
+    static bool load(const std::string& path, BlockTraceHeader& header, std::vector<BlockTraceRecord>& records);
+
+    /**
+     * 追加一条记录。标签取当前线程的 BlockTraceTag。可以被多个线程同时调用。
+     */
+    void record(Op op, int blockIdx, int blockCount);
+
+    /** 将缓冲的记录写入文件。 */
+    void flush();
+
+private:
+    BlockTrace() = default;
+
+private:
+    /** 缓冲的记录数达到此值时写入文件。 */
+    static const int BUFFER_RECORDS = 8192;
+
+    std::mutex mutex;
+    std::ofstream file;
+    std::vector<BlockTraceRecord> buffer;
+};
+
+/**
+ * 调用方标签作用域。构造时设置当前线程的标签，析构时恢复。
+ */
+class BlockTraceTag {
+public:
+    inline BlockTraceTag(BlockTrace::Tag tag) : prev(current) {
+        current = tag;
+    }
+
+    inline ~BlockTraceTag() {
+        current = prev;
+    }
+
+    static thread_local BlockTrace::Tag current;
+
+private:
+    BlockTrace::Tag prev;
+};
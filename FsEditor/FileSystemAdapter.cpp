@@ -13,16 +13,43 @@
 #include <cstring>
 #include <cstdint>
 #include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include <shared_mutex>
 #include "./FileSystemAdapter.h"
+#include "./BlockOverlay.h"
+#include "./BlockOwnerMap.h"
+#include "./SidecarCache.h"
+#include "./Tracer.h"
+#include "./BlockTrace.h"
 #include "./MachineProps.h"
 #include "./structures/Inode.h"
 #include "./structures/SuperBlock.h"
 #include "./structures/Block.h"
 #include "./structures/InodeDirectory.h"
 
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #include <sys/sendfile.h>
+    #include <sys/mman.h>
+#endif
+
 using namespace std;
 using namespace std::chrono;
 
+/*
+ * 提示与错误信息的输出流。作为库（libv6ppfs）编译时不输出：调用者的标准输出可能另有用途。
+ */
+#ifdef V6PP_LIBRARY
+static thread_local ostream console(nullptr);
+#else
+static ostream& console = cout;
+#endif
+
 /**
  * 获取当前系统时间戳。单位：秒。
  * 
@@ -36,8 +63,22 @@ static int getCurrentTimeStamp() {
     return millisec.count() / 1000;
 }
 
-FileSystemAdapter::FileSystemAdapter(const char* filePath) {
-    fileStream.open(filePath, ios::in | ios::out | ios::binary);
+/**
+ * 当前线程绑定的会话。
+ */
+static thread_local struct {
+    const FileSystemAdapter* adapter = nullptr;
+    AdapterSession* session = nullptr;
+} boundSession;
+
+FileSystemAdapter::FileSystemAdapter(const char* filePath, const char* overlayPath, bool readOnly) {
+    this->readOnly = readOnly;
+
+    // 覆盖层模式下，基础映像只读。
+    auto openMode = overlayPath == nullptr && !readOnly 
+        ? ios::in | ios::out | ios::binary 
+        : ios::in | ios::binary;
+    fileStream.open(filePath, openMode);
     // 别忘了加 binary。这个 bug 找了一晚上...
     // sj: ”0x1a？那要打屁股了。“
 
@@ -53,6 +94,34 @@ FileSystemAdapter::FileSystemAdapter(const char* filePath) {
         fileStream.close();
         throw runtime_error("bad filesize.");
     }
+
+    imgFilePath = filePath;
+
+    if (overlayPath != nullptr) {
+        try {
+            overlay = new BlockOverlay(overlayPath, fileStream, MachineProps::diskBlocks());
+        } catch (...) {
+            fileStream.close();
+            throw;
+        }
+    }
+
+    inodeLocks = new shared_mutex[sizeof(inodes) / sizeof(Inode)];
+
+#ifdef __linux__
+    // 打开失败也没关系，盘块读写会退回文件流，内核态拷贝会退回缓冲拷贝。
+    // 不能直接写映像时只读打开，仅用于 pread。
+    imgFd = open(filePath, readOnly || overlay != nullptr ? O_RDONLY : O_RDWR);
+
+    // 只读映射，供目录视图直接访问盘块。盘块写入经过 pwrite，与映射共享页缓存，映射中总是最新内容。
+    // 覆盖层模式下映像中的内容可能已经过时，不映射。
+    if (imgFd >= 0 && overlay == nullptr) {
+        void* mapped = mmap(nullptr, MachineProps::diskSize(), PROT_READ, MAP_SHARED, imgFd, 0);
+        if (mapped != MAP_FAILED) {
+            imgMap = (const char*) mapped;
+        }
+    }
+#endif
 }
 
 FileSystemAdapter::~FileSystemAdapter() {
@@ -60,6 +129,55 @@ FileSystemAdapter::~FileSystemAdapter() {
         sync();
         fileStream.close();
     }
+
+    if (overlay != nullptr) {
+        delete overlay;
+    }
+
+    if (ownerMap != nullptr) {
+        delete ownerMap;
+    }
+
+    if (allocPolicy != nullptr) {
+        delete allocPolicy;
+    }
+
+    if (cache != nullptr) {
+        delete cache;
+    }
+
+    if (blockTrace != nullptr) {
+        delete blockTrace;
+    }
+
+    delete[] inodeLocks;
+
+#ifdef __linux__
+    if (imgMap != nullptr) {
+        munmap((void*) imgMap, MachineProps::diskSize());
+    }
+
+    if (imgFd >= 0) {
+        close(imgFd);
+    }
+#endif
+}
+
+AdapterSession& FileSystemAdapter::session() {
+    AdapterSession& s = boundSession.adapter == this && boundSession.session != nullptr 
+        ? *boundSession.session 
+        : defaultSession;
+
+    if (s.inodeIdxStack.empty()) {
+        s.inodeIdxStack.push_back(ROOT_INODE_IDX);
+    }
+
+    return s;
+}
+
+void FileSystemAdapter::bindSession(AdapterSession* session) {
+    boundSession.adapter = session == nullptr ? nullptr : this;
+    boundSession.session = session;
 }
 
 bool FileSystemAdapter::readBlock(Block& block, const int blockIdx) {
@@ -69,12 +187,56 @@ bool FileSystemAdapter::readBlock(Block& block, const int blockIdx) {
 
 bool FileSystemAdapter::readBlocks(char* buffer, const int blockIdx, const int blockCount) {
     if (blockIdx + blockCount > MachineProps::diskBlocks()) {
-        cout << "[critical 1] FileSystemAdapter::readBlocks c*ii" << endl;
-        cout << "             pBuf: " << (int*) buffer << ", blockIdx: " 
+        console << "[critical 1] FileSystemAdapter::readBlocks c*ii" << endl;
+        console << "             pBuf: " << (int*) buffer << ", blockIdx: " 
             << blockIdx << ", count: " << blockCount << endl;
-        exit(-1);
+        throw runtime_error("block index out of range in readBlocks.");
+    }
+
+    V6PP_STAT_SCOPE(ioStats, READ_BLOCKS, blockIdx, blockCount);
+    V6PP_TRACE_IO(false, blockIdx, blockCount);
+
+    if (blockTrace != nullptr) {
+        blockTrace->record(BlockTrace::READ, blockIdx, blockCount);
+    }
+
+    if (overlay != nullptr) {
+        return overlay->readBlocks(
+            buffer, blockIdx, blockCount, 
+            [this] (char* buffer, int blockIdx, int blockCount) {
+                return this->readImageBlocks(buffer, blockIdx, blockCount);
+            }
+        );
+    }
+
+    return this->readImageBlocks(buffer, blockIdx, blockCount);
+}
+
+bool FileSystemAdapter::readImageBlocks(char* buffer, const int blockIdx, const int blockCount) {
+#ifdef __linux__
+    if (imgFd >= 0) {
+        long long bytesToRead = 1LL * blockCount * sizeof(Block);
+        long long bytesRead = 0;
+        while (bytesRead < bytesToRead) {
+            ssize_t n = pread(
+                imgFd, buffer + bytesRead, bytesToRead - bytesRead, 
+                1LL * blockIdx * sizeof(Block) + bytesRead
+            );
+
+            if (n > 0) {
+                bytesRead += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+
+        return bytesRead == bytesToRead;
     }
+#endif
 
+    lock_guard<mutex> lock(streamMutex);
     fileStream.clear();
     fileStream.seekg(blockIdx * sizeof(Block), ios::beg);
     fileStream.read(buffer, blockCount * sizeof(Block));
@@ -88,12 +250,52 @@ bool FileSystemAdapter::writeBlock(const Block& block, const int blockIdx) {
 
 bool FileSystemAdapter::writeBlocks(const char* buffer, const int blockIdx, const int blockCount) {
     if (blockIdx + blockCount > MachineProps::diskBlocks()) {
-        cout << "[critical 1] FileSystemAdapter::writeBlocks c*ii" << endl;
-        cout << "             pBuf: " << (int*) buffer << ", blockIdx: " 
+        console << "[critical 1] FileSystemAdapter::writeBlocks c*ii" << endl;
+        console << "             pBuf: " << (int*) buffer << ", blockIdx: " 
             << blockIdx << ", count: " << blockCount << endl;
-        exit(-1);
+        throw runtime_error("block index out of range in writeBlocks.");
+    }
+
+    if (readOnly) {
+        console << "[error] 文件系统以只读方式打开，拒绝写入盘块 " << blockIdx << "。" << endl;
+        return false;
     }
 
+    V6PP_STAT_SCOPE(ioStats, WRITE_BLOCKS, blockIdx, blockCount);
+    V6PP_TRACE_IO(true, blockIdx, blockCount);
+
+    if (blockTrace != nullptr) {
+        blockTrace->record(BlockTrace::WRITE, blockIdx, blockCount);
+    }
+
+    if (overlay != nullptr) {
+        return overlay->writeBlocks(buffer, blockIdx, blockCount);
+    }
+
+#ifdef __linux__
+    if (imgFd >= 0) {
+        long long bytesToWrite = 1LL * blockCount * sizeof(Block);
+        long long bytesWritten = 0;
+        while (bytesWritten < bytesToWrite) {
+            ssize_t n = pwrite(
+                imgFd, buffer + bytesWritten, bytesToWrite - bytesWritten, 
+                1LL * blockIdx * sizeof(Block) + bytesWritten
+            );
+
+            if (n > 0) {
+                bytesWritten += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+
+        return bytesWritten == bytesToWrite;
+    }
+#endif
+
+    lock_guard<mutex> lock(streamMutex);
     fileStream.clear();
     fileStream.seekp(blockIdx * sizeof(Block), ios::beg);
     fileStream.write(buffer, blockCount * sizeof(Block));
@@ -126,55 +328,116 @@ bool FileSystemAdapter::iterateOverInodeDataBlocks(
     const function<void (
         const char* pBlock,
         int blockIndex
-    )> indirectIndexBlockPostProcess
+    )> indirectIndexBlockPostProcess,
+
+    const function<bool (
+        int dataByteOffset
+    )> dataHoleDetector
 
 ) {
     int sizeRemaining = inode.d_size; // 剩下的字节数。
     const char* errmsg = "";
 
+    // 开启归属反查表时，需要知道 inode 号。
+    int ino = &inode - this->inodes;
+    if (ino < 0 || ino >= sizeof(this->inodes) / sizeof(Inode)) {
+        ino = 0;
+    }
+
+    V6PP_TRACE_SCOPE("iterateOverInodeDataBlocks", ino);
+
     // 每个索引块的块条目数。
     const int entriesPerIdxBlock = sizeof(Block) / sizeof(uint32_t);
     uint32_t firstIdxBlockBuffer[entriesPerIdxBlock]; // 一级索引块缓存。
     uint32_t secondIdxBlockBuffer[entriesPerIdxBlock]; // 二级索引块缓存。
     // 上面这两个东西总共占用 1KB 栈空间，问题不大。
 
+    /*
+     * 处理一个数据块槽位。返回槽位的新盘块号，-1 表示申请失败。
+     * 盘块号为 0 的槽位是空洞：仍会通知 blockDiscoveryHandler（盘块号为 0），
+     * 但不会调用 dataBlockPostProcess。
+     */
+    auto visitDataBlock = [&] (uint32_t prevBlkIdx, int dataByteOffset) {
+        int nextBlkIdx = 0;
+        if (dataHoleDetector == nullptr || !dataHoleDetector(dataByteOffset)) {
+            nextBlkIdx = blockAllocator(prevBlkIdx);
+            if (nextBlkIdx < 0) {
+                return -1;
+            }
+        }
+
+        blockDiscoveryHandler(dataByteOffset, nextBlkIdx);
+        if (nextBlkIdx != 0) {
+            if (ownerMap != nullptr && ino != 0) {
+                ownerMap->set(nextBlkIdx, ino, dataByteOffset / sizeof(Block));
+            }
+
+            dataBlockPostProcess(nextBlkIdx);
+        }
+
+        return nextBlkIdx;
+    };
+
+    /*
+     * 索引块后处理。登记归属后再调用 indirectIndexBlockPostProcess（它可能会释放该盘块）。
+     */
+    auto postProcessIdxBlock = [&] (const uint32_t* buffer, int blockIdx) {
+        if (ownerMap != nullptr && ino != 0) {
+            ownerMap->set(blockIdx, ino, BlockOwner::INDEX_BLOCK);
+        }
+
+        BlockTraceTag tag(BlockTrace::TAG_INDEX);
+        indirectIndexBlockPostProcess((const char*) buffer, blockIdx);
+    };
+
+    /*
+     * 读入一个索引块。盘块号为 0 的索引块视作全部为空洞。
+     */
+    auto loadIdxBlock = [&] (uint32_t* buffer, int blockIdx) {
+        if (blockIdx == 0) {
+            memset(buffer, 0, sizeof(Block));
+        } else {
+            BlockTraceTag tag(BlockTrace::TAG_INDEX);
+            this->readBlocks((char*) buffer, blockIdx, 1);
+        }
+    };
+
     // 直接索引读入。
     for (int idx = 0; sizeRemaining > 0 && idx < 6; idx++) {
 
-        uint32_t nextBlkIdx = blockAllocator(inode.direct_index[idx]);
+        int nextBlkIdx = visitDataBlock(inode.direct_index[idx], sizeof(Block) * idx);
         if (nextBlkIdx < 0) {
             errmsg = "direct index, block allocation failed.";
             goto IT_INODE_DATA_BLOCKS_FAILED;
         }
 
-        inode.direct_index[idx] = nextBlkIdx;
-        blockDiscoveryHandler(sizeof(Block) * idx, inode.direct_index[idx]);
-        dataBlockPostProcess(inode.direct_index[idx]);
+        if (inode.direct_index[idx] != (uint32_t) nextBlkIdx) { // 没有变化时不写回。读取只持有共享锁。
+            inode.direct_index[idx] = nextBlkIdx;
+        }
 
         sizeRemaining -= sizeof(Block);
     }
 
     // 一级索引读入。
     for (int firIdxBlockIdx = 0; firIdxBlockIdx < 2 && sizeRemaining > 0; firIdxBlockIdx++) {
-        uint32_t nextBlkIdx = blockAllocator(inode.indirect_index[firIdxBlockIdx]);
+        int nextBlkIdx = blockAllocator(inode.indirect_index[firIdxBlockIdx]);
         if (nextBlkIdx < 0) {
             errmsg = "fir indirect index, block allocation failed.";
             goto IT_INODE_DATA_BLOCKS_FAILED;
         }
 
-        inode.indirect_index[firIdxBlockIdx] = nextBlkIdx;
+        if (inode.indirect_index[firIdxBlockIdx] != (uint32_t) nextBlkIdx) {
+            inode.indirect_index[firIdxBlockIdx] = nextBlkIdx;
+        }
         
-        this->readBlocks(
-            (char*) firstIdxBlockBuffer,
-            inode.indirect_index[firIdxBlockIdx], 1
-        );
+        loadIdxBlock(firstIdxBlockBuffer, inode.indirect_index[firIdxBlockIdx]);
 
         // 内部：直接索引。
         for (int idx = 0; sizeRemaining > 0 && idx < entriesPerIdxBlock; idx++) {
             int entriesTargetByteOffset = MachineProps::BLOCK_SIZE 
                 * (6 + entriesPerIdxBlock * firIdxBlockIdx + idx);
 
-            uint32_t nextBlkIdx = blockAllocator(firstIdxBlockBuffer[idx]);
+            int nextBlkIdx = visitDataBlock(firstIdxBlockBuffer[idx], entriesTargetByteOffset);
             if (nextBlkIdx < 0) {
                 errmsg = "fir indirect index, block allocation failed (direct).";
                 goto IT_INODE_DATA_BLOCKS_FAILED;
@@ -182,29 +445,27 @@ bool FileSystemAdapter::iterateOverInodeDataBlocks(
 
             firstIdxBlockBuffer[idx] = nextBlkIdx;
 
-            blockDiscoveryHandler(entriesTargetByteOffset, firstIdxBlockBuffer[idx]);
-            dataBlockPostProcess(firstIdxBlockBuffer[idx]);
-
             sizeRemaining -= MachineProps::BLOCK_SIZE;
             
         } // for (int idx = 0; sizeRemaining > 0 && idx < 6; idx++)
 
-        indirectIndexBlockPostProcess((char*) firstIdxBlockBuffer, nextBlkIdx);
+        if (nextBlkIdx != 0) {
+            postProcessIdxBlock(firstIdxBlockBuffer, nextBlkIdx);
+        }
     } // for (int firIdxBlockIdx = 0; firIdxBlockIdx < 2 && sizeRemaining > 0; firIdxBlockIdx++)
 
     // 二级索引读入。
     for (int secIdxBlockIdx = 0; secIdxBlockIdx < 2 && sizeRemaining > 0; secIdxBlockIdx++) {
-        uint32_t nextBlkIdx = blockAllocator(inode.secondary_indirect_index[secIdxBlockIdx]);
+        int nextBlkIdx = blockAllocator(inode.secondary_indirect_index[secIdxBlockIdx]);
         if (nextBlkIdx < 0) {
             errmsg = "sec indirect index, block allocation failed.";
             goto IT_INODE_DATA_BLOCKS_FAILED;
         }
-        inode.secondary_indirect_index[secIdxBlockIdx] = nextBlkIdx;
+        if (inode.secondary_indirect_index[secIdxBlockIdx] != (uint32_t) nextBlkIdx) {
+            inode.secondary_indirect_index[secIdxBlockIdx] = nextBlkIdx;
+        }
 
-        this->readBlocks(
-            (char*) secondIdxBlockBuffer, 
-            inode.secondary_indirect_index[secIdxBlockIdx], 1
-        );
+        loadIdxBlock(secondIdxBlockBuffer, inode.secondary_indirect_index[secIdxBlockIdx]);
 
         // 内部：一级索引。
         for (
@@ -212,28 +473,18 @@ bool FileSystemAdapter::iterateOverInodeDataBlocks(
             firIdxBlockIdx < entriesPerIdxBlock && sizeRemaining > 0; 
             firIdxBlockIdx++
         ) {
-            uint32_t nextBlkIdx = blockAllocator(secondIdxBlockBuffer[firIdxBlockIdx]);
+            int nextBlkIdx = blockAllocator(secondIdxBlockBuffer[firIdxBlockIdx]);
             if (nextBlkIdx < 0) {
                 errmsg = "sec indirect index, block allocation failed (fir).";
                 goto IT_INODE_DATA_BLOCKS_FAILED;
             }
             secondIdxBlockBuffer[firIdxBlockIdx] = nextBlkIdx;
 
-            this->readBlocks(
-                (char*) firstIdxBlockBuffer,
-                secondIdxBlockBuffer[firIdxBlockIdx], 1
-            );
+            loadIdxBlock(firstIdxBlockBuffer, secondIdxBlockBuffer[firIdxBlockIdx]);
 
             // 内部：直接索引。
             for (int idx = 0; sizeRemaining > 0 && idx < entriesPerIdxBlock; idx++) {
 
-                uint32_t nextBlkIdx = blockAllocator(firstIdxBlockBuffer[idx]);
-                if (nextBlkIdx < 0) {
-                    errmsg = "sec indirect index, block allocation failed (fir).";
-                    goto IT_INODE_DATA_BLOCKS_FAILED;
-                }
-                firstIdxBlockBuffer[idx] = nextBlkIdx;
-
                 int entriesTargetByteOffset = sizeof(Block) * (
                     6 
                     + 2 * entriesPerIdxBlock 
@@ -242,17 +493,26 @@ bool FileSystemAdapter::iterateOverInodeDataBlocks(
                     + idx
                 );
 
-                blockDiscoveryHandler(entriesTargetByteOffset, firstIdxBlockBuffer[idx]);
-                dataBlockPostProcess(firstIdxBlockBuffer[idx]);
+                int nextBlkIdx = visitDataBlock(firstIdxBlockBuffer[idx], entriesTargetByteOffset);
+                if (nextBlkIdx < 0) {
+                    errmsg = "sec indirect index, block allocation failed (fir).";
+                    goto IT_INODE_DATA_BLOCKS_FAILED;
+                }
+
+                firstIdxBlockBuffer[idx] = nextBlkIdx;
 
                 sizeRemaining -= sizeof(Block);
                 
             } // for (int idx = 0; sizeRemaining > 0 && idx < 6; idx++)
 
-            indirectIndexBlockPostProcess((char*) firstIdxBlockBuffer, nextBlkIdx);
+            if (nextBlkIdx != 0) {
+                postProcessIdxBlock(firstIdxBlockBuffer, nextBlkIdx);
+            }
         } // 内部：一级索引。
         
-        indirectIndexBlockPostProcess((char*) secondIdxBlockBuffer, nextBlkIdx);
+        if (nextBlkIdx != 0) {
+            postProcessIdxBlock(secondIdxBlockBuffer, nextBlkIdx);
+        }
     }
 
     return true;
@@ -264,11 +524,18 @@ IT_INODE_DATA_BLOCKS_FAILED:
 }
 
 bool FileSystemAdapter::readFile(char* buffer, Inode& inode) {
+    BlockTraceTag tag(
+        inode.file_type == Inode::FileType::DIR ? BlockTrace::TAG_DIRECTORY : BlockTrace::TAG_FILE_READ
+    );
 
     return this->iterateOverInodeDataBlocks(
         inode,
         [&] (int dataByteOffset, int blockIdx) {
-            readBlocks(buffer + dataByteOffset, blockIdx, 1);
+            if (blockIdx == 0) { // 空洞。
+                memset(buffer + dataByteOffset, 0, sizeof(Block));
+            } else {
+                readBlocks(buffer + dataByteOffset, blockIdx, 1);
+            }
         },
 
         [] (int prevBlockIdx) {
@@ -276,7 +543,7 @@ bool FileSystemAdapter::readFile(char* buffer, Inode& inode) {
         },
 
         [] (Inode& inode, int sizeRemaining, const char* msg) {
-            cout << "[error] lambda 异常。" << endl;
+            console << "[error] lambda 异常。" << endl;
         },
 
         [] (...) {},
@@ -287,6 +554,17 @@ bool FileSystemAdapter::readFile(char* buffer, Inode& inode) {
 
 
 bool FileSystemAdapter::writeFile(char* buffer, Inode& inode, int filesize) {
+    BlockTraceTag tag(
+        inode.file_type == Inode::FileType::DIR ? BlockTrace::TAG_DIRECTORY : BlockTrace::TAG_FILE_WRITE
+    );
+    metadataDirty = true;
+
+    // 重写时尽量放回原来的位置。
+    AllocationContext& allocContext = session().allocContext;
+    allocContext.ino = &inode - this->inodes;
+    allocContext.goal = inode.d_size > 0 ? inode.direct_index[0] : 0;
+    allocContext.blocksWanted = AllocationContext::blocksForFileSize(filesize);
+
     this->freeInodeBlocks(inode);
 
     int filesizeRemaining = min(filesize, FileSystemAdapter::FS_FILE_SIZE_MAX);
@@ -299,6 +577,10 @@ bool FileSystemAdapter::writeFile(char* buffer, Inode& inode, int filesize) {
         inode, 
         
         [&] (int dataByteOffset, int blockIdx) {
+            if (blockIdx == 0) { // 空洞。
+                return;
+            }
+
             this->writeBlocks(
                 buffer + dataByteOffset, blockIdx, 1
             );
@@ -310,7 +592,7 @@ bool FileSystemAdapter::writeFile(char* buffer, Inode& inode, int filesize) {
 
         [&] (Inode& inode, int sizeRemaining, const char* msg) {
             inode.d_size -= sizeRemaining;
-            cout << "[error] lambda 异常（可能的原因：盘满）。" << endl;
+            console << "[error] lambda 异常（可能的原因：盘满）。" << endl;
         },
 
         [] (...) {},
@@ -319,37 +601,40 @@ bool FileSystemAdapter::writeFile(char* buffer, Inode& inode, int filesize) {
             this->writeBlocks(
                 pBlock, blockIndex, 1
             );
-        }
+        },
+
+        sparseFiles ? function<bool (int)>([&] (int dataByteOffset) {
+            return Block::isZero(
+                buffer + dataByteOffset, 
+                min((int) sizeof(Block), (int) inode.d_size - dataByteOffset)
+            );
+        }) : function<bool (int)>(nullptr)
     );
 }
 
 bool FileSystemAdapter::downloadFile(const std::string& fname, std::fstream& f) {
-    InodeDirectory dir(this->inodes[inodeIdxStack.back()], *this, false, 1);
-    
-    int targetIdx = -1;
-
     // 寻找目标。
-    for (int entryIdx = 0; entryIdx < dir.length; entryIdx++) {
-        if (dir.entries[entryIdx].m_name == fname) {
-            targetIdx = dir.entries[entryIdx].m_ino;
-            break;
-        }
-    }
+    int targetIdx = this->lookupEntry(session().inodeIdxStack.back(), fname);
 
-    if (targetIdx < 0) {
-        cout << "[error] 找不到：" << fname << endl;
+    if (targetIdx <= 0) {
+        console << "[error] 找不到：" << fname << endl;
         return false;
     }
 
+    shared_lock<shared_mutex> lock(inodeLock(targetIdx));
     f.clear();
     f.seekp(0, ios::beg);
+    BlockTraceTag tag(BlockTrace::TAG_FILE_READ);
 
     return this->iterateOverInodeDataBlocks(
         this->inodes[targetIdx],
 
         [&] (int, int blockIdx) {
             Block b;
-            this->readBlock(b, blockIdx);
+            if (blockIdx != 0) { // 空洞读出为 0。
+                this->readBlock(b, blockIdx);
+            }
+
             f.write(
                 b.asCharArray(), 
                 min(
@@ -367,37 +652,225 @@ bool FileSystemAdapter::downloadFile(const std::string& fname, std::fstream& f)
 }
 
 bool FileSystemAdapter::uploadFile(const std::string& fname, std::fstream& f) {
-    Inode& inode = this->inodes[this->touch(fname, Inode::FileType::NORMAL)];
-    this->freeInodeBlocks(inode);
-
     f.clear();
     f.seekg(0, ios::end);
-    int filesize = f.tellg();
+    long long filesize = f.tellg();
+
+    return this->uploadFile(
+        fname, 
+        filesize, 
+        [&] (long long hostOffset, long long hostBytes, int blockIdx, int blockCount) {
+            vector<char> buffer(blockCount * sizeof(Block), 0);
+            f.clear();
+            f.seekg(hostOffset, ios::beg);
+            f.read(buffer.data(), hostBytes);
+            return this->writeBlocks(buffer.data(), blockIdx, blockCount);
+        },
+        [&] (long long hostOffset, long long hostBytes, char* buffer) {
+            f.clear();
+            f.seekg(hostOffset, ios::beg);
+            f.read(buffer, hostBytes);
+            return f.gcount() == hostBytes;
+        }
+    );
+}
 
-    int filesizeRemaining = min(filesize, FileSystemAdapter::FS_FILE_SIZE_MAX);
-    inode.d_size = filesizeRemaining;
-    inode.ilarg = !!(filesizeRemaining > sizeof(Block) * 6);
+bool FileSystemAdapter::uploadFile(const std::string& fname, const std::string& hostPath) {
+#ifdef __linux__
+    int hostFd = open(hostPath.c_str(), O_RDONLY);
+    if (hostFd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(hostFd, &st) != 0) {
+        close(hostFd);
+        return false;
+    }
+
+    bool result = this->uploadFile(
+        fname,
+        st.st_size,
+        [&] (long long hostOffset, long long hostBytes, int blockIdx, int blockCount) {
+            return this->copyFromHostFile(hostFd, hostOffset, hostBytes, blockIdx, blockCount);
+        },
+        [&] (long long hostOffset, long long hostBytes, char* buffer) {
+            long long bytesRead = 0;
+            while (bytesRead < hostBytes) {
+                ssize_t n = pread(hostFd, buffer + bytesRead, hostBytes - bytesRead, hostOffset + bytesRead);
+                if (n > 0) {
+                    bytesRead += n;
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    break;
+                }
+            }
+
+            return bytesRead == hostBytes;
+        }
+    );
+
+    close(hostFd);
+    return result;
+#else
+    fstream f(hostPath, ios::in | ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+
+    return this->uploadFile(fname, f);
+#endif
+}
+
+bool FileSystemAdapter::uploadFile(
+    const std::string& fname,
+    long long filesize,
+    const function<bool (
+        long long hostOffset,
+        long long hostBytes,
+        int blockIdx,
+        int blockCount
+    )>& extentWriter,
+    const function<bool (
+        long long hostOffset,
+        long long hostBytes,
+        char* buffer
+    )>& hostReader
+) {
+    V6PP_TRACE_SCOPE("uploadFile", fname);
+    BlockTraceTag tag(BlockTrace::TAG_FILE_WRITE);
+
+    int ino = this->touch(fname, Inode::FileType::NORMAL);
+    if (ino < 0) {
+        return false;
+    }
+
+    Inode& inode = this->inodes[ino];
+    unique_lock<shared_mutex> lock(inodeLock(ino));
+
+    int filesizeRemaining = min(filesize, (long long) FileSystemAdapter::FS_FILE_SIZE_MAX);
+
+    AllocationContext& allocContext = session().allocContext;
+    allocContext.ino = ino;
+    allocContext.parentIno = session().inodeIdxStack.back();
+    allocContext.goal = 0;
+    allocContext.blocksWanted = AllocationContext::blocksForFileSize(filesizeRemaining);
     // 开放所有权限。
     inode.permission_group = inode.permission_others = inode.permission_owner = 7;
 
-    f.seekg(0, ios::beg);
+    // 稀疏探测窗口：按区段读入宿主机数据，逐块判断是否全零。
+    vector<char> holeWindow;
+    long long holeWindowOffset = 0;
+    long long holeWindowBytes = 0;
+
+    auto detectHole = [&] (int dataByteOffset) {
+        if (dataByteOffset < holeWindowOffset || dataByteOffset >= holeWindowOffset + holeWindowBytes) {
+            holeWindowOffset = dataByteOffset;
+            holeWindowBytes = min(
+                EXTENT_BLOCKS_MAX * (long long) sizeof(Block), 
+                (long long) inode.d_size - dataByteOffset
+            );
+            holeWindow.resize(holeWindowBytes);
 
-    return this->iterateOverInodeDataBlocks(
+            if (!hostReader(holeWindowOffset, holeWindowBytes, holeWindow.data())) {
+                holeWindowBytes = 0;
+                return false; // 读取失败时不留空洞，交给 extentWriter 处理。
+            }
+        }
+
+        return Block::isZero(
+            holeWindow.data() + (dataByteOffset - holeWindowOffset), 
+            min((long long) sizeof(Block), holeWindowOffset + holeWindowBytes - dataByteOffset)
+        );
+    };
+
+    return this->writeInodeExtents(
+        inode,
+        filesizeRemaining,
+
+        [&] () {
+            return this->getFreeBlock();
+        },
+
+        [&] (int dataByteOffset, int blockIdx, int blockCount) {
+            long long hostBytes = min(
+                blockCount * (long long) sizeof(Block), 
+                (long long) inode.d_size - dataByteOffset
+            );
+
+            return extentWriter(dataByteOffset, hostBytes, blockIdx, blockCount);
+        },
+
+        sparseFiles ? function<bool (int)>(detectHole) : function<bool (int)>(nullptr)
+    );
+}
+
+bool FileSystemAdapter::writeInodeExtents(
+    Inode& inode,
+    int filesize,
+    const function<int ()>& blockAllocator,
+    const function<bool (
+        int dataByteOffset,
+        int blockIdx,
+        int blockCount
+    )>& extentWriter,
+    const function<bool (
+        int dataByteOffset
+    )>& dataHoleDetector
+) {
+    this->freeInodeBlocks(inode);
+    inode.d_size = filesize;
+    inode.ilarg = !!(filesize > sizeof(Block) * 6);
+
+    // 待写入的区段：文件内偏移与盘块号都连续的一串数据块。
+    int extentByteOffset = 0;
+    int extentBlockIdx = 0;
+    int extentBlockCount = 0;
+    bool extentFailed = false;
+
+    auto flushExtent = [&] () {
+        if (extentBlockCount == 0) {
+            return;
+        }
+
+        if (!extentWriter(extentByteOffset, extentBlockIdx, extentBlockCount)) {
+            extentFailed = true;
+        }
+
+        extentBlockCount = 0;
+    };
+
+    bool result = this->iterateOverInodeDataBlocks(
         inode, 
         
         [&] (int dataByteOffset, int blockIdx) {
-            Block b;
-            f.read(b.asCharArray(), sizeof(b));
-            this->writeBlock(b, blockIdx);
+            if (blockIdx == 0) { // 空洞。
+                flushExtent();
+                return;
+            }
+
+            bool contiguous = extentBlockCount > 0
+                && extentBlockCount < EXTENT_BLOCKS_MAX
+                && blockIdx == extentBlockIdx + extentBlockCount
+                && dataByteOffset == extentByteOffset + extentBlockCount * (int) sizeof(Block);
+
+            if (!contiguous) {
+                flushExtent();
+                extentByteOffset = dataByteOffset;
+                extentBlockIdx = blockIdx;
+            }
+
+            extentBlockCount++;
         },
 
         [&] (int prevBlockIdx) {
-            return this->getFreeBlock();
+            return blockAllocator();
         },
 
         [&] (Inode& inode, int sizeRemaining, const char* msg) {
             inode.d_size -= sizeRemaining;
-            cout << "[error] lambda 异常（可能的原因：盘满）。" << endl;
+            console << "[error] lambda 异常（可能的原因：盘满）。" << endl;
         },
 
         [] (...) {},
@@ -406,59 +879,276 @@ bool FileSystemAdapter::uploadFile(const std::string& fname, std::fstream& f) {
             this->writeBlocks(
                 pBlock, blockIndex, 1
             );
-        }
+        },
+
+        dataHoleDetector
     );
+
+    flushExtent();
+
+    return result && !extentFailed;
 }
 
-void FileSystemAdapter::load() {
-    this->superBlock.loadFromImg(this->fileStream);
+bool FileSystemAdapter::copyFromHostFile(
+    int hostFd, long long hostOffset, long long hostBytes, 
+    int blockIdx, int blockCount
+) {
+    if (blockIdx + blockCount > MachineProps::diskBlocks()) {
+        console << "[critical 1] FileSystemAdapter::copyFromHostFile illii" << endl;
+        console << "             hostFd: " << hostFd << ", blockIdx: " 
+            << blockIdx << ", count: " << blockCount << endl;
+        throw runtime_error("block index out of range in copyFromHostFile.");
+    }
 
-    this->fileStream.clear();
+    hostBytes = min(hostBytes, blockCount * (long long) sizeof(Block));
+    long long bytesCopied = 0;
 
-    this->fileStream.seekg(
-        this->superBlock.inode_zone_begin * MachineProps::BLOCK_SIZE,
-        ios::beg
-    );
-    
-    int inodeZoneSize = this->superBlock.inode_zone_blocks * MachineProps::BLOCK_SIZE;
+#ifdef __linux__
+    // 只在内核态拷贝完整的盘块。尾部盘块需要补零，交给缓冲拷贝。
+    long long fullBlockBytes = hostBytes / sizeof(Block) * sizeof(Block);
 
-    this->fileStream.read(
-        (char*) this->inodes, 
-        inodeZoneSize
-    );
+    if (imgFd >= 0 && !readOnly && overlay == nullptr && fullBlockBytes > 0) {
+        // 盘块写入都经过 pwrite，流中没有需要先落盘的数据。
+        auto copyBegin = steady_clock::now();
+        loff_t inOffset = hostOffset;
+        loff_t outOffset = 1LL * blockIdx * sizeof(Block);
 
-    if (fileStream.gcount() != inodeZoneSize) {
-        cout << "[error] exception on loading inodes." << endl;
-        cout << "        bytes read:   " << fileStream.gcount() << endl;
-        cout << "        bytes wanted: " << inodeZoneSize << endl;
-        cout << "        fp: " << fileStream.tellg() << endl;
-        cout << "        fstream goodbit: " << !!fileStream.good() << endl;
-        cout << "        fstream failbit: " << !!fileStream.fail() << endl;
-        throw runtime_error("文件系统异常。");
-    }
+        while (!copyFileRangeUnsupported && bytesCopied < fullBlockBytes) {
+            ssize_t n = copy_file_range(
+                hostFd, &inOffset, imgFd, &outOffset, fullBlockBytes - bytesCopied, 0
+            );
 
-    fileSystemLoaded = true;
-    inodeIdxStack.clear();
-    inodeIdxStack.push_back(ROOT_INODE_IDX);
-}
+            if (n > 0) {
+                bytesCopied += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                if (n < 0 && (errno == ENOSYS || errno == EXDEV 
+                    || errno == EOPNOTSUPP || errno == EINVAL)
+                ) {
+                    copyFileRangeUnsupported = true;
+                }
 
-void FileSystemAdapter::sync() {
-    this->superBlock.writeToImg(this->fileStream);
+                break;
+            }
+        }
 
-    this->fileStream.clear();
-    this->fileStream.seekp(
-        this->superBlock.inode_zone_begin * sizeof(Block),
-        ios::beg
-    );
+        // sendfile 从 imgFd 的读写位置开始写，需要独占读写位置。
+        unique_lock<mutex> seekLock(streamMutex);
+        if (bytesCopied < fullBlockBytes && !sendFileUnsupported 
+            && lseek(imgFd, outOffset, SEEK_SET) == outOffset
+        ) {
+            while (bytesCopied < fullBlockBytes) {
+                ssize_t n = sendfile(imgFd, hostFd, &inOffset, fullBlockBytes - bytesCopied);
+
+                if (n > 0) {
+                    bytesCopied += n;
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    if (n < 0 && (errno == ENOSYS || errno == EINVAL)) {
+                        sendFileUnsupported = true;
+                    }
+
+                    break;
+                }
+            }
+        }
 
-    fileStream.write((char*) this->inodes, this->superBlock.inode_zone_blocks * sizeof(Block));
-}
+        seekLock.unlock();
 
-/**
- * 格式化。
- */
-void FileSystemAdapter::format() {
-    this->superBlock.loadDefaultProfile(); // 重置 superblock。
+        // 只保留完整的盘块，剩下的交给缓冲拷贝重做。
+        bytesCopied = bytesCopied / sizeof(Block) * sizeof(Block);
+
+    #ifdef V6PP_WITH_STATS
+        // 内核态拷贝不经过 writeBlocks，单独计入。
+        if (bytesCopied > 0) {
+            ioStats.record(
+                IoStats::WRITE_BLOCKS, 
+                duration_cast<nanoseconds>(steady_clock::now() - copyBegin).count(),
+                blockIdx, bytesCopied / sizeof(Block)
+            );
+        }
+    #endif
+
+        if (bytesCopied > 0 && blockTrace != nullptr) {
+            blockTrace->record(BlockTrace::WRITE, blockIdx, bytesCopied / sizeof(Block));
+        }
+
+        if (bytesCopied > 0 && Tracer::instance().active()) {
+            Tracer& tracer = Tracer::instance();
+            uint64_t endNs = tracer.now();
+            uint64_t durationNs = duration_cast<nanoseconds>(steady_clock::now() - copyBegin).count();
+            tracer.recordIo(
+                true, blockIdx, bytesCopied / sizeof(Block), 
+                endNs - min(endNs, durationNs), durationNs
+            );
+        }
+    }
+#endif
+
+    int blocksCopied = bytesCopied / sizeof(Block);
+    if (blocksCopied == blockCount) {
+        return true;
+    }
+
+    // 缓冲拷贝剩余部分。
+    vector<char> buffer((blockCount - blocksCopied) * sizeof(Block), 0);
+    long long bytesToRead = hostBytes - bytesCopied;
+    long long bytesRead = 0;
+
+#ifdef __linux__
+    while (bytesRead < bytesToRead) {
+        ssize_t n = pread(
+            hostFd, buffer.data() + bytesRead, 
+            bytesToRead - bytesRead, hostOffset + bytesCopied + bytesRead
+        );
+
+        if (n > 0) {
+            bytesRead += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+#endif
+
+    bool result = this->writeBlocks(buffer.data(), blockIdx + blocksCopied, blockCount - blocksCopied);
+    return result && bytesRead == bytesToRead;
+}
+
+void FileSystemAdapter::load() {
+    BlockTraceTag tag(BlockTrace::TAG_METADATA);
+
+    // superblock 和 inode 区都经过盘块读写接口，覆盖层模式下才能读到最新的内容。
+    this->readBlocks(
+        this->superBlock.asCharArray(), 
+        MachineProps::KERNEL_AND_BOOT_BLOCKS, 
+        sizeof(SuperBlock) / sizeof(Block)
+    );
+
+    int inodeZoneBlocks = this->superBlock.inode_zone_blocks;
+
+    if (inodeZoneBlocks * sizeof(Block) > sizeof(this->inodes) 
+        || !this->readBlocks((char*) this->inodes, this->superBlock.inode_zone_begin, inodeZoneBlocks)
+    ) {
+        console << "[error] exception on loading inodes." << endl;
+        console << "        inode zone begin:  " << this->superBlock.inode_zone_begin << endl;
+        console << "        inode zone blocks: " << inodeZoneBlocks << endl;
+        throw runtime_error("文件系统异常。");
+    }
+
+    fileSystemLoaded = true;
+    session().inodeIdxStack.assign(1, ROOT_INODE_IDX);
+
+    // 映像旁有缓存文件时自动使用。过期的缓存会在 sync 时重新生成。
+    metadataDirty = false;
+    if (cache != nullptr) {
+        delete cache;
+        cache = nullptr;
+    }
+
+    string cachePath = sidecarPath(".cache");
+    if (ifstream(cachePath).is_open()) {
+        cacheEnabled = true;
+        cache = SidecarCache::open(cachePath, superBlock.s_time, metadataChecksum());
+    }
+}
+
+void FileSystemAdapter::sync() {
+    if (readOnly) {
+        return;
+    }
+
+    V6PP_STAT_SCOPE(ioStats, SYNC, -1, 0);
+    V6PP_TRACE_SCOPE("sync", "");
+    BlockTraceTag tag(BlockTrace::TAG_METADATA);
+    lock_guard<recursive_mutex> allocLock(allocMutex);
+
+    if (allocPolicy != nullptr) {
+        // 策略位图才是准确的空闲表。生成一份内核可用的 s_free 与空闲盘块链。
+        this->tidyFreeLists();
+    }
+
+    if (metadataDirty) {
+        superBlock.s_time = getCurrentTimeStamp();
+    }
+
+    if (overlay != nullptr) {
+        // 覆盖层模式：只写入内容有变化的盘块，保持覆盖层小巧。
+        auto writeChangedBlocks = [this] (const char* buffer, int blockIdx, int blockCount) {
+            vector<char> current(blockCount * sizeof(Block));
+            this->readBlocks(current.data(), blockIdx, blockCount);
+
+            for (int idx = 0; idx < blockCount; idx++) {
+                int offset = idx * sizeof(Block);
+                if (!Block::isEqual(buffer + offset, current.data() + offset, sizeof(Block))) {
+                    this->writeBlocks(buffer + offset, blockIdx + idx, 1);
+                }
+            }
+        };
+
+        writeChangedBlocks(
+            this->superBlock.asCharArray(), 
+            MachineProps::KERNEL_AND_BOOT_BLOCKS, 
+            sizeof(SuperBlock) / sizeof(Block)
+        );
+
+        writeChangedBlocks(
+            (char*) this->inodes, 
+            this->superBlock.inode_zone_begin, 
+            this->superBlock.inode_zone_blocks
+        );
+
+        overlay->flush();
+        saveSidecars();
+        return;
+    }
+
+    this->writeBlocks(
+        this->superBlock.asCharArray(), 
+        MachineProps::KERNEL_AND_BOOT_BLOCKS, 
+        sizeof(SuperBlock) / sizeof(Block)
+    );
+
+    this->writeBlocks(
+        (char*) this->inodes, 
+        this->superBlock.inode_zone_begin, 
+        this->superBlock.inode_zone_blocks
+    );
+
+    saveSidecars();
+}
+
+void FileSystemAdapter::saveSidecars() {
+    if (ownerMap != nullptr) {
+        ownerMap->save(sidecarPath(".owners"), metadataChecksum());
+    }
+
+    if (cacheEnabled && (metadataDirty || cache == nullptr)) {
+        if (cache != nullptr) {
+            delete cache;
+            cache = nullptr;
+        }
+
+        string cachePath = sidecarPath(".cache");
+        if (SidecarCache::save(cachePath, *this)) {
+            cache = SidecarCache::open(cachePath, superBlock.s_time, metadataChecksum());
+        }
+    }
+
+    metadataDirty = false;
+}
+
+/**
+ * 格式化。
+ */
+void FileSystemAdapter::format() {
+    V6PP_TRACE_SCOPE("format", "");
+    BlockTraceTag tag(BlockTrace::TAG_FORMAT);
+
+    this->superBlock.loadDefaultProfile(); // 重置 superblock。
 
     // 释放 inode。
 
@@ -498,8 +1188,8 @@ void FileSystemAdapter::format() {
 
     // 创建 root 目录，并写入 dev/tty1。
     
-    inodeIdxStack.clear();
-    inodeIdxStack.push_back(ROOT_INODE_IDX);
+    vector<int>& inodeIdxStack = session().inodeIdxStack;
+    inodeIdxStack.assign(1, ROOT_INODE_IDX);
     Inode& rootInode = this->inodes[ROOT_INODE_IDX];
 
     rootInode.permission_group = 7;
@@ -526,6 +1216,7 @@ void FileSystemAdapter::format() {
 }
 
 void FileSystemAdapter::writeKernel(fstream& kernelFile) {
+    BlockTraceTag tag(BlockTrace::TAG_BOOT);
     int kernelSize = MachineProps::BLOCK_SIZE * MachineProps::KERNEL_BIN_BLOCKS;
     // 申请缓冲区。不做失败检查，让其自然抛异常。
     char* buffer = new char[kernelSize];
@@ -538,6 +1229,7 @@ void FileSystemAdapter::writeKernel(fstream& kernelFile) {
 }
 
 void FileSystemAdapter::writeBootLoader(fstream& bootLoaderFile) {
+    BlockTraceTag tag(BlockTrace::TAG_BOOT);
     
     int bootloaderSize = MachineProps::BLOCK_SIZE * MachineProps::BOOT_LOADER_BLOCKS;
     // 申请缓冲区。不做失败检查，让其自然抛异常。另外，如果 512个字节都拿不到，也没什么可玩的了...
@@ -550,13 +1242,73 @@ void FileSystemAdapter::writeBootLoader(fstream& bootLoaderFile) {
     delete[] buffer;
 }
 
+bool FileSystemAdapter::writeKernel(const string& kernelFilePath) {
+    BlockTraceTag tag(BlockTrace::TAG_BOOT);
+#ifdef __linux__
+    int kernelFd = open(kernelFilePath.c_str(), O_RDONLY);
+    if (kernelFd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    bool result = fstat(kernelFd, &st) == 0 && this->copyFromHostFile(
+        kernelFd, 0, st.st_size, 1, MachineProps::KERNEL_BIN_BLOCKS
+    );
+
+    close(kernelFd);
+    return result;
+#else
+    fstream kernelFile(kernelFilePath, ios::in | ios::binary);
+    if (!kernelFile.is_open()) {
+        return false;
+    }
+
+    this->writeKernel(kernelFile);
+    return true;
+#endif
+}
+
+bool FileSystemAdapter::writeBootLoader(const string& bootLoaderFilePath) {
+    BlockTraceTag tag(BlockTrace::TAG_BOOT);
+#ifdef __linux__
+    int bootLoaderFd = open(bootLoaderFilePath.c_str(), O_RDONLY);
+    if (bootLoaderFd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    bool result = fstat(bootLoaderFd, &st) == 0 && this->copyFromHostFile(
+        bootLoaderFd, 0, st.st_size, 0, MachineProps::BOOT_LOADER_BLOCKS
+    );
+
+    close(bootLoaderFd);
+    return result;
+#else
+    fstream bootLoaderFile(bootLoaderFilePath, ios::in | ios::binary);
+    if (!bootLoaderFile.is_open()) {
+        return false;
+    }
+
+    this->writeBootLoader(bootLoaderFile);
+    return true;
+#endif
+}
+
 /* ------------ 盘块和 inode 获取与释放。 ------------ */
 int FileSystemAdapter::getFreeBlock() {
+    V6PP_STAT_SCOPE(ioStats, GET_FREE_BLOCK, -1, 1);
+    lock_guard<recursive_mutex> allocLock(allocMutex);
+    BlockTraceTag tag(BlockTrace::TAG_FREE_LIST);
+    AllocationContext& allocContext = session().allocContext;
     int ret;
+    metadataDirty = true;
 
-    if (superBlock.s_nfree == 0) {
+    if (allocPolicy != nullptr) {
 
-        ret = -1; // 无空盘块。
+        ret = allocPolicy->allocateBlock(*this, allocContext);
+    } else if (superBlock.s_nfree == 0 || (superBlock.s_nfree == 1 && superBlock.s_free[0] == 0)) {
+
+        ret = -1; // 无空盘块。s_free[0] 为 0 表示链已到头。
     } else if (superBlock.s_nfree >= 2) {
 
         ret = superBlock.s_free[--superBlock.s_nfree];
@@ -569,14 +1321,23 @@ int FileSystemAdapter::getFreeBlock() {
         ret = result;
     }
 
-    if (ret >= MachineProps::diskBlocks()) {
-        cout << "[critical 2] FSA::getFreeBlock" << endl;
-        cout << "             ret: " << ret << endl;
-        cout << "s_nfree: " << superBlock.s_nfree << endl;
+    if (ret >= (int) MachineProps::diskBlocks()) {
+        console << "[critical 2] FSA::getFreeBlock" << endl;
+        console << "             ret: " << ret << endl;
+        console << "s_nfree: " << superBlock.s_nfree << endl;
         for (int i = 0; i < 100; i++) {
-            cout << "[" << i << "] " << superBlock.s_free[i] << endl;
+            console << "[" << i << "] " << superBlock.s_free[i] << endl;
         }
-        exit(-1);
+        throw runtime_error("free list holds an out-of-range block.");
+    }
+
+    if (ownerMap != nullptr && ret > 0) {
+        ownerMap->clear(ret);
+    }
+
+    if (ret > 0) {
+        allocContext.goal = ret + 1;
+        allocContext.blocksWanted = max(1, allocContext.blocksWanted - 1);
     }
 
     return ret;
@@ -586,13 +1347,27 @@ int FileSystemAdapter::getFreeBlock() {
 void FileSystemAdapter::freeBlock(int idx) {
 
     if (idx >= MachineProps::diskBlocks()) {
-        cout << "[critical 3] FSA::freeBlock" << endl;
-        cout << "             idx: " << idx << endl;
-        cout << "s_nfree: " << superBlock.s_nfree << endl;
+        console << "[critical 3] FSA::freeBlock" << endl;
+        console << "             idx: " << idx << endl;
+        console << "s_nfree: " << superBlock.s_nfree << endl;
         for (int i = 0; i < 100; i++) {
-            cout << "[" << i << "] " << superBlock.s_free[i] << endl;
+            console << "[" << i << "] " << superBlock.s_free[i] << endl;
         }
-        exit(-1);
+        throw runtime_error("freeing an out-of-range block.");
+    }
+
+    V6PP_STAT_SCOPE(ioStats, FREE_BLOCK, -1, 1);
+    lock_guard<recursive_mutex> allocLock(allocMutex);
+    BlockTraceTag tag(BlockTrace::TAG_FREE_LIST);
+    metadataDirty = true;
+
+    if (ownerMap != nullptr) {
+        ownerMap->clear(idx);
+    }
+
+    if (allocPolicy != nullptr) {
+        allocPolicy->releaseBlock(idx);
+        return;
     }
 
     if (superBlock.s_nfree == 0) {
@@ -615,24 +1390,39 @@ void FileSystemAdapter::freeBlock(int idx) {
 }
 
 int FileSystemAdapter::getFreeInode() {
+    V6PP_STAT_SCOPE(ioStats, GET_FREE_INODE, -1, 0);
+    lock_guard<recursive_mutex> allocLock(allocMutex);
     auto searchForFreeInodes = [&] () {
+        SidecarCache* cache = this->warmCache();
         for (
             int idx = ROOT_INODE_IDX + 1; 
             idx < sizeof(this->inodes) / sizeof(Inode) && superBlock.s_ninode < 100;
             idx++
         ) {
-            if (this->inodes[idx].ialloc == 0) {
+            bool isFree = cache != nullptr ? cache->isInodeFree(idx) : this->inodes[idx].ialloc == 0;
+            if (isFree) {
                 superBlock.s_inode[superBlock.s_ninode++] = idx;
             }
         }
     };
 
-    if (superBlock.s_ninode == 0) { // 寻找空盘 inode。
-        searchForFreeInodes();
+    int result = -1;
+    if (allocPolicy != nullptr) {
+        // s_inode 中可能留有被策略选走的 inode，sync 时会重新生成。
+        result = allocPolicy->pickInode(*this, session().allocContext);
+    } else {
+        if (superBlock.s_ninode == 0) { // 寻找空盘 inode。
+            searchForFreeInodes();
+        }
+
+        if (superBlock.s_ninode > 0) {
+            result = superBlock.s_inode[--superBlock.s_ninode];
+        }
     }
+
+    metadataDirty = true;
     
-    if (superBlock.s_ninode > 0) {
-        int result = superBlock.s_inode[--superBlock.s_ninode];
+    if (result > 0) {
 
         this->inodes[result].ialloc = 1; // 表示已经被分配。
         this->inodes[result].permission_group = 7;
@@ -647,7 +1437,7 @@ int FileSystemAdapter::getFreeInode() {
         this->inodes[result].d_mtime = getCurrentTimeStamp();
         this->inodes[result].d_atime = getCurrentTimeStamp();
         
-        if (superBlock.s_ninode == 0) { // 寻找空盘 inode。
+        if (allocPolicy == nullptr && superBlock.s_ninode == 0) { // 寻找空盘 inode。
             searchForFreeInodes();
         }
 
@@ -681,13 +1471,285 @@ void FileSystemAdapter::freeInodeBlocks(Inode& inode) {
     inode.d_size = 0;
 }
 
+int FileSystemAdapter::markLiveBlocks(vector<bool>& live) {
+    live.assign(MachineProps::diskBlocks(), false);
+    int liveCount = 0;
+
+    auto mark = [&] (unsigned int blockIdx) {
+        if (blockIdx < live.size() && !live[blockIdx]) {
+            live[blockIdx] = true;
+            liveCount++;
+        }
+    };
+
+    // 启动引导区、内核区、SuperBlock 区和 Inode 区。
+    for (int idx = 0; idx < superBlock.data_zone_begin; idx++) {
+        mark(idx);
+    }
+
+    // 文件数据块和索引块。
+    for (int idx = 0; idx < sizeof(this->inodes) / sizeof(Inode); idx++) {
+        Inode& inode = this->inodes[idx];
+        if (!inode.ialloc || inode.d_size == 0) {
+            continue;
+        }
+
+        this->iterateOverInodeDataBlocks(
+            inode,
+            [] (...) {},
+            [] (int prevBlockIdx) { return prevBlockIdx; },
+            [] (...) {},
+            [&] (int dataBlockIdx) { mark(dataBlockIdx); },
+            [&] (const char*, int blockIndex) { mark(blockIndex); }
+        );
+    }
+
+    // 空闲盘块链。链接块本身是空闲盘块，但记录着下一组空闲盘块号，不能丢。
+    if (superBlock.s_nfree > 0) {
+        uint32_t chainBlockIdx = superBlock.s_free[0];
+        Block b;
+        while (chainBlockIdx != 0 && chainBlockIdx < live.size() && !live[chainBlockIdx]) {
+            mark(chainBlockIdx);
+            readBlock(b, chainBlockIdx);
+            
+            uint32_t nfree;
+            memcpy(&nfree, b.bytes, sizeof(nfree));
+            if (nfree == 0) {
+                break;
+            }
+
+            memcpy(&chainBlockIdx, b.bytes + sizeof(uint32_t), sizeof(uint32_t));
+        }
+    }
+
+    return liveCount;
+}
+
+int FileSystemAdapter::tidyFreeLists() {
+    lock_guard<recursive_mutex> allocLock(allocMutex);
+    metadataDirty = true;
+
+    // 旧的空闲链作废。s_nfree 为 0 时，链接块不会被标记为在用，一并回收。
+    superBlock.s_nfree = 0;
+    vector<bool> live;
+    this->markLiveBlocks(live);
+
+    vector<int> freeBlocks;
+    for (
+        int idx = superBlock.data_zone_begin; 
+        idx < superBlock.data_zone_begin + superBlock.data_zone_blocks; 
+        idx++
+    ) {
+        if (!live[idx]) {
+            freeBlocks.push_back(idx);
+        }
+    }
+
+    // 与 format 相同，倒序登记。与 freeBlock 不同的是链接块先留在内存里。
+    vector<pair<int, Block>> chainBlocks;
+    for (auto it = freeBlocks.rbegin(); it != freeBlocks.rend(); it++) {
+        if (superBlock.s_nfree == 0) {
+            superBlock.s_free[0] = 0;
+            superBlock.s_nfree = 1;
+        }
+
+        if (superBlock.s_nfree < 100) {
+            superBlock.s_free[superBlock.s_nfree++] = *it;
+        } else {
+            chainBlocks.emplace_back(*it, Block());
+            memcpy(&chainBlocks.back().second, &superBlock.s_nfree, 101 * sizeof(uint32_t));
+
+            superBlock.s_nfree = 1;
+            superBlock.s_free[0] = *it;
+        }
+    }
+
+    // 链接块是倒序生成的，反过来就是升序。
+    BlockTraceTag tag(BlockTrace::TAG_FREE_LIST);
+    for (auto it = chainBlocks.rbegin(); it != chainBlocks.rend(); it++) {
+        writeBlock(it->second, it->first);
+    }
+
+    // 空闲 inode 表：编号最小的在栈顶，最先分配。
+    vector<int> freeInodes;
+    for (
+        int idx = ROOT_INODE_IDX + 1; 
+        idx < sizeof(this->inodes) / sizeof(Inode) && freeInodes.size() < 100; 
+        idx++
+    ) {
+        if (this->inodes[idx].ialloc == 0) {
+            freeInodes.push_back(idx);
+        }
+    }
+
+    superBlock.s_ninode = freeInodes.size();
+    for (int idx = 0; idx < freeInodes.size(); idx++) {
+        superBlock.s_inode[idx] = freeInodes[freeInodes.size() - 1 - idx];
+    }
+
+    // 新的链接块落在了空闲盘块上，策略位图需要同步。
+    if (allocPolicy != nullptr) {
+        allocPolicy->build(*this);
+    }
+
+    return freeBlocks.size();
+}
+
+bool FileSystemAdapter::setAllocationPolicy(const string& name) {
+    AllocationPolicy* policy = nullptr;
+    if (name != "stack") {
+        policy = AllocationPolicy::create(name);
+        if (policy == nullptr) {
+            return false;
+        }
+    }
+
+    if (allocPolicy != nullptr) {
+        // 回到栈式分配之前，先把空闲表整理成有效的状态。
+        this->tidyFreeLists();
+        delete allocPolicy;
+    }
+
+    allocPolicy = policy;
+    if (allocPolicy != nullptr) {
+        allocPolicy->build(*this);
+    }
+
+    return true;
+}
+
+uint64_t FileSystemAdapter::metadataChecksum() {
+    // FNV-1a。
+    uint64_t hash = 14695981039346656037ULL;
+    auto feed = [&] (const void* data, size_t length) {
+        const uint8_t* p = (const uint8_t*) data;
+        for (size_t idx = 0; idx < length; idx++) {
+            hash = (hash ^ p[idx]) * 1099511628211ULL;
+        }
+    };
+
+    feed(&this->superBlock, sizeof(SuperBlock));
+    feed(this->inodes, sizeof(this->inodes));
+    return hash;
+}
+
+string FileSystemAdapter::sidecarPath(const char* suffix) {
+    return (overlay != nullptr ? overlay->path : imgFilePath) + suffix;
+}
+
+bool FileSystemAdapter::enableOwnerMap() {
+    if (ownerMap == nullptr) {
+        ownerMap = new BlockOwnerMap(MachineProps::diskBlocks());
+    }
+
+    if (ownerMap->load(sidecarPath(".owners"), metadataChecksum())) {
+        return true;
+    }
+
+    if (warmCache() != nullptr) {
+        memcpy(ownerMap->owners.data(), cache->owners(), cache->diskBlocks() * sizeof(BlockOwner));
+        return true;
+    }
+
+    ownerMap->build(*this);
+    return false;
+}
+
+int FileSystemAdapter::lookupEntry(int dirIno, const string& name) {
+    if (warmCache() != nullptr) {
+        return cache->lookup(dirIno, name);
+    }
+
+    shared_lock<shared_mutex> lock(inodeLock(dirIno));
+    DirectoryView dir(this->inodes[dirIno], *this);
+    const DirectoryEntry* entry = dir.find(name);
+    return entry == nullptr ? 0 : entry->m_ino;
+}
+
+bool FileSystemAdapter::setBlockTrace(const string& path) {
+    if (blockTrace != nullptr) {
+        delete blockTrace;
+        blockTrace = nullptr;
+    }
+
+    if (path.empty()) {
+        return true;
+    }
+
+    blockTrace = BlockTrace::create(path);
+    return blockTrace != nullptr;
+}
+
+void FileSystemAdapter::setCacheEnabled(bool enabled) {
+    cacheEnabled = enabled;
+    if (enabled) {
+        return;
+    }
+
+    if (cache != nullptr) {
+        delete cache;
+        cache = nullptr;
+    }
+
+    remove(sidecarPath(".cache").c_str());
+}
+
+string FileSystemAdapter::pathOfInode(int ino) {
+    if (ino == ROOT_INODE_IDX) {
+        return "/";
+    }
+
+    // 按层搜索，记录每个目录的路径。
+    vector<pair<int, string>> frontier = { {ROOT_INODE_IDX, ""} };
+    vector<bool> visited(sizeof(this->inodes) / sizeof(Inode), false);
+    visited[ROOT_INODE_IDX] = true;
+
+    while (!frontier.empty()) {
+        vector<pair<int, string>> next;
+
+        for (const auto& [dirIno, dirPath] : frontier) {
+            shared_lock<shared_mutex> lock(inodeLock(dirIno));
+            DirectoryView dir(this->inodes[dirIno], *this);
+            string found;
+
+            dir.forEach([&] (const DirectoryEntry& entry) {
+                string name(entry.m_name, strnlen(entry.m_name, DirectoryEntry::DIRSIZE));
+                if (!found.empty() || name == "." || name == ".." || entry.m_ino >= visited.size()) {
+                    return;
+                }
+
+                string path = dirPath + "/" + name;
+                if (entry.m_ino == ino) {
+                    found = path;
+                    return;
+                }
+
+                if (!visited[entry.m_ino] && this->inodes[entry.m_ino].file_type == Inode::FileType::DIR) {
+                    visited[entry.m_ino] = true;
+                    next.push_back({ (int) entry.m_ino, path });
+                }
+            });
+
+            if (!found.empty()) {
+                return found;
+            }
+        }
+
+        frontier.swap(next);
+    }
+
+    return "";
+}
+
 void FileSystemAdapter::freeInode(int idx, bool freeBlocks) {
     Inode& inode = this->inodes[idx];
+    metadataDirty = true;
     
     if (freeBlocks) {
         this->freeInodeBlocks(inode);
     }
 
+    lock_guard<recursive_mutex> allocLock(allocMutex);
     inode.loadEmptyProfile();
 
     if (superBlock.s_ninode < 100) {
@@ -698,31 +1760,30 @@ void FileSystemAdapter::freeInode(int idx, bool freeBlocks) {
 
 /* ------------ 文件系统用户界面操作。 ------------ */
 
-void FileSystemAdapter::ls(const InodeDirectory& dir) {
-    for (int idx = 0; idx < dir.length; idx++) {
-        const DirectoryEntry& entry = dir.entries[idx];
+void FileSystemAdapter::ls(const DirectoryView& dir) {
+    dir.forEach([&] (const DirectoryEntry& entry) {
         const Inode& entryInode = this->inodes[entry.m_ino];
 
         // 文件类型。
         switch (entryInode.file_type) {
             case Inode::FileType::BLOCK_DEV:
-                cout << 'b';
+                console << 'b';
                 break;
 
             case Inode::FileType::CHAR_DEV:
-                cout << 'c';
+                console << 'c';
                 break;
 
             case Inode::FileType::DIR:
-                cout << 'd';
+                console << 'd';
                 break;
 
             case Inode::FileType::NORMAL:
-                cout << '-';
+                console << '-';
                 break;
             
             default:
-                cout << '?';
+                console << '?';
                 break;
         }
 
@@ -736,51 +1797,53 @@ void FileSystemAdapter::ls(const InodeDirectory& dir) {
 
         for (int i = 0; i < 3; i++) {
             int& permission = permissionVars[i];
-            cout << ((permission & 4) ? 'r' : '-');
-            cout << ((permission & 2) ? 'w' : '-');
-            cout << ((permission & 1) ? 'x' : '-');
+            console << ((permission & 4) ? 'r' : '-');
+            console << ((permission & 2) ? 'w' : '-');
+            console << ((permission & 1) ? 'x' : '-');
         }
 
         // 软链接数。
-        cout << setiosflags(ios::right);
-        cout << setw(4) << entryInode.d_nlink;
+        console << setiosflags(ios::right);
+        console << setw(4) << entryInode.d_nlink;
 
         // 文件主。
-        cout << setw(3) << entryInode.d_gid << " :";
-        cout << setw(3) << entryInode.d_uid;
+        console << setw(3) << entryInode.d_gid << " :";
+        console << setw(3) << entryInode.d_uid;
 
         // 文件大小。
-        cout << setw(8) << entryInode.d_size;
+        console << setw(8) << entryInode.d_size;
 
         // 修改时间。
-        cout << setw(12) << entryInode.d_mtime << ".m";
+        console << setw(12) << entryInode.d_mtime << ".m";
         
         // 访问时间。
-        cout << setw(12) << entryInode.d_atime << ".a";
+        console << setw(12) << entryInode.d_atime << ".a";
 
         // 文件名。
-        cout << " " << entry.m_name << endl;
+        console << " " << string(entry.m_name, strnlen(entry.m_name, DirectoryEntry::DIRSIZE)) << endl;
         
-        cout << resetiosflags(ios::right);
-    }
+        console << resetiosflags(ios::right);
+    });
 }
 
 void FileSystemAdapter::ls(Inode& inode) {
+    shared_lock<shared_mutex> lock(inodeLock(&inode - this->inodes));
     try {
-        this->ls(InodeDirectory(inode, *this, true));
+        DirectoryView dir(inode, *this);
+        this->ls(dir);
     } catch (const runtime_error& e) {
-        cout << "[error] FSA::ls Inode& exception: " << e.what() << endl;
+        console << "[error] FSA::ls Inode& exception: " << e.what() << endl;
     }
 }
 
 void FileSystemAdapter::ls() {
-    this->ls(this->inodes[inodeIdxStack.back()]);
+    this->ls(this->inodes[session().inodeIdxStack.back()]);
 }
 
 void FileSystemAdapter::ls(const vector<string>& pathSegments, bool fromRoot) {
-    int currInodeIdx = fromRoot ? FileSystemAdapter::ROOT_INODE_IDX : inodeIdxStack.back();
+    int currInodeIdx = fromRoot ? FileSystemAdapter::ROOT_INODE_IDX : session().inodeIdxStack.back();
 
-    cout << "[info] 正在打开：" << (fromRoot ? "根目录" : "当前目录") << endl;
+    console << "[info] 正在打开：" << (fromRoot ? "根目录" : "当前目录") << endl;
 
     for (const auto& seg : pathSegments) {
         if (seg == ".") {
@@ -789,27 +1852,20 @@ void FileSystemAdapter::ls(const vector<string>& pathSegments, bool fromRoot) {
 
         // 确保当前路径是个目录。
         if (currInodeIdx != 0 && this->inodes[currInodeIdx].file_type != Inode::FileType::DIR) {
-            cout << "[error] 该路径不是文件夹。拒绝执行指令。" << endl;
-            cout << "        路径类型为：" << inodes[currInodeIdx].file_type << endl;
+            console << "[error] 该路径不是文件夹。拒绝执行指令。" << endl;
+            console << "        路径类型为：" << inodes[currInodeIdx].file_type << endl;
             return;
         }
 
         // 寻找下一个目录。
-        bool nextDirFound = false;
-        InodeDirectory dir(this->inodes[currInodeIdx], *this, true);
-        for (int entryIdx = 0; entryIdx < dir.length; entryIdx++) {
-            if (dir.entries[entryIdx].m_name == seg) {
-                cout << "[info] 进入：" << seg << endl;
-                currInodeIdx = dir.entries[entryIdx].m_ino;
-                nextDirFound = true;
-                break;
-            }
-        }
-
-        if (!nextDirFound) {
-            cout << "[error] 找不到：" << seg << endl;
+        int nextInodeIdx = this->lookupEntry(currInodeIdx, seg);
+        if (nextInodeIdx <= 0) {
+            console << "[error] 找不到：" << seg << endl;
             return;
         }
+
+        console << "[info] 进入：" << seg << endl;
+        currInodeIdx = nextInodeIdx;
     }
 
     ls(inodes[currInodeIdx]);
@@ -818,6 +1874,7 @@ void FileSystemAdapter::ls(const vector<string>& pathSegments, bool fromRoot) {
 
 
 bool FileSystemAdapter::cd(const string& folderName) {
+    vector<int>& inodeIdxStack = session().inodeIdxStack;
     if (folderName == "\\" || folderName == "/") {
         inodeIdxStack.clear();
         inodeIdxStack.push_back(ROOT_INODE_IDX);
@@ -834,30 +1891,26 @@ bool FileSystemAdapter::cd(const string& folderName) {
         }
     }
 
-    InodeDirectory dir(this->inodes[inodeIdxStack.back()], *this, true);
-    
-    for (int entryIdx = 0; entryIdx < dir.length; entryIdx++) {
-        
-        if (dir.entries[entryIdx].m_name == folderName) {
-            Inode& inode = this->inodes[dir.entries[entryIdx].m_ino];
-            if (inode.file_type != Inode::FileType::DIR) {
-                cout << "[error] 名字：" << folderName << " 不是文件夹。" << endl;
-                return false;
-            } else {
-                inodeIdxStack.push_back(dir.entries[entryIdx].m_ino);
-                return true;
-            }
+    int inodeIdx = this->lookupEntry(inodeIdxStack.back(), folderName);
+    if (inodeIdx > 0) {
+        Inode& inode = this->inodes[inodeIdx];
+        if (inode.file_type != Inode::FileType::DIR) {
+            console << "[error] 名字：" << folderName << " 不是文件夹。" << endl;
+            return false;
+        } else {
+            inodeIdxStack.push_back(inodeIdx);
+            return true;
         }
     }
 
-    cout << "[error] 找不到：" << folderName << endl;
+    console << "[error] 找不到：" << folderName << endl;
     return false;
 }
 
 int FileSystemAdapter::mkdir(const string& dirName) {
     int inodeIdx = touch(dirName, Inode::FileType::DIR);
     if (inodeIdx < 0) {
-        cout << "[error] 无法创建文件夹。" << endl;
+        console << "[error] 无法创建文件夹。" << endl;
         return -1;
     } else {
         Inode& inode = this->inodes[inodeIdx];
@@ -867,23 +1920,52 @@ int FileSystemAdapter::mkdir(const string& dirName) {
 }
 
 int FileSystemAdapter::removeChildren(Inode& inode) {
+    int inodeIdx = &inode - this->inodes;
+
+    // 等待正在读取该文件的使用者结束。
+    unique_lock<shared_mutex> lock(inodeLock(inodeIdx));
+
+    // 还有其他目录项指向该文件（硬链接）时，只减少链接数。
+    if (inode.file_type != Inode::FileType::DIR && inode.d_nlink > 1) {
+        inode.d_nlink--;
+        metadataDirty = true;
+        return 1;
+    }
+
     if (inode.d_size == 0) {
+        this->freeInode(inodeIdx);
         return 0;
     }
 
     if (inode.file_type != Inode::FileType::DIR) {
-        this->freeInodeBlocks(inode);
+        this->freeInode(inodeIdx, true);
         return 1;
     } else {
         int result = 0;
         
-        InodeDirectory dir(inode, *this, true, 1);
-        this->freeInodeBlocks(inode);
-        for (int entryIdx = 0; entryIdx < dir.length; entryIdx++) {
-            cout << "[info] 删除：" << dir.entries[entryIdx].m_name << endl;
-            result += removeChildren(inodes[dir.entries[entryIdx].m_ino]);
+        // 视图可能直接指向目录的盘块：先删除子项，最后释放目录自己的盘块。
+        {
+            DirectoryView dir(inode, *this);
+            dir.forEach([&] (const DirectoryEntry& entry) {
+                string name(entry.m_name, strnlen(entry.m_name, DirectoryEntry::DIRSIZE));
+
+                // 内核创建的目录含有 "." 与 ".."：它们指向自己和上级，递归进去会对已持有的锁再次加锁。
+                if (name == ".") {
+                    return;
+                } else if (name == "..") {
+                    if (inodes[entry.m_ino].d_nlink > 0) {
+                        inodes[entry.m_ino].d_nlink--;
+                    }
+
+                    return;
+                }
+
+                console << "[info] 删除：" << name << endl;
+                result += removeChildren(inodes[entry.m_ino]);
+            });
         }
-        
+
+        this->freeInode(inodeIdx, true);
         return result;
     }
 }
@@ -892,21 +1974,22 @@ int FileSystemAdapter::removeChildren(Inode& inode) {
  * rm -rf 
  */
 int FileSystemAdapter::rm(const std::string& path) {
-    InodeDirectory dir(this->inodes[inodeIdxStack.back()], *this, true, 1);
-    
-    int targetIdx = -1;
-    int entryIdx;
+    if (path == "." || path == "..") {
+        console << "[error] 不能删除 . 或 ..：" << path << endl;
+        return 0;
+    }
 
+    int dirIno = session().inodeIdxStack.back();
+    unique_lock<shared_mutex> lock(inodeLock(dirIno));
+    InodeDirectory dir(this->inodes[dirIno], *this, true, 1);
+    
     // 寻找删除目标。
-    for (entryIdx = 0; entryIdx < dir.length; entryIdx++) {
-        if (dir.entries[entryIdx].m_name == path) {
-            targetIdx = dir.entries[entryIdx].m_ino;
-            break;
-        }
-    }
+    int entryIdx = dir.find(path);
+    int targetIdx = entryIdx < 0 ? -1 : dir.entries[entryIdx].m_ino;
 
     if (targetIdx < 0) {
-        cout << "[error] 找不到：" << path << endl;
+        console << "[error] 找不到：" << path << endl;
+        return 0;
     }
 
     Inode& targetInode = this->inodes[targetIdx];
@@ -921,7 +2004,7 @@ int FileSystemAdapter::rm(const std::string& path) {
 
     this->writeFile(
         (char*) dir.entries, 
-        this->inodes[inodeIdxStack.back()], 
+        this->inodes[dirIno], 
         dir.length * sizeof(DirectoryEntry)
     );
 
@@ -930,23 +2013,24 @@ int FileSystemAdapter::rm(const std::string& path) {
 
 
 int FileSystemAdapter::touch(const std::string& fileName, Inode::FileType type) {
-
-    InodeDirectory dir(this->inodes[inodeIdxStack.back()], *this, false, 1);
+    int dirIno = session().inodeIdxStack.back();
+    unique_lock<shared_mutex> lock(inodeLock(dirIno));
+    InodeDirectory dir(this->inodes[dirIno], *this, false, 1);
     
     // 同名校验。
-    for (int entryIdx = 0; entryIdx < dir.length; entryIdx++) {
-        if (dir.entries[entryIdx].m_name == fileName) {
-            cout << "[info] 该文件已存在。" << endl;
-            return dir.entries[entryIdx].m_ino;
-        }
+    int existingIdx = dir.find(fileName);
+    if (existingIdx >= 0) {
+        console << "[info] 该文件已存在。" << endl;
+        return dir.entries[existingIdx].m_ino;
     }
 
     // 新建。
+    session().allocContext.parentIno = dirIno;
     int inodeIdx = this->getFreeInode();
 
 
     if (inodeIdx < 0) {
-        cout << "[error] 无法获取空 inode。" << endl;
+        console << "[error] 无法获取空 inode。" << endl;
         return -1;
     } else {
         Inode& inode = this->inodes[inodeIdx];
@@ -963,10 +2047,676 @@ int FileSystemAdapter::touch(const std::string& fileName, Inode::FileType type)
 
         this->writeFile(
             (char*) dir.entries, 
-            this->inodes[inodeIdxStack.back()], 
+            this->inodes[dirIno], 
             dir.length * sizeof(DirectoryEntry)
         );
 
         return inodeIdx;
     }
 }
+
+bool FileSystemAdapter::resolvePath(const string& path, vector<int>& dirChain, string& name) {
+    vector<string> segments;
+    size_t begin = 0;
+    while (begin <= path.length()) {
+        size_t end = path.find_first_of("\\/", begin);
+        if (end == string::npos) {
+            end = path.length();
+        }
+
+        if (end > begin) {
+            segments.push_back(path.substr(begin, end - begin));
+        }
+
+        begin = end + 1;
+    }
+
+    if (!path.empty() && strchr("\\/", path[0])) {
+        dirChain.assign(1, ROOT_INODE_IDX);
+    } else {
+        dirChain = session().inodeIdxStack;
+        if (dirChain.empty()) {
+            dirChain.push_back(ROOT_INODE_IDX);
+        }
+    }
+
+    name.clear();
+    for (const string& seg : segments) {
+        if (!name.empty()) {
+            // 上一段作为目录进入。
+            int ino = this->lookupEntry(dirChain.back(), name);
+            if (ino <= 0 || this->inodes[ino].file_type != Inode::FileType::DIR) {
+                console << "[error] 不是文件夹或找不到：" << name << endl;
+                return false;
+            }
+
+            dirChain.push_back(ino);
+            name.clear();
+        }
+
+        if (seg == ".") {
+            continue;
+        } else if (seg == "..") {
+            if (dirChain.size() > 1) {
+                dirChain.pop_back();
+            }
+        } else {
+            name = seg;
+        }
+    }
+
+    return true;
+}
+
+bool FileSystemAdapter::mv(const string& srcPath, const string& dstPath) {
+    V6PP_TRACE_SCOPE("mv", srcPath);
+    lock_guard<mutex> renameLock(renameMutex);
+
+    vector<int> srcChain;
+    string srcName;
+    if (!this->resolvePath(srcPath, srcChain, srcName)) {
+        return false;
+    }
+
+    if (srcName.empty()) {
+        console << "[error] 不能移动根目录或当前路径上的目录：" << srcPath << endl;
+        return false;
+    }
+
+    int ino = this->lookupEntry(srcChain.back(), srcName);
+    if (ino <= 0) {
+        console << "[error] 找不到：" << srcPath << endl;
+        return false;
+    }
+
+    vector<int> dstChain;
+    string dstName;
+    if (!this->resolvePath(dstPath, dstChain, dstName)) {
+        return false;
+    }
+
+    // 目标是已有的目录：移入其中，保持原名。
+    int existingIdx = dstName.empty() ? dstChain.back() : this->lookupEntry(dstChain.back(), dstName);
+    if (existingIdx > 0 && this->inodes[existingIdx].file_type == Inode::FileType::DIR && existingIdx != ino) {
+        if (!dstName.empty()) {
+            dstChain.push_back(existingIdx);
+        }
+
+        dstName = srcName;
+        existingIdx = this->lookupEntry(dstChain.back(), dstName);
+    }
+
+    if (existingIdx == ino && dstChain.back() == srcChain.back() && dstName == srcName) {
+        return true; // 原地不动。
+    } else if (existingIdx > 0) {
+        console << "[error] 目标已存在：" << dstPath << endl;
+        return false;
+    }
+
+    if (!this->moveEntry(srcChain, srcName, ino, dstChain, dstName)) {
+        return false;
+    }
+
+    // 本工具创建的目录里没有 "." 与 ".." 目录项，上级目录由路径栈决定：移动的目录在当前路径上时，换成新的路径。
+    vector<int>& inodeIdxStack = session().inodeIdxStack;
+    for (int idx = 0; idx < inodeIdxStack.size(); idx++) {
+        if (inodeIdxStack[idx] == ino) {
+            dstChain.insert(dstChain.end(), inodeIdxStack.begin() + idx, inodeIdxStack.end());
+            inodeIdxStack.swap(dstChain);
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * 设置目录项的文件名。不足 DIRSIZE 字节的部分填 0。
+ */
+static void setEntryName(char* entryName, const string& name) {
+    memset(entryName, 0, DirectoryEntry::DIRSIZE);
+    memcpy(entryName, name.c_str(), min(name.length() + 1, (size_t) DirectoryEntry::DIRSIZE));
+}
+
+bool FileSystemAdapter::moveEntry(
+    const vector<int>& srcChain,
+    const string& srcName,
+    int ino,
+    const vector<int>& dstChain,
+    const string& dstName
+) {
+    if (dstName.empty() || dstName.length() > DirectoryEntry::DIRSIZE) {
+        console << "[error] 文件名无效或过长：" << dstName << endl;
+        return false;
+    }
+
+    int srcDirIno = srcChain.back();
+    int dstDirIno = dstChain.back();
+
+    // 上级目录先加锁，与 rm 逐层向下的顺序一致；互不包含时按 inode 号从小到大。
+    int firstIno = min(srcDirIno, dstDirIno);
+    if (find(dstChain.begin(), dstChain.end(), srcDirIno) != dstChain.end()) {
+        firstIno = srcDirIno;
+    } else if (find(srcChain.begin(), srcChain.end(), dstDirIno) != srcChain.end()) {
+        firstIno = dstDirIno;
+    }
+
+    unique_lock<shared_mutex> firstLock(inodeLock(firstIno));
+    unique_lock<shared_mutex> secondLock;
+    if (srcDirIno != dstDirIno) {
+        secondLock = unique_lock<shared_mutex>(inodeLock(firstIno == srcDirIno ? dstDirIno : srcDirIno));
+    }
+
+    // 以下检查都在加锁之后进行：等待期间目录可能已被删除，目录项可能已被改动。
+    if (!this->inodes[srcDirIno].ialloc || !this->inodes[dstDirIno].ialloc) {
+        console << "[error] 目录已被删除。" << endl;
+        return false;
+    }
+
+    // 目录不能移入它自己或它的子目录。
+    if (this->inodes[ino].file_type == Inode::FileType::DIR
+        && find(dstChain.begin(), dstChain.end(), ino) != dstChain.end()) {
+        console << "[error] 不能把文件夹移入它自己的子目录：" << dstName << endl;
+        return false;
+    }
+
+    Inode& srcDirInode = this->inodes[srcDirIno];
+    InodeDirectory srcDir(srcDirInode, *this);
+    int srcSlot = srcDir.find(srcName);
+    if (srcSlot < 0 || srcDir.entries[srcSlot].m_ino != ino) {
+        console << "[error] 找不到：" << srcName << endl;
+        return false;
+    }
+
+    // 同一目录内：只改名字。
+    if (srcDirIno == dstDirIno) {
+        if (srcName == dstName) {
+            return true;
+        }
+
+        if (srcDir.find(dstName) >= 0) {
+            console << "[error] 目标已存在：" << dstName << endl;
+            return false;
+        }
+
+        setEntryName(srcDir.entries[srcSlot].m_name, dstName);
+        return this->writeDirectorySlots(srcDirInode, srcDir, { srcSlot }, srcDir.length);
+    }
+
+    Inode& dstDirInode = this->inodes[dstDirIno];
+    InodeDirectory dstDir(dstDirInode, *this, false, 1);
+    if (dstDir.find(dstName) >= 0) {
+        console << "[error] 目标已存在：" << dstName << endl;
+        return false;
+    }
+
+    // 先加入目标目录，再从源目录移除：中途失败时最多多出一个目录项，不会丢失文件。
+    int dstSlot = dstDir.length;
+    dstDir.entries[dstSlot].m_ino = srcDir.entries[srcSlot].m_ino;
+    setEntryName(dstDir.entries[dstSlot].m_name, dstName);
+    if (!this->writeDirectorySlots(dstDirInode, dstDir, { dstSlot }, dstDir.length + 1)) {
+        return false;
+    }
+
+    // 内核创建的目录含有 ".."，须改为指向新的上级目录，链接数随之转移。
+    // 被移动的目录在两个上级目录之后加锁，与逐层向下的顺序一致。
+    if (this->inodes[ino].file_type == Inode::FileType::DIR) {
+        unique_lock<shared_mutex> movedLock(inodeLock(ino));
+        Inode& movedInode = this->inodes[ino];
+        InodeDirectory movedDir(movedInode, *this);
+        int parentSlot = movedDir.find("..");
+        if (parentSlot >= 0 && movedDir.entries[parentSlot].m_ino != dstDirIno) {
+            int oldParentIno = movedDir.entries[parentSlot].m_ino;
+            movedDir.entries[parentSlot].m_ino = dstDirIno;
+            if (!this->writeDirectorySlots(movedInode, movedDir, { parentSlot }, movedDir.length)) {
+                return false;
+            }
+
+            if (oldParentIno == srcDirIno && srcDirInode.d_nlink > 0) {
+                srcDirInode.d_nlink--;
+            }
+
+            dstDirInode.d_nlink++;
+        }
+    }
+
+    // 用最后一项填补空位。最后一项原来的位置在目录长度之外，不需要清除。
+    int lastSlot = srcDir.length - 1;
+    vector<int> dirtySlots;
+    if (srcSlot != lastSlot) {
+        memcpy(srcDir.entries + srcSlot, srcDir.entries + lastSlot, sizeof(DirectoryEntry));
+        dirtySlots.push_back(srcSlot);
+    }
+
+    return this->writeDirectorySlots(srcDirInode, srcDir, dirtySlots, lastSlot);
+}
+
+bool FileSystemAdapter::writeDirectorySlots(
+    Inode& dirInode,
+    const InodeDirectory& dir,
+    const vector<int>& dirtySlots,
+    int newLength
+) {
+    BlockTraceTag tag(BlockTrace::TAG_DIRECTORY);
+    metadataDirty = true;
+
+    const int entriesPerBlock = sizeof(Block) / sizeof(DirectoryEntry);
+    int blockCount = (dirInode.d_size + sizeof(Block) - 1) / sizeof(Block);
+    int newBlockCount = (newLength + entriesPerBlock - 1) / entriesPerBlock;
+
+    // 只读取索引块，找出各数据块的盘块号。
+    vector<int> blocks;
+    bool hasHole = false;
+    if (blockCount == newBlockCount) {
+        this->iterateOverInodeDataBlocks(
+            dirInode,
+            [&] (int dataByteOffset, int blockIdx) {
+                blocks.push_back(blockIdx);
+                hasHole |= blockIdx == 0;
+            },
+            [] (int prevBlockIdx) {
+                return prevBlockIdx;
+            },
+            [&] (Inode&, int, const char*) {
+                hasHole = true;
+            },
+            [] (...) {},
+            [] (...) {}
+        );
+    }
+
+    if (blockCount != newBlockCount || hasHole || blocks.size() != blockCount) {
+        return this->writeFile((char*) dir.entries, dirInode, newLength * sizeof(DirectoryEntry));
+    }
+
+    dirInode.d_size = newLength * sizeof(DirectoryEntry);
+
+    int prevFileBlock = -1;
+    for (int slot : dirtySlots) {
+        int fileBlock = slot / entriesPerBlock;
+        if (fileBlock == prevFileBlock) {
+            continue;
+        }
+
+        if (!this->writeBlocks((const char*) (dir.entries + fileBlock * entriesPerBlock), blocks[fileBlock], 1)) {
+            return false;
+        }
+
+        prevFileBlock = fileBlock;
+    }
+
+    return true;
+}
+
+bool FileSystemAdapter::linkEntry(int dirIno, const string& name, int ino) {
+    if (name.empty() || name.length() > DirectoryEntry::DIRSIZE) {
+        console << "[error] 文件名无效或过长：" << name << endl;
+        return false;
+    }
+
+    unique_lock<shared_mutex> lock(inodeLock(dirIno));
+    Inode& dirInode = this->inodes[dirIno];
+    InodeDirectory dir(dirInode, *this, false, 1);
+    if (dir.find(name) >= 0) {
+        console << "[error] 目标已存在：" << name << endl;
+        return false;
+    }
+
+    int slot = dir.length;
+    dir.entries[slot].m_ino = ino;
+    setEntryName(dir.entries[slot].m_name, name);
+
+    session().allocContext.parentIno = dirIno;
+    return this->writeDirectorySlots(dirInode, dir, { slot }, dir.length + 1);
+}
+
+bool FileSystemAdapter::copyInodeData(Inode& src, Inode& dst, const function<int ()>& blockAllocator) {
+    // 源文件各数据块的盘块号。空洞为 0。只读取索引块。
+    vector<int> srcBlocks;
+    this->iterateOverInodeDataBlocks(
+        src,
+        [&] (int dataByteOffset, int blockIdx) {
+            srcBlocks.push_back(blockIdx);
+        },
+        [] (int prevBlockIdx) {
+            return prevBlockIdx;
+        },
+        [] (...) {},
+        [] (...) {},
+        [] (...) {}
+    );
+
+    if (srcBlocks.size() * sizeof(Block) < src.d_size) {
+        console << "[error] 源文件的索引不完整。" << endl;
+        return false;
+    }
+
+    vector<char> buffer;
+
+    return this->writeInodeExtents(
+        dst,
+        src.d_size,
+        blockAllocator,
+
+        [&] (int dataByteOffset, int blockIdx, int blockCount) {
+            BlockTraceTag tag(BlockTrace::TAG_FILE_READ);
+            buffer.resize(blockCount * sizeof(Block));
+            int firstFileBlock = dataByteOffset / sizeof(Block);
+
+            // 源文件中盘块号连续的数据块一次读入。区段内没有空洞（空洞会截断区段）。
+            for (int runBegin = 0; runBegin < blockCount; ) {
+                int runLength = 1;
+                while (runBegin + runLength < blockCount
+                    && srcBlocks[firstFileBlock + runBegin + runLength]
+                        == srcBlocks[firstFileBlock + runBegin] + runLength
+                ) {
+                    runLength++;
+                }
+
+                if (!this->readBlocks(
+                    buffer.data() + runBegin * sizeof(Block), srcBlocks[firstFileBlock + runBegin], runLength
+                )) {
+                    return false;
+                }
+
+                runBegin += runLength;
+            }
+
+            BlockTraceTag writeTag(BlockTrace::TAG_FILE_WRITE);
+            return this->writeBlocks(buffer.data(), blockIdx, blockCount);
+        },
+
+        [&] (int dataByteOffset) {
+            return srcBlocks[dataByteOffset / sizeof(Block)] == 0;
+        }
+    );
+}
+
+int FileSystemAdapter::cp(const string& srcPath, const string& dstPath, bool hardLinks) {
+    V6PP_TRACE_SCOPE("cp", srcPath);
+
+    vector<int> srcChain;
+    string srcName;
+    if (!this->resolvePath(srcPath, srcChain, srcName)) {
+        return -1;
+    }
+
+    int srcIno = srcName.empty() ? srcChain.back() : this->lookupEntry(srcChain.back(), srcName);
+    if (srcIno <= 0) {
+        console << "[error] 找不到：" << srcPath << endl;
+        return -1;
+    }
+
+    vector<int> dstChain;
+    string dstName;
+    if (!this->resolvePath(dstPath, dstChain, dstName)) {
+        return -1;
+    }
+
+    // 目标是已有的目录：复制到其中，保持原名。
+    int existingIdx = dstName.empty() ? dstChain.back() : this->lookupEntry(dstChain.back(), dstName);
+    if (existingIdx > 0 && this->inodes[existingIdx].file_type == Inode::FileType::DIR) {
+        if (!dstName.empty()) {
+            dstChain.push_back(existingIdx);
+        }
+
+        dstName = srcName;
+        existingIdx = dstName.empty() ? 0 : this->lookupEntry(dstChain.back(), dstName);
+    }
+
+    if (dstName.empty()) {
+        console << "[error] 需要指定副本的名字：" << dstPath << endl;
+        return -1;
+    } else if (dstName.length() > DirectoryEntry::DIRSIZE) {
+        console << "[error] 文件名过长：" << dstName << endl;
+        return -1;
+    } else if (existingIdx > 0) {
+        console << "[error] 目标已存在：" << dstPath << endl;
+        return -1;
+    }
+
+    for (int dirIno : dstChain) {
+        if (dirIno == srcIno) {
+            console << "[error] 不能把文件夹复制到它自己的子目录：" << dstPath << endl;
+            return -1;
+        }
+    }
+
+    int dstDirIno = dstChain.back();
+    const int inodeCount = sizeof(this->inodes) / sizeof(Inode);
+
+    /*
+     * 1. 按层遍历源目录树，列出所有要复制的项。每个目录的子项在列表中相邻，
+     *    且排在目录之后。同时统计需要的盘块数。
+     */
+    struct CopyItem {
+        int srcIno;
+        int newIno;
+        char name[DirectoryEntry::DIRSIZE];
+        int firstChild;
+        int childCount;
+    };
+
+    vector<CopyItem> items;
+    items.push_back({ srcIno, 0, {}, 0, 0 });
+    setEntryName(items[0].name, dstName);
+    vector<bool> visited(inodeCount, false);
+    visited[srcIno] = true;
+    long long blocksWanted = 0;
+
+    for (size_t idx = 0; idx < items.size(); idx++) {
+        Inode& inode = this->inodes[items[idx].srcIno];
+        if (inode.file_type != Inode::FileType::DIR) {
+            if (!hardLinks && inode.d_size > 0) {
+                blocksWanted += AllocationContext::blocksForFileSize(inode.d_size);
+            }
+
+            continue;
+        }
+
+        items[idx].firstChild = items.size();
+
+        shared_lock<shared_mutex> lock(inodeLock(items[idx].srcIno));
+        DirectoryView dir(inode, *this);
+        dir.forEach([&] (const DirectoryEntry& entry) {
+            if (entry.m_ino == 0 || entry.m_ino >= inodeCount 
+                || (visited[entry.m_ino] && this->inodes[entry.m_ino].file_type == Inode::FileType::DIR)
+            ) {
+                return; // 损坏的目录项，或被多次引用的目录。
+            }
+
+            visited[entry.m_ino] = true;
+            CopyItem child = { (int) entry.m_ino, 0, {}, 0, 0 };
+            memcpy(child.name, entry.m_name, sizeof(child.name));
+            items.push_back(child);
+        });
+
+        items[idx].childCount = items.size() - items[idx].firstChild;
+        if (items[idx].childCount > 0) {
+            blocksWanted += AllocationContext::blocksForFileSize(items[idx].childCount * sizeof(DirectoryEntry));
+        }
+    }
+
+    /*
+     * 2. 申请 inode 与全部盘块。盘块按盘块号排序后依次取用，使副本按遍历顺序连续存放。
+     */
+    vector<int> reserved;
+    size_t reservedUsed = 0;
+
+    auto rollback = [&] () {
+        for (const CopyItem& item : items) {
+            if (item.newIno > 0 && item.newIno != item.srcIno) {
+                this->freeInode(item.newIno, true);
+            }
+        }
+
+        for (size_t idx = reservedUsed; idx < reserved.size(); idx++) {
+            this->freeBlock(reserved[idx]);
+        }
+    };
+
+    AllocationContext& allocContext = session().allocContext;
+    allocContext.parentIno = dstDirIno;
+    for (CopyItem& item : items) {
+        Inode& srcInode = this->inodes[item.srcIno];
+        if (hardLinks && srcInode.file_type != Inode::FileType::DIR) {
+            item.newIno = item.srcIno;
+            continue;
+        }
+
+        item.newIno = this->getFreeInode();
+        if (item.newIno < 0) {
+            console << "[error] 无法获取空 inode。" << endl;
+            item.newIno = 0;
+            rollback();
+            return -1;
+        }
+
+        Inode& newInode = this->inodes[item.newIno];
+        newInode.file_type = srcInode.file_type;
+        newInode.permission_owner = srcInode.permission_owner;
+        newInode.permission_group = srcInode.permission_group;
+        newInode.permission_others = srcInode.permission_others;
+        newInode.d_uid = srcInode.d_uid;
+        newInode.d_gid = srcInode.d_gid;
+    }
+
+    allocContext.ino = 0;
+    allocContext.goal = 0;
+    allocContext.blocksWanted = max(1LL, blocksWanted);
+    for (long long count = 0; count < blocksWanted; count++) {
+        int blockIdx = this->getFreeBlock();
+        if (blockIdx < 0) {
+            console << "[error] 盘块不足：需要 " << blocksWanted << " 块。" << endl;
+            rollback();
+            return -1;
+        }
+
+        reserved.push_back(blockIdx);
+    }
+
+    sort(reserved.begin(), reserved.end());
+
+    auto allocateReserved = [&] () {
+        // 预留的盘块按估计值申请，用完时（不应发生）再从空闲表申请。
+        return reservedUsed < reserved.size() ? reserved[reservedUsed++] : this->getFreeBlock();
+    };
+
+    /*
+     * 3. 按遍历顺序写入：目录在内存中生成后一次写出，文件按区段复制。新的 inode 还不可达，不需要加锁。
+     */
+    vector<DirectoryEntry> entries;
+    int copied = 0;
+
+    for (const CopyItem& item : items) {
+        Inode& srcInode = this->inodes[item.srcIno];
+        Inode& newInode = this->inodes[item.newIno];
+        copied++;
+
+        if (srcInode.file_type == Inode::FileType::DIR) {
+            if (item.childCount == 0) {
+                continue;
+            }
+
+            const int entriesPerBlock = sizeof(Block) / sizeof(DirectoryEntry);
+            entries.assign((item.childCount + entriesPerBlock - 1) / entriesPerBlock * entriesPerBlock, {});
+            for (int idx = 0; idx < item.childCount; idx++) {
+                const CopyItem& child = items[item.firstChild + idx];
+                entries[idx].m_ino = child.newIno;
+                memcpy(entries[idx].m_name, child.name, sizeof(child.name));
+            }
+
+            BlockTraceTag tag(BlockTrace::TAG_DIRECTORY);
+            bool result = this->writeInodeExtents(
+                newInode,
+                item.childCount * sizeof(DirectoryEntry),
+                allocateReserved,
+                [&] (int dataByteOffset, int blockIdx, int blockCount) {
+                    return this->writeBlocks((const char*) entries.data() + dataByteOffset, blockIdx, blockCount);
+                }
+            );
+
+            if (!result) {
+                rollback();
+                return -1;
+            }
+        } else if (item.newIno != item.srcIno && srcInode.d_size > 0) {
+            shared_lock<shared_mutex> lock(inodeLock(item.srcIno));
+            if (!this->copyInodeData(srcInode, newInode, allocateReserved)) {
+                rollback();
+                return -1;
+            }
+        }
+    }
+
+    for (size_t idx = reservedUsed; idx < reserved.size(); idx++) {
+        this->freeBlock(reserved[idx]); // 源文件中有空洞时会有剩余。
+    }
+
+    reserved.clear();
+    reservedUsed = 0;
+
+    // 4. 把副本挂到目标目录下，之后更新硬链接数。
+    if (!this->linkEntry(dstDirIno, dstName, items[0].newIno)) {
+        rollback();
+        return -1;
+    }
+
+    for (const CopyItem& item : items) {
+        if (item.newIno == item.srcIno) {
+            unique_lock<shared_mutex> lock(inodeLock(item.srcIno));
+            this->inodes[item.srcIno].d_nlink++;
+        }
+    }
+
+    return copied;
+}
+
+void FileSystemAdapter::whoOwns(int blockIdx) {
+    if (blockIdx < 0 || blockIdx >= MachineProps::diskBlocks()) {
+        console << "[error] 盘块号越界：" << blockIdx << endl;
+        return;
+    }
+
+    console << "盘块 " << blockIdx << "：";
+
+    if (blockIdx < MachineProps::BOOT_LOADER_BLOCKS) {
+        console << "启动引导区。" << endl;
+        return;
+    } else if (blockIdx < MachineProps::KERNEL_AND_BOOT_BLOCKS) {
+        console << "内核区，内核文件第 " << blockIdx - MachineProps::BOOT_LOADER_BLOCKS << " 块。" << endl;
+        return;
+    } else if (blockIdx < superBlock.inode_zone_begin) {
+        console << "SuperBlock 区。" << endl;
+        return;
+    } else if (blockIdx < superBlock.data_zone_begin) {
+        int inodesPerBlock = sizeof(Block) / sizeof(Inode);
+        int firstIno = (blockIdx - superBlock.inode_zone_begin) * inodesPerBlock;
+        console << "Inode 区，inode " << firstIno << " ~ " << firstIno + inodesPerBlock - 1 << "。" << endl;
+        return;
+    } else if (blockIdx >= superBlock.swap_zone_begin) {
+        console << "交换区。" << endl;
+        return;
+    }
+
+    if (ownerMap == nullptr) {
+        console << endl;
+        console << "[info] 开启盘块归属反查表：" 
+            << (enableOwnerMap() ? "已从附属文件读取。" : "已重建。") << endl;
+    }
+
+    const BlockOwner& owner = ownerMap->get(blockIdx);
+    if (owner.ino == 0) {
+        console << "数据区，不属于任何文件（空闲或未使用）。" << endl;
+        return;
+    }
+
+    string path = pathOfInode(owner.ino);
+    console << "数据区，属于 inode " << owner.ino << "（" << (path.empty() ? "不可达" : path) << "），";
+    if (owner.fileBlock == BlockOwner::INDEX_BLOCK) {
+        console << "索引块。" << endl;
+    } else {
+        console << "文件内第 " << owner.fileBlock << " 块（偏移 " 
+            << 1LL * owner.fileBlock * sizeof(Block) << " 字节）。" << endl;
+    }
+}
@@ -10,12 +10,47 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include "./structures/SuperBlock.h"
 #include "./structures/Inode.h"
 #include "./structures/Block.h"
 #include "./MacroDefines.h"
 #include "./structures/InodeDirectory.h"
+#include "./structures/DirectoryView.h"
+#include "./AllocationPolicy.h"
+#include "./IoStats.h"
 
+/**
+ * 会话：每个使用者各自的当前路径与分配上下文。
+ * 多个线程同时操作同一个文件系统时，每个线程通过 bindSession 使用自己的会话。
+ */
+struct AdapterSession {
+    /** 用户路径 inode 号栈。空表示根目录。 */
+    std::vector<int> inodeIdxStack;
+
+    /** 分配上下文：当前正在写入的文件与所在目录。 */
+    AllocationContext allocContext;
+};
+
+/**
+ * 文件系统适配器。
+ * 
+ * 并发模型：
+ *   - 盘块读写使用 pread/pwrite，不共享文件流的读写位置；
+ *   - 盘块与 inode 的分配、释放由分配锁保护，临界区只包含空闲表操作；
+ *   - 每个 inode 一把读写锁。路径级操作（ls、cd、lookupEntry、touch、mkdir、rm、mv、
+ *     uploadFile、downloadFile）在入口处锁住所涉及的目录与文件：
+ *     读操作持有共享锁，修改目录或文件内容时持有独占锁；
+ *   - 同时持有多个 inode 锁时，上级目录先于下级目录加锁（rm 逐层向下，mv 见 moveEntry），
+ *     互不包含的两个目录按 inode 号从小到大加锁；
+ *   - 当前路径保存在会话中，不同线程互不干扰。
+ * 
+ * readFile、writeFile、iterateOverInodeDataBlocks 等底层方法不加锁，由调用者持有相应 inode 的锁。
+ * 分配器原样返回旧盘块号的遍历（读取）不写 inode 与归属反查表，持有共享锁即可并行执行。
+ * format、load、sync、碎片整理等整盘操作要求没有其他线程同时访问。
+ */
 class FileSystemAdapter {
 public:
     const int FS_FILE_SIZE_MAX = MachineProps::BLOCK_SIZE * (6 + 128 + 128 * 128);
@@ -26,9 +61,11 @@ public:
      * 构造函数。自动打开磁盘映像文件。
      * 
      * @param filePath 文件路径。需要保证该文件可以打开。
+     * @param overlayPath 覆盖层文件路径。非空时，映像只读打开，所有写入都进入覆盖层。
+     * @param readOnly 只读打开。不允许写盘块，析构时也不会同步。
      * @exception runtime_error 文件打开失败。
      */
-    FileSystemAdapter(const char* filePath);
+    FileSystemAdapter(const char* filePath, const char* overlayPath = nullptr, bool readOnly = false);
 
     ~FileSystemAdapter();
 
@@ -41,13 +78,21 @@ public:
     void load();
 
     /**
-     * 同步。将内存中的 superblock 和 inodes 同步到映像文件内。
+     * 同步。将内存中的 superblock 和 inodes 同步到映像文件内（覆盖层模式下同步到覆盖层）。
      */
     void sync();
 
     /** 写入内核文件。 */
     void writeKernel(std::fstream& kernelFile);
 
+    /**
+     * 写入内核文件。尽量在内核态直接完成拷贝，不支持时退回缓冲拷贝。
+     * 
+     * @param kernelFilePath 内核文件路径。
+     * @return 是否成功打开并写入。
+     */
+    bool writeKernel(const std::string& kernelFilePath);
+
     /** 
      * 写入启动引导文件。 
      * 
@@ -55,12 +100,26 @@ public:
      */
     void writeBootLoader(std::fstream& bootLoaderFile);
 
+    /** 
+     * 写入启动引导文件。尽量在内核态直接完成拷贝，不支持时退回缓冲拷贝。
+     * 
+     * @param bootLoaderFilePath 启动引导文件路径。
+     * @return 是否成功打开并写入。
+     */
+    bool writeBootLoader(const std::string& bootLoaderFilePath);
+
 public:
     bool readBlock(Block& block, const int blockIdx);
     bool readBlocks(char* buffer, const int blockIdx, const int blockCount);
     bool writeBlock(const Block& block, const int blockIdx);
     bool writeBlocks(const char* buffer, const int blockIdx, const int blockCount);
 
+protected:
+    /** 直接从映像文件读取盘块，不经过覆盖层。 */
+    bool readImageBlocks(char* buffer, const int blockIdx, const int blockCount);
+
+public:
+
     /**
      * 迭代处理一个 inode 对应的所有数据块。
      * 
@@ -70,6 +129,13 @@ public:
      * @param iterationFailedHandler 当内部遇到问题，会调用此方法，然后结束迭代过程。
      * @param dataBlockPostProcess 处理完一个直接存储数据的盘块后，会调用此后处理函数。
      * @param indirectIndexBlockPostProcess 对于存储索引信息的盘块，索引内的数据块处理完毕后调用此方法。
+     * @param dataHoleDetector 可选。返回 true 时，该数据块槽位留作空洞（盘块号为 0），不申请盘块。
+     * 
+     * 盘块号为 0 的数据块槽位视为空洞：blockDiscoveryHandler 会收到盘块号 0，
+     * 但不会调用 dataBlockPostProcess。盘块号为 0 的索引块视为全部为空洞，也不会被后处理。
+     * 
+     * 盘块号没有变化的槽位不会写回 inode，归属反查表中相同的记录也不会重写。
+     * 因此 blockAllocator 原样返回旧盘块号时，遍历只读取共享数据。
      */
     bool iterateOverInodeDataBlocks(
         Inode& inode,
@@ -121,22 +187,124 @@ public:
         const std::function<void (
             const char* pBlock,
             int blockIndex
-        )> indirectIndexBlockPostProcess
+        )> indirectIndexBlockPostProcess,
+
+        /**
+         * 空洞探测。
+         * 
+         * @param dataByteOffset 数据在文件中的字节位置。
+         * @return 该位置的数据块是否留作空洞。
+         */
+        const std::function<bool (
+            int dataByteOffset
+        )> dataHoleDetector = nullptr
     );
 
     /**
-     * 读取一个文件的内容。
+     * 读取一个文件的内容。空洞读出为 0。
      * 
      * @param buffer 存储目标。
      * @param inode 文件 inode。
      * @return 是否未出现错误。
      */
     bool readFile(char* buffer, Inode& inode);
+
+    /**
+     * 写入一个文件的内容。开启 sparseFiles 时，全零的盘块留作空洞。
+     */
     bool writeFile(char* buffer, Inode& inode, int filesize);
 
     bool downloadFile(const std::string& fname, std::fstream& f);
     bool uploadFile(const std::string& fname, std::fstream& f);
 
+    /**
+     * 上传宿主机文件。连续的盘块段会尽量通过 copy_file_range 在内核态直接拷贝。
+     * 
+     * @param fname 文件系统内的文件名。
+     * @param hostPath 宿主机文件路径。
+     * @return 是否未出现错误。
+     */
+    bool uploadFile(const std::string& fname, const std::string& hostPath);
+
+    /**
+     * 将宿主机文件中的一段数据拷贝到映像内的连续盘块。
+     * 完整的盘块优先使用 copy_file_range（CoW 文件系统上可直接共享数据），
+     * 其次 sendfile，都不支持时退回缓冲拷贝。不足一个盘块的尾部补零。
+     * 
+     * @param hostFd 宿主机文件描述符。
+     * @param hostOffset 数据在宿主机文件中的字节位置。
+     * @param hostBytes 要拷贝的字节数。不超过 blockCount 个盘块。
+     * @param blockIdx 目标起始盘块号。
+     * @param blockCount 目标盘块数。
+     */
+    bool copyFromHostFile(
+        int hostFd, long long hostOffset, long long hostBytes, 
+        int blockIdx, int blockCount
+    );
+
+    /** 单个区段的最大盘块数。限制缓冲拷贝时的内存占用。 */
+    static const int EXTENT_BLOCKS_MAX = 2048;
+
+    /**
+     * 重新为 inode 分配 filesize 字节的数据，并把相邻的数据块合并成区段交给 extentWriter 写入。
+     * 原有的盘块先释放。索引块在填好后直接写出。调用者持有 inode 的独占锁。
+     *
+     * @param blockAllocator 提供新盘块。-1 表示盘满。
+     * @param extentWriter 写入文件 [dataByteOffset, ...) 处的盘块 [blockIdx, blockIdx + blockCount)。
+     * @param dataHoleDetector 可选。返回 true 的数据块留作空洞。
+     */
+    bool writeInodeExtents(
+        Inode& inode,
+        int filesize,
+        const std::function<int ()>& blockAllocator,
+        const std::function<bool (
+            int dataByteOffset,
+            int blockIdx,
+            int blockCount
+        )>& extentWriter,
+        const std::function<bool (
+            int dataByteOffset
+        )>& dataHoleDetector = nullptr
+    );
+
+protected:
+    /**
+     * 上传文件的公共部分：建立 inode，申请盘块，并把相邻的数据块合并成区段交给 extentWriter。
+     * 
+     * @param fname 文件系统内的文件名。
+     * @param filesize 宿主机文件大小。
+     * @param extentWriter 把宿主机文件 [hostOffset, hostOffset + hostBytes) 写入
+     *                     盘块 [blockIdx, blockIdx + blockCount)。
+     */
+    bool uploadFile(
+        const std::string& fname,
+        long long filesize,
+        const std::function<bool (
+            long long hostOffset,
+            long long hostBytes,
+            int blockIdx,
+            int blockCount
+        )>& extentWriter,
+
+        /**
+         * 读取宿主机文件 [hostOffset, hostOffset + hostBytes) 到 buffer。
+         * 仅在开启 sparseFiles 时用于探测全零盘块。
+         */
+        const std::function<bool (
+            long long hostOffset,
+            long long hostBytes,
+            char* buffer
+        )>& hostReader
+    );
+
+    /**
+     * 把 src 的数据复制给 dst（dst 原有的盘块先释放），盘块由 blockAllocator 提供。
+     * 调用者持有 src 的锁。
+     */
+    bool copyInodeData(Inode& src, Inode& dst, const std::function<int ()>& blockAllocator);
+
+public:
+
     /**
      * 获取一个空的盘块。该盘块会被从空盘块列表移除。
      * @return int 盘块号。-1表示获取失败。
@@ -164,8 +332,132 @@ public:
     void freeInodeBlocks(Inode& inode);
     void freeInode(int idx, bool freeBlocks = false);
 
+    /**
+     * 标记映像中所有在用的盘块：启动引导区、内核区、SuperBlock 区、Inode 区，
+     * 所有已分配 inode 的数据块与索引块，以及空闲盘块链上的链接块。
+     * 交换区和空闲数据块不会被标记。
+     * 
+     * @param live 输出。长度为盘块总数，在用的盘块为 true。
+     * @return 在用的盘块数。
+     */
+    int markLiveBlocks(std::vector<bool>& live);
+
+    /**
+     * 整理空闲表：收集数据区中所有不在用的盘块（包括旧的链接块），
+     * 按升序重新生成 s_free 与空闲盘块链，使之后的分配从小到大连续取用。
+     * 链接块在内存中生成后按升序一次写出。s_inode 重新填入编号最小的空闲 inode。
+     * 
+     * @return 空闲盘块数。
+     */
+    int tidyFreeLists();
+
+    /**
+     * 设置分配策略。
+     * 
+     * @param name stack（V6++ 默认方式）、first-fit、locality 或 pack。
+     * @return 名字是否有效。
+     */
+    bool setAllocationPolicy(const std::string& name);
+
+    /**
+     * 文件系统元数据（superblock 与 inode 表）的校验值。用于判断附属文件是否过期。
+     */
+    uint64_t metadataChecksum();
+
+    /**
+     * 附属文件路径：映像文件（覆盖层模式下为覆盖层文件）路径加上后缀。
+     */
+    std::string sidecarPath(const char* suffix);
+
+    /**
+     * 开启盘块归属反查表。附属文件有效时直接读取，否则遍历 inode 表重建。
+     * 
+     * @return 是否从附属文件读取（false 表示重建）。
+     */
+    bool enableOwnerMap();
+
+    /**
+     * 查找 inode 的完整路径。从根目录出发按层搜索。
+     * 
+     * @return 路径。找不到时返回空串。
+     */
+    std::string pathOfInode(int ino);
+
+    /**
+     * 在目录中查找文件名。缓存可用时直接查目录名索引，不读目录文件。
+     * 
+     * @return inode 号。0 表示找不到。
+     */
+    int lookupEntry(int dirIno, const std::string& name);
+
+    /**
+     * 与磁盘状态一致、可以直接使用的附属缓存。会话中修改过元数据后返回 nullptr。
+     */
+    inline class SidecarCache* warmCache() {
+        return metadataDirty ? nullptr : cache;
+    }
+
+    /**
+     * 映像文件路径。
+     */
+    inline const std::string& imagePath() const {
+        return imgFilePath;
+    }
+
+    /**
+     * 开启或关闭附属缓存。开启后在 sync 时生成；关闭时删除缓存文件。
+     */
+    void setCacheEnabled(bool enabled);
+
+    /**
+     * 开始记录盘块访问，写入 path。已在记录时先结束之前的记录。
+     * 
+     * @param path 空串表示结束记录。
+     * @return 是否成功创建记录文件。
+     */
+    bool setBlockTrace(const std::string& path);
+
+    /**
+     * 当前线程使用的会话。没有绑定时使用默认会话。
+     */
+    AdapterSession& session();
+
+    /**
+     * 为当前线程绑定会话。会话由调用者持有，需要在解除绑定之前一直有效。
+     * 
+     * @param session nullptr 表示解除绑定，回到默认会话。
+     */
+    void bindSession(AdapterSession* session);
+
+    /**
+     * inode 的读写锁。
+     */
+    inline std::shared_mutex& inodeLock(int ino) {
+        return inodeLocks[ino];
+    }
+
+protected:
+    /**
+     * 保存附属文件（盘块归属表与附属缓存）。
+     */
+    void saveSidecars();
+
+    /**
+     * 把目录副本写回目录文件，目录长度改为 newLength。
+     * 盘块数不变时只写 dirtySlots 所在的盘块，否则重写整个目录文件。调用者持有目录的独占锁。
+     */
+    bool writeDirectorySlots(
+        Inode& dirInode,
+        const class InodeDirectory& dir,
+        const std::vector<int>& dirtySlots,
+        int newLength
+    );
+
+public:
+
     /**
      * 相当于对一个路径执行 rm -rf ./*
+     * 目录中的 "." 与 ".." 不会递归删除。
      * 
      * @param inode 
      * @return int 成功删除的文件数。对文件夹的统计可能不准确。
@@ -173,7 +465,7 @@ public:
     int removeChildren(Inode& inode);
 
 public:
-    void ls(const InodeDirectory& dir);
+    void ls(const class DirectoryView& dir);
     void ls(Inode& inode);
     void ls();
     void ls(const std::vector<std::string>& pathSegments, bool fromRoot);
@@ -182,8 +474,126 @@ public:
     int rm(const std::string& path);
     int touch(const std::string& fileName, Inode::FileType type);
 
+    /**
+     * 解析路径。以 / 开头时从根目录出发，否则从当前目录出发；"." 与 ".." 按路径栈处理。
+     *
+     * @param dirChain 输出。从根目录到最后一段所在目录的 inode 号。
+     * @param name 输出。最后一段的文件名（不检查是否存在）。路径指向目录本身（如 /、..）时为空串，
+     *             此时该目录就是 dirChain 的最后一项。
+     * @return 中间各段是否都存在且是目录。
+     */
+    bool resolvePath(const std::string& path, std::vector<int>& dirChain, std::string& name);
+
+    /**
+     * 移动或重命名。目标是已有的目录时移入其中并保持原名；目标是已有的文件时拒绝执行。
+     * 只修改目录项，文件数据与 inode 不动。移动的是当前路径上的目录时，当前路径随之更新。
+     *
+     * @return 是否成功。
+     */
+    bool mv(const std::string& srcPath, const std::string& dstPath);
+
+    /**
+     * 把目录项 srcName 从 srcDirIno 移到 dstDirIno，改名为 dstName。
+     *
+     * 只改写涉及的目录项所在的盘块：同一目录内改名时 1 块，跨目录时源、目标各 1 块。
+     * 源目录中空出的位置由最后一项填补，因此目录项的顺序会改变。
+     * 跨目录移动的目录含有 ".."（内核创建的目录）时，一并改写它，并把链接数从源目录转到目标目录。
+     * 目标目录需要新盘块、源目录空出最后一个盘块或目录文件中有空洞时，改为重写整个目录文件。
+     *
+     * 调用者持有 renameMutex，并在取得它之后解析出两条路径链（从根目录到源目录、目标目录的 inode 号）。
+     * 两个目录按上级先于下级的顺序加锁，与 rm 一致；加锁后重新检查源目录项、目标是否已存在，
+     * 以及是否会把目录移入它自己或它的子目录。
+     *
+     * @param ino 源目录项应指向的 inode。加锁前目录项已被改动时失败。
+     * @return 是否成功。源不存在、目标已存在、目录已被删除、形成环或文件名过长时失败。
+     */
+    bool moveEntry(
+        const std::vector<int>& srcChain,
+        const std::string& srcName,
+        int ino,
+        const std::vector<int>& dstChain,
+        const std::string& dstName
+    );
+
+    /**
+     * 在目录末尾加入目录项 name，指向已有的 inode ino。不修改 ino 的 d_nlink。
+     *
+     * @return 是否成功。同名的目录项已存在或文件名过长时失败。
+     */
+    bool linkEntry(int dirIno, const std::string& name, int ino);
+
+    /**
+     * 在映像内复制文件或目录（相当于 cp -r）。目标是已有的目录时复制到其中并保持原名。
+     *
+     * 先统计整棵子树需要的盘块数，一次申请完并按盘块号排序，再按目录树的层序依次分给各个目录与文件，
+     * 使副本尽量连续存放。文件数据按区段批量复制：源文件中相邻的盘块合并为一次读取，
+     * 目标区段一次写出；空洞保持为空洞。新目录的内容在内存中生成，每个目录只写一次，
+     * 最后把副本的根挂到目标目录下。
+     *
+     * @param hardLinks 普通文件不复制数据，新目录项指向原来的 inode，d_nlink 加 1。目录总是复制。
+     * @return 复制（或链接）的文件与目录数。失败时返回 -1，映像不变。
+     */
+    int cp(const std::string& srcPath, const std::string& dstPath, bool hardLinks = false);
+
+    /**
+     * 输出盘块的归属：所在分区，以及所属文件与文件内位置。未开启归属反查表时会自动开启。
+     */
+    void whoOwns(int blockIdx);
+
 public:
     std::fstream fileStream;
+
+    /** 映像文件路径。 */
+    std::string imgFilePath;
+
+    /** 是否只读打开。 */
+    bool readOnly = false;
+
+    /** 盘块归属反查表。nullptr 表示未开启。 */
+    class BlockOwnerMap* ownerMap = nullptr;
+
+    /** 分配策略。nullptr 表示按 V6++ 的方式从 s_free 栈顶分配。 */
+    class AllocationPolicy* allocPolicy = nullptr;
+
+    /** 附属缓存。nullptr 表示没有可用的缓存。 */
+    class SidecarCache* cache = nullptr;
+
+    /** 是否维护附属缓存。映像旁已有缓存文件时自动开启。 */
+    bool cacheEnabled = false;
+
+    /** 本次会话是否修改过元数据（盘块、inode 分配或目录内容）。 */
+    std::atomic<bool> metadataDirty = false;
+
+    /** 盘块访问记录。nullptr 表示未开启。 */
+    class BlockTrace* blockTrace = nullptr;
+
+    /** 写时复制覆盖层。nullptr 表示直接读写映像文件。 */
+    class BlockOverlay* overlay = nullptr;
+
+    /** 映像文件描述符。供 pread/pwrite 与内核态拷贝使用。-1 表示不可用，退回文件流。 */
+    int imgFd = -1;
+
+    /** 映像的只读映射。nullptr 表示不可用（覆盖层模式或不支持 mmap）。 */
+    const char* imgMap = nullptr;
+
+    /** 保护文件流与 imgFd 的读写位置（仅在退回文件流和 sendfile 时使用）。 */
+    std::mutex streamMutex;
+
+    /** 分配锁。保护 s_free、s_inode、空闲盘块链与分配策略。 */
+    std::recursive_mutex allocMutex;
+
+    /**
+     * 移动锁。目录之间的上下级关系只会因移动而改变：
+     * 持有它时解析出的路径链在移动完成前一直有效。在 inode 锁之前取得。
+     */
+    std::mutex renameMutex;
+
+    /** 每个 inode 的读写锁。 */
+    std::shared_mutex* inodeLocks = nullptr;
+
+    /** 内核态拷贝方式是否已确认不可用。避免每个区段都重复试探。 */
+    bool copyFileRangeUnsupported = false;
+    bool sendFileUnsupported = false;
     SuperBlock superBlock;
     Inode inodes[
         MachineProps::INODE_ZONE_BLOCKS * MachineProps::BLOCK_SIZE / sizeof(Inode)
@@ -192,6 +602,18 @@ public:
     /** 文件系统是否已经加载。 */
     bool fileSystemLoaded = false;
 
-    /** 用户路径 inode 号栈。 */
-    std::vector<int> inodeIdxStack;
+    /** 稀疏文件：上传和写入文件时，全零的盘块不分配，留作空洞。 */
+    bool sparseFiles = false;
+
+    /** 复制（cp）时普通文件只建立硬链接，不复制数据。 */
+    bool copyAsHardLinks = false;
+
+    /** 碎片整理使用的布局文件路径。空表示按目录树排列。 */
+    std::string layoutProfilePath;
+
+    /** I/O 统计。 */
+    IoStats ioStats;
+
+    /** 默认会话：没有绑定会话的线程（包括交互式命令行）使用。 */
+    AdapterSession defaultSession;
 };
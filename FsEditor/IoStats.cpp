@@ -0,0 +1,246 @@
+/*
+ * I/O 统计 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <bit>
+#include "./IoStats.h"
+#include "./structures/Block.h"
+
+using namespace std;
+
+IoOpStats& IoOpStats::operator += (const IoOpStats& other) {
+    calls += other.calls;
+    blocks += other.blocks;
+    bytes += other.bytes;
+    seeks += other.seeks;
+    totalNs += other.totalNs;
+    for (int idx = 0; idx < HISTOGRAM_BUCKETS; idx++) {
+        histogram[idx] += other.histogram[idx];
+    }
+
+    return *this;
+}
+
+IoOpStats& IoOpStats::operator -= (const IoOpStats& other) {
+    calls -= other.calls;
+    blocks -= other.blocks;
+    bytes -= other.bytes;
+    seeks -= other.seeks;
+    totalNs -= other.totalNs;
+    for (int idx = 0; idx < HISTOGRAM_BUCKETS; idx++) {
+        histogram[idx] -= other.histogram[idx];
+    }
+
+    return *this;
+}
+
+uint64_t IoOpStats::percentileNs(double p) const {
+    uint64_t target = (uint64_t) (calls * p);
+    uint64_t seen = 0;
+    for (int idx = 0; idx < HISTOGRAM_BUCKETS; idx++) {
+        seen += histogram[idx];
+        if (seen > target) {
+            return 1ULL << (idx + 1);
+        }
+    }
+
+    return 1ULL << HISTOGRAM_BUCKETS;
+}
+
+IoStats::Snapshot& IoStats::Snapshot::operator += (const Snapshot& other) {
+    for (int op = 0; op < OP_COUNT; op++) {
+        ops[op] += other.ops[op];
+    }
+
+    return *this;
+}
+
+IoStats::Snapshot& IoStats::Snapshot::operator -= (const Snapshot& other) {
+    for (int op = 0; op < OP_COUNT; op++) {
+        ops[op] -= other.ops[op];
+    }
+
+    return *this;
+}
+
+const char* IoStats::opName(Op op) {
+    switch (op) {
+        case READ_BLOCKS: return "readBlocks";
+        case WRITE_BLOCKS: return "writeBlocks";
+        case GET_FREE_BLOCK: return "getFreeBlock";
+        case FREE_BLOCK: return "freeBlock";
+        case GET_FREE_INODE: return "getFreeInode";
+        case LOAD_DIRECTORY: return "loadDirectory";
+        case SYNC: return "sync";
+        default: return "unknown";
+    }
+}
+
+IoStats::~IoStats() {
+    if (!jsonPath.empty()) {
+        writeJson(jsonPath);
+    }
+}
+
+void IoStats::record(Op op, uint64_t ns, int blockIdx, int blockCount) {
+    Counters& c = counters[op];
+    c.calls.fetch_add(1, memory_order_relaxed);
+    c.blocks.fetch_add(blockCount, memory_order_relaxed);
+    if (op == READ_BLOCKS || op == WRITE_BLOCKS || op == LOAD_DIRECTORY) {
+        c.bytes.fetch_add(1ULL * blockCount * sizeof(Block), memory_order_relaxed);
+    }
+
+    c.totalNs.fetch_add(ns, memory_order_relaxed);
+
+    int bucket = min((int) bit_width(ns) - 1, IoOpStats::HISTOGRAM_BUCKETS - 1);
+    c.histogram[max(bucket, 0)].fetch_add(1, memory_order_relaxed);
+
+    if (blockIdx >= 0) {
+        int prevHead = headBlock.exchange(blockIdx + blockCount, memory_order_relaxed);
+        if (prevHead != blockIdx) {
+            c.seeks.fetch_add(1, memory_order_relaxed);
+        }
+    }
+}
+
+IoStats::Snapshot IoStats::snapshot() const {
+    Snapshot s;
+    for (int op = 0; op < OP_COUNT; op++) {
+        const Counters& c = counters[op];
+        IoOpStats& o = s.ops[op];
+        o.calls = c.calls.load(memory_order_relaxed);
+        o.blocks = c.blocks.load(memory_order_relaxed);
+        o.bytes = c.bytes.load(memory_order_relaxed);
+        o.seeks = c.seeks.load(memory_order_relaxed);
+        o.totalNs = c.totalNs.load(memory_order_relaxed);
+        for (int idx = 0; idx < IoOpStats::HISTOGRAM_BUCKETS; idx++) {
+            o.histogram[idx] = c.histogram[idx].load(memory_order_relaxed);
+        }
+    }
+
+    return s;
+}
+
+void IoStats::beginCommand(int command) {
+    currentCommand = command;
+    commandBegin = snapshot();
+}
+
+void IoStats::endCommand() {
+    if (currentCommand < 0) {
+        return;
+    }
+
+    Snapshot delta = snapshot();
+    delta -= commandBegin;
+
+    CommandStats& cmd = commands[currentCommand];
+    cmd.count++;
+    cmd.stats += delta;
+    currentCommand = -1;
+}
+
+/**
+ * 输出一组统计的表格。
+ */
+static void printSnapshot(ostream& out, const IoStats::Snapshot& s) {
+    // 表头用英文，中文字符会打乱 setw 的对齐。
+    out << "  " << left << setw(15) << "op" << right
+        << setw(9) << "calls" << setw(9) << "blocks" << setw(12) << "bytes"
+        << setw(8) << "seeks" << setw(12) << "total(us)"
+        << setw(10) << "p50(us)" << setw(10) << "p99(us)" << endl;
+
+    for (int op = 0; op < IoStats::OP_COUNT; op++) {
+        const IoOpStats& o = s.ops[op];
+        if (o.calls == 0) {
+            continue;
+        }
+
+        out << "  " << left << setw(15) << IoStats::opName((IoStats::Op) op) << right
+            << setw(9) << o.calls << setw(9) << o.blocks << setw(12) << o.bytes
+            << setw(8) << o.seeks << setw(12) << o.totalNs / 1000
+            << setw(10) << o.percentileNs(0.5) / 1000.0
+            << setw(10) << o.percentileNs(0.99) / 1000.0 << endl;
+    }
+}
+
+void IoStats::printReport(ostream& out) const {
+    if (!enabled()) {
+        out << "[info] 统计未编译进程序（编译时需要定义 V6PP_WITH_STATS）。" << endl;
+        return;
+    }
+
+    out << "[info] I/O 统计（p50、p99 为直方图桶的上界）。" << endl;
+    for (auto& [command, cmd] : commands) {
+        out << "命令 " << char(command) << "，执行 " << cmd.count << " 次：" << endl;
+        printSnapshot(out, cmd.stats);
+    }
+
+    out << "会话总计：" << endl;
+    printSnapshot(out, snapshot());
+}
+
+/**
+ * 以 JSON 对象输出一组统计。
+ */
+static void writeSnapshotJson(ostream& out, const IoStats::Snapshot& s) {
+    out << "{";
+    bool first = true;
+    for (int op = 0; op < IoStats::OP_COUNT; op++) {
+        const IoOpStats& o = s.ops[op];
+        if (o.calls == 0) {
+            continue;
+        }
+
+        out << (first ? "" : ",") << "\"" << IoStats::opName((IoStats::Op) op) << "\":{"
+            << "\"calls\":" << o.calls << ",\"blocks\":" << o.blocks
+            << ",\"bytes\":" << o.bytes << ",\"seeks\":" << o.seeks
+            << ",\"totalNs\":" << o.totalNs << ",\"histogramLog2Ns\":[";
+        first = false;
+
+        // 去掉末尾的空桶。
+        int buckets = IoOpStats::HISTOGRAM_BUCKETS;
+        while (buckets > 0 && o.histogram[buckets - 1] == 0) {
+            buckets--;
+        }
+
+        for (int idx = 0; idx < buckets; idx++) {
+            out << (idx == 0 ? "" : ",") << o.histogram[idx];
+        }
+
+        out << "]}";
+    }
+
+    out << "}";
+}
+
+void IoStats::writeJson(ostream& out) const {
+    out << "{\"enabled\":" << (enabled() ? "true" : "false") << ",\"total\":";
+    writeSnapshotJson(out, snapshot());
+    out << ",\"commands\":{";
+
+    bool first = true;
+    for (auto& [command, cmd] : commands) {
+        out << (first ? "" : ",") << "\"" << char(command) << "\":{\"count\":" << cmd.count << ",\"ops\":";
+        writeSnapshotJson(out, cmd.stats);
+        out << "}";
+        first = false;
+    }
+
+    out << "}}" << endl;
+}
+
+bool IoStats::writeJson(const string& path) const {
+    ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    writeJson(out);
+    return out.good();
+}
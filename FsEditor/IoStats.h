@@ -0,0 +1,191 @@
+/*
+ * I/O 统计 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+/**
+ * 一类操作的统计快照。
+ */
+struct IoOpStats {
+    /** 延迟直方图的桶数。第 i 个桶统计耗时在 [2^i, 2^(i+1)) 纳秒之间的调用。 */
+    static const int HISTOGRAM_BUCKETS = 40;
+
+    uint64_t calls = 0;
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+
+    /** 起始盘块与上一次读写的结束位置不连续的次数。 */
+    uint64_t seeks = 0;
+    uint64_t totalNs = 0;
+    uint64_t histogram[HISTOGRAM_BUCKETS] = {};
+
+    IoOpStats& operator += (const IoOpStats& other);
+    IoOpStats& operator -= (const IoOpStats& other);
+
+    /**
+     * 从直方图估计分位数。返回所在桶的上界（纳秒）。
+     */
+    uint64_t percentileNs(double p) const;
+};
+
+/**
+ * I/O 统计。
+ *
+ * 统计 readBlocks、writeBlocks、getFreeBlock、freeBlock、getFreeInode、
+ * 目录加载（InodeDirectory 构造）与 sync 的调用次数、盘块数、字节数、寻道次数和耗时直方图。
+ * 计数器都是原子变量，可以被多个线程同时更新。
+ *
+ * 编译时未定义 V6PP_WITH_STATS 时，V6PP_STAT_SCOPE 展开为空，统计没有任何开销。
+ */
+class IoStats {
+public:
+    enum Op {
+        READ_BLOCKS = 0,
+        WRITE_BLOCKS,
+        GET_FREE_BLOCK,
+        FREE_BLOCK,
+        GET_FREE_INODE,
+        LOAD_DIRECTORY,
+        SYNC,
+
+        OP_COUNT
+    };
+
+    static const char* opName(Op op);
+
+    /**
+     * 所有操作的统计快照。
+     */
+    struct Snapshot {
+        IoOpStats ops[OP_COUNT];
+
+        Snapshot& operator += (const Snapshot& other);
+        Snapshot& operator -= (const Snapshot& other);
+    };
+
+    /**
+     * 一个命令的累计统计。
+     */
+    struct CommandStats {
+        uint64_t count = 0;
+        Snapshot stats;
+    };
+
+public:
+    ~IoStats();
+
+    /**
+     * 统计是否编译进程序。
+     */
+    static constexpr bool enabled() {
+#ifdef V6PP_WITH_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * 记录一次操作。
+     *
+     * @param blockIdx 读写的起始盘块号。-1 表示不是盘块读写，不判断寻道。
+     * @param blockCount 涉及的盘块数。
+     */
+    void record(Op op, uint64_t ns, int blockIdx, int blockCount);
+
+    Snapshot snapshot() const;
+
+    /**
+     * 开始一条命令：记下当前的统计。
+     */
+    void beginCommand(int command);
+
+    /**
+     * 结束命令：把命令期间的增量计入该命令。
+     */
+    void endCommand();
+
+    /**
+     * 输出按命令分组的统计表。
+     */
+    void printReport(std::ostream& out) const;
+
+    /**
+     * 以 JSON 输出总计与按命令分组的统计。
+     */
+    void writeJson(std::ostream& out) const;
+
+    /**
+     * 将 JSON 写入文件。
+     *
+     * @return 是否成功。
+     */
+    bool writeJson(const std::string& path) const;
+
+public:
+    /** 非空时，析构时将统计以 JSON 写入该文件。 */
+    std::string jsonPath;
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> calls = 0;
+        std::atomic<uint64_t> blocks = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> seeks = 0;
+        std::atomic<uint64_t> totalNs = 0;
+        std::atomic<uint64_t> histogram[IoOpStats::HISTOGRAM_BUCKETS] = {};
+    };
+
+    Counters counters[OP_COUNT];
+
+    /** 上一次盘块读写结束的位置。用于判断寻道。 */
+    std::atomic<int> headBlock = -1;
+
+    std::map<int, CommandStats> commands;
+    int currentCommand = -1;
+    Snapshot commandBegin;
+};
+
+/**
+ * 计时作用域。析构时记录一次操作。
+ */
+class IoStatsScope {
+public:
+    inline IoStatsScope(IoStats& stats, IoStats::Op op, int blockIdx, int blockCount)
+        : stats(stats), op(op), blockIdx(blockIdx), blockCount(blockCount),
+          begin(std::chrono::steady_clock::now()) {}
+
+    inline ~IoStatsScope() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin
+        ).count();
+        stats.record(op, ns, blockIdx, blockCount);
+    }
+
+private:
+    IoStats& stats;
+    IoStats::Op op;
+    int blockIdx;
+    int blockCount;
+    std::chrono::steady_clock::time_point begin;
+};
+
+#define V6PP_STAT_CONCAT_(a, b) a##b
+#define V6PP_STAT_CONCAT(a, b) V6PP_STAT_CONCAT_(a, b)
+
+#ifdef V6PP_WITH_STATS
+    #define V6PP_STAT_SCOPE(stats, op, blockIdx, blockCount) \
+        IoStatsScope V6PP_STAT_CONCAT(v6ppStatScope_, __LINE__)((stats), IoStats::op, (blockIdx), (blockCount))
+#else
+    #define V6PP_STAT_SCOPE(stats, op, blockIdx, blockCount) ((void) 0)
+#endif
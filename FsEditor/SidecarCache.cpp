@@ -0,0 +1,227 @@
+/*
+ * 附属缓存文件 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include "./SidecarCache.h"
+#include "./FileSystemAdapter.h"
+#include "./MachineProps.h"
+#include "./structures/InodeDirectory.h"
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+using namespace std;
+
+static_assert(SidecarDirIndexEntry::NAME_SIZE == DirectoryEntry::DIRSIZE);
+
+/** 缓存文件头。 */
+static const char SIDECAR_CACHE_MAGIC[8] = {'V', '6', 'P', 'P', 'C', 'C', 'H', '1'};
+static const uint32_t SIDECAR_CACHE_VERSION = 1;
+
+/** 各段按 8 字节对齐。 */
+static inline uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~7ULL;
+}
+
+/** 目录名索引的排序规则：先按目录，再按文件名。 */
+static inline bool dirIndexLess(const SidecarDirIndexEntry& a, const SidecarDirIndexEntry& b) {
+    if (a.dirIno != b.dirIno) {
+        return a.dirIno < b.dirIno;
+    }
+
+    return strncmp(a.name, b.name, DirectoryEntry::DIRSIZE) < 0;
+}
+
+SidecarCache::~SidecarCache() {
+#ifdef __linux__
+    if (data != nullptr && buffer.empty()) {
+        munmap((void*) data, length);
+    }
+#endif
+}
+
+SidecarCache* SidecarCache::open(const string& path, uint32_t sTime, uint64_t checksum) {
+    SidecarCache* cache = new SidecarCache;
+
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        delete cache;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= sizeof(SidecarCacheHeader)) {
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            cache->data = (const char*) mapped;
+            cache->length = st.st_size;
+        }
+    }
+
+    close(fd);
+#endif
+
+    if (cache->data == nullptr) {
+        // 映射失败或不支持 mmap：整体读入。
+        ifstream f(path, ios::in | ios::binary | ios::ate);
+        if (!f.is_open()) {
+            delete cache;
+            return nullptr;
+        }
+
+        cache->buffer.resize(f.tellg());
+        f.seekg(0, ios::beg);
+        f.read(cache->buffer.data(), cache->buffer.size());
+        cache->data = cache->buffer.data();
+        cache->length = cache->buffer.size();
+    }
+
+    // 校验。
+    const SidecarCacheHeader* header = (const SidecarCacheHeader*) cache->data;
+    bool valid = cache->length >= sizeof(SidecarCacheHeader) 
+        && memcmp(header->magic, SIDECAR_CACHE_MAGIC, sizeof(header->magic)) == 0 
+        && header->version == SIDECAR_CACHE_VERSION 
+        && header->sTime == sTime 
+        && header->checksum == checksum 
+        && header->diskBlocks == MachineProps::diskBlocks() 
+        && header->freeBlocksOffset + (header->diskBlocks + 7) / 8 <= cache->length 
+        && header->freeInodesOffset + (header->inodeCount + 7) / 8 <= cache->length 
+        && header->ownersOffset + 1ULL * header->diskBlocks * sizeof(BlockOwner) <= cache->length 
+        && header->dirIndexOffset + header->dirIndexCount * sizeof(SidecarDirIndexEntry) <= cache->length;
+
+    if (!valid) {
+        delete cache;
+        return nullptr;
+    }
+
+    cache->header = header;
+    cache->freeBlocks = (const uint8_t*) (cache->data + header->freeBlocksOffset);
+    cache->freeInodes = (const uint8_t*) (cache->data + header->freeInodesOffset);
+    cache->ownerTable = (const BlockOwner*) (cache->data + header->ownersOffset);
+    cache->dirIndex = (const SidecarDirIndexEntry*) (cache->data + header->dirIndexOffset);
+    cache->dirIndexCount = header->dirIndexCount;
+
+    return cache;
+}
+
+bool SidecarCache::save(const string& path, FileSystemAdapter& adapter) {
+    int diskBlocks = MachineProps::diskBlocks();
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+
+    // 空闲盘块：数据区中不在用的盘块。空闲链的链接块本身也是空闲盘块。
+    vector<bool> live;
+    uint32_t nfree = adapter.superBlock.s_nfree;
+    adapter.superBlock.s_nfree = 0;
+    adapter.markLiveBlocks(live);
+    adapter.superBlock.s_nfree = nfree;
+
+    vector<uint8_t> freeBlocks((diskBlocks + 7) / 8, 0);
+    for (
+        int idx = adapter.superBlock.data_zone_begin; 
+        idx < adapter.superBlock.data_zone_begin + adapter.superBlock.data_zone_blocks; 
+        idx++
+    ) {
+        if (!live[idx]) {
+            freeBlocks[idx / 8] |= 1 << (idx % 8);
+        }
+    }
+
+    vector<uint8_t> freeInodes((inodeCount + 7) / 8, 0);
+    for (int ino = adapter.ROOT_INODE_IDX + 1; ino < inodeCount; ino++) {
+        if (!adapter.inodes[ino].ialloc) {
+            freeInodes[ino / 8] |= 1 << (ino % 8);
+        }
+    }
+
+    // 盘块归属表。开启了反查表时直接使用。
+    BlockOwnerMap* owners = adapter.ownerMap;
+    if (owners == nullptr) {
+        owners = new BlockOwnerMap(diskBlocks);
+        owners->build(adapter);
+    }
+
+    // 目录名索引。
+    vector<SidecarDirIndexEntry> dirIndex;
+    for (int ino = 1; ino < inodeCount; ino++) {
+        Inode& inode = adapter.inodes[ino];
+        if (!inode.ialloc || inode.file_type != Inode::FileType::DIR) {
+            continue;
+        }
+
+        DirectoryView dir(inode, adapter);
+        dir.forEach([&] (const DirectoryEntry& dirEntry) {
+            SidecarDirIndexEntry entry;
+            entry.dirIno = ino;
+            entry.ino = dirEntry.m_ino;
+            memcpy(entry.name, dirEntry.m_name, sizeof(entry.name));
+            dirIndex.push_back(entry);
+        });
+    }
+
+    sort(dirIndex.begin(), dirIndex.end(), dirIndexLess);
+
+    // 排布各段。
+    SidecarCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SIDECAR_CACHE_MAGIC, sizeof(header.magic));
+    header.version = SIDECAR_CACHE_VERSION;
+    header.sTime = adapter.superBlock.s_time;
+    header.checksum = adapter.metadataChecksum();
+    header.diskBlocks = diskBlocks;
+    header.inodeCount = inodeCount;
+    header.freeBlocksOffset = align8(sizeof(header));
+    header.freeInodesOffset = align8(header.freeBlocksOffset + freeBlocks.size());
+    header.ownersOffset = align8(header.freeInodesOffset + freeInodes.size());
+    header.dirIndexOffset = align8(header.ownersOffset + owners->owners.size() * sizeof(BlockOwner));
+    header.dirIndexCount = dirIndex.size();
+
+    ofstream f(path, ios::out | ios::binary | ios::trunc);
+    bool result = f.is_open();
+    if (result) {
+        auto writeAt = [&] (uint64_t offset, const void* data, size_t length) {
+            while (f.tellp() < (streamoff) offset) {
+                f.put(0);
+            }
+
+            f.write((const char*) data, length);
+        };
+
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.freeBlocksOffset, freeBlocks.data(), freeBlocks.size());
+        writeAt(header.freeInodesOffset, freeInodes.data(), freeInodes.size());
+        writeAt(header.ownersOffset, owners->owners.data(), owners->owners.size() * sizeof(BlockOwner));
+        writeAt(header.dirIndexOffset, dirIndex.data(), dirIndex.size() * sizeof(SidecarDirIndexEntry));
+        result = f.good();
+    }
+
+    if (owners != adapter.ownerMap) {
+        delete owners;
+    }
+
+    return result;
+}
+
+int SidecarCache::lookup(int dirIno, const string& name) const {
+    SidecarDirIndexEntry key;
+    key.dirIno = dirIno;
+    memset(key.name, 0, sizeof(key.name));
+    memcpy(key.name, name.c_str(), min(name.length(), sizeof(key.name)));
+
+    const SidecarDirIndexEntry* end = dirIndex + dirIndexCount;
+    const SidecarDirIndexEntry* it = lower_bound(dirIndex, end, key, dirIndexLess);
+    if (it != end && it->dirIno == dirIno && strncmp(it->name, key.name, sizeof(key.name)) == 0) {
+        return it->ino;
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * 附属缓存文件 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "./MacroDefines.h"
+#include "./BlockOwnerMap.h"
+
+/**
+ * 缓存文件头。各段的偏移都按 8 字节对齐，映射后可以直接按数组访问。
+ */
+class SidecarCacheHeader {
+public:
+    char magic[8];
+    uint32_t version;
+
+    /** 生成缓存时 superblock 的 s_time。 */
+    uint32_t sTime;
+
+    /** 生成缓存时 superblock 与 inode 表的校验值。 */
+    uint64_t checksum;
+
+    uint32_t diskBlocks;
+    uint32_t inodeCount;
+
+    /** 空闲盘块位图：每个盘块 1 位，1 表示空闲。 */
+    uint64_t freeBlocksOffset;
+
+    /** 空闲 inode 位图：每个 inode 1 位，1 表示空闲。 */
+    uint64_t freeInodesOffset;
+
+    /** 盘块归属表：BlockOwner[diskBlocks]。 */
+    uint64_t ownersOffset;
+
+    /** 目录名索引：按 (目录 inode 号, 文件名) 排序的 SidecarDirIndexEntry 数组。 */
+    uint64_t dirIndexOffset;
+    uint64_t dirIndexCount;
+} __packed;
+
+/**
+ * 目录名索引项。
+ */
+class SidecarDirIndexEntry {
+public:
+    /** 与 DirectoryEntry::DIRSIZE 相同。 */
+    static const int NAME_SIZE = 28;
+
+public:
+    uint32_t dirIno;
+    uint32_t ino;
+    char name[NAME_SIZE];
+} __packed;
+
+/**
+ * 附属缓存：保存空闲盘块位图、空闲 inode 位图、盘块归属表与目录名索引，
+ * 使同一映像上的多次调用不必每次都遍历文件系统重建。
+ * 
+ * 缓存文件放在映像旁（后缀 .cache），打开时整体映射到内存，
+ * 并用 s_time 与 superblock、inode 表的校验值判断是否过期。
+ * 缓存只描述磁盘上的状态：会话中一旦修改了元数据，适配器就不再使用它，并在 sync 时重新生成。
+ */
+class SidecarCache {
+public:
+    ~SidecarCache();
+
+    /**
+     * 打开并校验缓存文件。
+     * 
+     * @return 缓存对象。文件不存在、格式不对或已过期时返回 nullptr。
+     */
+    static SidecarCache* open(const std::string& path, uint32_t sTime, uint64_t checksum);
+
+    /**
+     * 遍历文件系统，生成缓存文件。
+     */
+    static bool save(const std::string& path, class FileSystemAdapter& adapter);
+
+    inline bool isBlockFree(int blockIdx) const {
+        return blockIdx >= 0 && blockIdx < header->diskBlocks 
+            && (freeBlocks[blockIdx / 8] >> (blockIdx % 8) & 1);
+    }
+
+    inline bool isInodeFree(int ino) const {
+        return ino >= 0 && ino < header->inodeCount 
+            && (freeInodes[ino / 8] >> (ino % 8) & 1);
+    }
+
+    inline const BlockOwner* owners() const {
+        return ownerTable;
+    }
+
+    inline uint32_t diskBlocks() const {
+        return header->diskBlocks;
+    }
+
+    /**
+     * 在目录中查找文件名。
+     * 
+     * @return inode 号。0 表示目录中没有这个名字。
+     */
+    int lookup(int dirIno, const std::string& name) const;
+
+private:
+    SidecarCache() {}
+
+    const char* data = nullptr;
+    size_t length = 0;
+
+    /** 不支持 mmap 时，文件内容读入这里。 */
+    std::vector<char> buffer;
+
+    const SidecarCacheHeader* header = nullptr;
+    const uint8_t* freeBlocks = nullptr;
+    const uint8_t* freeInodes = nullptr;
+    const BlockOwner* ownerTable = nullptr;
+    const SidecarDirIndexEntry* dirIndex = nullptr;
+    uint64_t dirIndexCount = 0;
+};
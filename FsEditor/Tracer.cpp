@@ -0,0 +1,269 @@
+/*
+ * 时间线追踪（Chrome trace event 格式） - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include "./Tracer.h"
+
+using namespace std;
+
+thread_local TraceSpan* TraceSpan::current = nullptr;
+
+/**
+ * 当前线程登记的缓冲区，以及登记时的追踪代数。
+ */
+struct ThreadBufferSlot {
+    int generation = -1;
+    void* buffer = nullptr;
+};
+
+static thread_local ThreadBufferSlot threadBufferSlot;
+
+static uint64_t steadyNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::~Tracer() {
+    if (active()) {
+        stop();
+    }
+
+    clear();
+}
+
+void Tracer::start(const string& path) {
+    if (active()) {
+        stop();
+    }
+
+    clear();
+    outputPath = path;
+    originNs = steadyNs();
+    generation.fetch_add(1, memory_order_release);
+    enabled.store(true, memory_order_release);
+}
+
+bool Tracer::stop() {
+    if (!active()) {
+        return false;
+    }
+
+    enabled.store(false, memory_order_release);
+    bool res = writeJson(outputPath);
+    clear();
+    return res;
+}
+
+uint64_t Tracer::now() const {
+    return steadyNs() - originNs;
+}
+
+Tracer::ThreadBuffer* Tracer::threadBuffer() {
+    int currentGeneration = generation.load(memory_order_acquire);
+    if (threadBufferSlot.generation == currentGeneration) {
+        return (ThreadBuffer*) threadBufferSlot.buffer;
+    }
+
+    // 线程在本次追踪中第一次记录。缓冲区归 Tracer 所有，线程退出后仍然保留到写出为止。
+    ThreadBuffer* buffer = new ThreadBuffer;
+    buffer->head = buffer->tail = new Chunk;
+    {
+        lock_guard<mutex> lock(registryMutex);
+        buffer->tid = (int) buffers.size() + 1;
+        buffers.push_back(buffer);
+    }
+
+    threadBufferSlot.generation = currentGeneration;
+    threadBufferSlot.buffer = buffer;
+    return buffer;
+}
+
+void Tracer::append(TraceEvent&& event) {
+    ThreadBuffer* buffer = threadBuffer();
+    Chunk* chunk = buffer->tail;
+    int count = chunk->count.load(memory_order_relaxed);
+    if (count == Chunk::CAPACITY) {
+        Chunk* next = new Chunk;
+        chunk->next.store(next, memory_order_release);
+        buffer->tail = chunk = next;
+        count = 0;
+    }
+
+    chunk->events[count] = std::move(event);
+
+    // 发布：读取方先读 count，再读事件。
+    chunk->count.store(count + 1, memory_order_release);
+}
+
+void Tracer::recordIo(bool isWrite, int blockIdx, int blockCount, uint64_t beginNs, uint64_t durationNs) {
+    for (TraceSpan* span = TraceSpan::current; span != nullptr; span = span->parent) {
+        if (isWrite) {
+            span->event.writeCalls++;
+            span->event.writeBlocks += blockCount;
+        } else {
+            span->event.readCalls++;
+            span->event.readBlocks += blockCount;
+        }
+    }
+
+    TraceEvent event;
+    event.kind = isWrite ? TraceEvent::WRITE : TraceEvent::READ;
+    event.name = isWrite ? "writeBlocks" : "readBlocks";
+    event.beginNs = beginNs;
+    event.durationNs = durationNs;
+    event.blockIdx = blockIdx;
+    event.blockCount = blockCount;
+    append(std::move(event));
+}
+
+void Tracer::clear() {
+    lock_guard<mutex> lock(registryMutex);
+    for (ThreadBuffer* buffer : buffers) {
+        Chunk* chunk = buffer->head;
+        while (chunk != nullptr) {
+            Chunk* next = chunk->next.load(memory_order_acquire);
+            delete chunk;
+            chunk = next;
+        }
+
+        delete buffer;
+    }
+
+    buffers.clear();
+}
+
+/**
+ * 输出 JSON 字符串（含引号）。
+ */
+static void writeJsonString(ostream& out, const string& s) {
+    out << '"';
+    for (unsigned char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            out << '\\' << ch;
+        } else if (ch < 0x20) {
+            out << "\\u" << hex << setw(4) << setfill('0') << (int) ch << dec << setfill(' ');
+        } else {
+            out << ch;
+        }
+    }
+
+    out << '"';
+}
+
+/**
+ * 纳秒转为 trace event 使用的微秒。
+ */
+static void writeMicros(ostream& out, uint64_t ns) {
+    out << ns / 1000 << '.' << setw(3) << setfill('0') << ns % 1000 << setfill(' ');
+}
+
+bool Tracer::writeJson(const string& path) {
+    ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+    lock_guard<mutex> lock(registryMutex);
+    for (ThreadBuffer* buffer : buffers) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << buffer->tid << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+        first = false;
+
+        for (Chunk* chunk = buffer->head; chunk != nullptr; chunk = chunk->next.load(memory_order_acquire)) {
+            int count = chunk->count.load(memory_order_acquire);
+            for (int idx = 0; idx < count; idx++) {
+                const TraceEvent& e = chunk->events[idx];
+                out << ",\n{\"name\":";
+                writeJsonString(out, e.name);
+                out << ",\"cat\":\"" << (e.kind == TraceEvent::SPAN ? "fs" : "io")
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+                writeMicros(out, e.beginNs);
+                out << ",\"dur\":";
+                writeMicros(out, e.durationNs);
+                out << ",\"args\":{";
+
+                if (e.kind == TraceEvent::SPAN) {
+                    out << "\"detail\":";
+                    writeJsonString(out, e.detail);
+                    out << ",\"readCalls\":" << e.readCalls << ",\"readBlocks\":" << e.readBlocks
+                        << ",\"writeCalls\":" << e.writeCalls << ",\"writeBlocks\":" << e.writeBlocks;
+                } else {
+                    out << "\"block\":" << e.blockIdx << ",\"count\":" << e.blockCount;
+                }
+
+                out << "}}";
+            }
+        }
+    }
+
+    out << "\n]}" << endl;
+    return out.good();
+}
+
+TraceSpan::TraceSpan(const char* name, const char* detail)
+    : recording(Tracer::instance().active()) {
+    if (!recording) {
+        return;
+    }
+
+    event.detail = detail;
+    begin(name);
+}
+
+TraceSpan::TraceSpan(const char* name, const string& detail)
+    : recording(Tracer::instance().active()) {
+    if (!recording) {
+        return;
+    }
+
+    event.detail = detail;
+    begin(name);
+}
+
+TraceSpan::TraceSpan(const char* name, int number)
+    : recording(Tracer::instance().active()) {
+    if (!recording) {
+        return;
+    }
+
+    event.detail = to_string(number);
+    begin(name);
+}
+
+void TraceSpan::begin(const char* name) {
+    event.name = name;
+    event.beginNs = Tracer::instance().now();
+    parent = current;
+    current = this;
+}
+
+TraceSpan::~TraceSpan() {
+    if (!recording) {
+        return;
+    }
+
+    current = parent;
+
+    Tracer& tracer = Tracer::instance();
+    if (!tracer.active()) {
+        // 区间尚未结束时追踪已经停止。
+        return;
+    }
+
+    event.durationNs = tracer.now() - event.beginNs;
+    tracer.append(std::move(event));
+}
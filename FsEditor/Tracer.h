@@ -0,0 +1,185 @@
+/*
+ * 时间线追踪（Chrome trace event 格式） - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * 一条追踪事件。
+ */
+struct TraceEvent {
+    enum Kind : char {
+        SPAN = 'X',
+        READ = 'r',
+        WRITE = 'w'
+    };
+
+    Kind kind = SPAN;
+    const char* name = "";
+
+    /** 附加说明，例如文件名或 inode 号。 */
+    std::string detail;
+
+    uint64_t beginNs = 0;
+    uint64_t durationNs = 0;
+
+    /** 读写事件：起始盘块号与盘块数。 */
+    int blockIdx = -1;
+    int blockCount = 0;
+
+    /** 区间事件：区间内（含嵌套区间）发生的盘块读写。 */
+    uint64_t readCalls = 0;
+    uint64_t readBlocks = 0;
+    uint64_t writeCalls = 0;
+    uint64_t writeBlocks = 0;
+};
+
+/**
+ * 时间线追踪。
+ *
+ * 记录 format、uploadFile、文件盘块遍历、目录加载、sync 等操作的嵌套区间，
+ * 以及每个区间内发生的盘块读写，输出 Chrome trace event JSON，
+ * 可以在 chrome://tracing 或 Perfetto 中打开。
+ *
+ * 每个线程写入自己的缓冲区：缓冲区由定长的块串成链表，只有所属线程追加事件，
+ * 通过原子的计数发布，记录时不需要加锁。线程第一次记录时登记缓冲区（只在此时加锁）。
+ * 未开启时，每个探针只多一次原子读取。
+ */
+class Tracer {
+public:
+    static Tracer& instance();
+
+    ~Tracer();
+
+    /**
+     * 开始追踪。结束（stop 或程序退出）时写入 path。
+     */
+    void start(const std::string& path);
+
+    /**
+     * 结束追踪并写出文件。要求此时没有其他线程仍在记录。
+     *
+     * @return 是否成功写出。
+     */
+    bool stop();
+
+    inline bool active() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * 当前时间。相对于开始追踪的时刻，单位：纳秒。
+     */
+    uint64_t now() const;
+
+    /** 追加一条事件到当前线程的缓冲区。 */
+    void append(TraceEvent&& event);
+
+    /** 记录一次盘块读写，并计入当前线程所有未结束的区间。 */
+    void recordIo(bool isWrite, int blockIdx, int blockCount, uint64_t beginNs, uint64_t durationNs);
+
+private:
+    /** 缓冲区中的一块。 */
+    struct Chunk {
+        static const int CAPACITY = 1024;
+
+        TraceEvent events[CAPACITY];
+        std::atomic<int> count = 0;
+        std::atomic<Chunk*> next = nullptr;
+    };
+
+    /** 一个线程的缓冲区。 */
+    struct ThreadBuffer {
+        int tid;
+        Chunk* head;
+        Chunk* tail;
+    };
+
+    ThreadBuffer* threadBuffer();
+
+    bool writeJson(const std::string& path);
+
+    void clear();
+
+private:
+    std::atomic<bool> enabled = false;
+
+    /** 追踪的代数。重新开始追踪后，各线程重新登记缓冲区。 */
+    std::atomic<int> generation = 0;
+    std::string outputPath;
+    uint64_t originNs = 0;
+
+    std::mutex registryMutex;
+    std::vector<ThreadBuffer*> buffers;
+};
+
+/**
+ * 区间。构造时开始，析构时结束并记录。
+ */
+class TraceSpan {
+public:
+    /*
+     * 附加说明只在追踪开启时才转换、复制。未开启时不构造任何字符串。
+     */
+    TraceSpan(const char* name, const char* detail = "");
+    TraceSpan(const char* name, const std::string& detail);
+    TraceSpan(const char* name, int number);
+    ~TraceSpan();
+
+    /** 当前线程最内层的区间。 */
+    static thread_local TraceSpan* current;
+
+private:
+    friend class Tracer;
+
+    /** 开始记录。调用前已填好附加说明。 */
+    void begin(const char* name);
+
+    bool recording;
+    TraceSpan* parent = nullptr;
+    TraceEvent event;
+};
+
+/**
+ * 盘块读写探针。
+ */
+class TraceIoScope {
+public:
+    inline TraceIoScope(bool isWrite, int blockIdx, int blockCount)
+        : recording(Tracer::instance().active()), isWrite(isWrite),
+          blockIdx(blockIdx), blockCount(blockCount) {
+        if (recording) {
+            beginNs = Tracer::instance().now();
+        }
+    }
+
+    inline ~TraceIoScope() {
+        if (recording) {
+            Tracer& tracer = Tracer::instance();
+            tracer.recordIo(isWrite, blockIdx, blockCount, beginNs, tracer.now() - beginNs);
+        }
+    }
+
+private:
+    bool recording;
+    bool isWrite;
+    int blockIdx;
+    int blockCount;
+    uint64_t beginNs = 0;
+};
+
+#define V6PP_TRACE_CONCAT_(a, b) a##b
+#define V6PP_TRACE_CONCAT(a, b) V6PP_TRACE_CONCAT_(a, b)
+
+#define V6PP_TRACE_SCOPE(name, detail) \
+    TraceSpan V6PP_TRACE_CONCAT(v6ppTraceSpan_, __LINE__)((name), (detail))
+#define V6PP_TRACE_IO(isWrite, blockIdx, blockCount) \
+    TraceIoScope V6PP_TRACE_CONCAT(v6ppTraceIo_, __LINE__)((isWrite), (blockIdx), (blockCount))
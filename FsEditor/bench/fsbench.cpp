@@ -0,0 +1,444 @@
+/*
+ * 文件系统基准测试。
+ *
+ * 生成合成的本地文件树（大量小文件、最大尺寸文件、宽目录与深目录），
+ * 在临时映像上计时 format、load、sync、touch、uploadFile、downloadFile、readFile、rm（递归）与 ls，
+ * 结果以 JSON 输出，便于在 CI 中发现性能回退。
+ *
+ * 用法：fsbench [-d 工作目录] [-n 重复次数] [-o 结果文件]
+ * 工作目录默认为 /dev/shm（不存在时使用系统临时目录），以免测到磁盘本身的延迟。
+ *
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include "./MachineProps.h"
+#include "./FileSystemAdapter.h"
+#include "./structures/Block.h"
+
+#ifdef __linux__
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::filesystem;
+using namespace std::chrono;
+
+/** 小文件树：目录数与每个目录的文件数。 */
+static const int TINY_DIRS = 30;
+static const int TINY_FILES_PER_DIR = 100;
+
+/** 宽目录的目录项数。 */
+static const int WIDE_ENTRIES = 2000;
+
+/** 深目录的层数。每层一个子目录和一个小文件。 */
+static const int DEEP_LEVELS = 64;
+
+/**
+ * 一项测试的结果。
+ */
+struct BenchResult {
+    string name;
+
+    /** 每次重复执行的操作数（例如上传的文件数）。 */
+    long long ops = 0;
+
+    /** 每次重复读写的数据字节数。 */
+    long long bytes = 0;
+
+    vector<uint64_t> samplesNs;
+};
+
+/**
+ * 丢弃输出。计时期间屏蔽适配器打印的信息。
+ */
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+
+    streamsize xsputn(const char*, streamsize n) override {
+        return n;
+    }
+};
+
+class FsBench {
+public:
+    FsBench(const string& workDir, int repetitions)
+        : workDir(workDir), repetitions(repetitions) {}
+
+    /**
+     * 生成本地文件树。
+     */
+    bool prepareHostTrees();
+
+    /**
+     * 执行所有测试。
+     */
+    bool run();
+
+    void writeJson(ostream& out) const;
+
+private:
+    /** 计时一次操作，记入名为 name 的结果。 */
+    void measure(const string& name, long long ops, long long bytes, const function<void ()>& action);
+
+    bool runOnce();
+
+    static bool writeHostFile(const string& path, long long size, unsigned seed);
+
+    /** 在当前目录上传 hostDir 下的所有文件。 */
+    static void uploadDir(FileSystemAdapter& fs, const string& hostDir);
+
+private:
+    string workDir;
+    int repetitions;
+
+    string imgPath;
+    string tinyHostDir;
+    string deepHostFile;
+    string maxHostFile;
+    long long tinyBytes = 0;
+    long long maxFileSize = 0;
+
+    vector<BenchResult> results;
+
+    NullBuffer nullBuffer;
+};
+
+bool FsBench::writeHostFile(const string& path, long long size, unsigned seed) {
+    ofstream f(path, ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+
+    // 简单的线性同余序列，内容可复现且不会被当作空洞。
+    vector<char> buffer(min(size, 1LL << 16));
+    unsigned state = seed * 2654435761u + 1;
+    long long written = 0;
+    while (written < size) {
+        int n = (int) min((long long) buffer.size(), size - written);
+        for (int idx = 0; idx < n; idx++) {
+            state = state * 1103515245u + 12345u;
+            buffer[idx] = char((state >> 16) | 1);
+        }
+
+        f.write(buffer.data(), n);
+        written += n;
+    }
+
+    return f.good();
+}
+
+bool FsBench::prepareHostTrees() {
+    error_code ec;
+    create_directories(workDir, ec);
+    imgPath = workDir + "/bench.img";
+    tinyHostDir = workDir + "/tiny";
+    deepHostFile = workDir + "/deep.txt";
+    maxHostFile = workDir + "/max.bin";
+
+    for (int dirIdx = 0; dirIdx < TINY_DIRS; dirIdx++) {
+        string dir = tinyHostDir + "/d" + to_string(dirIdx);
+        create_directories(dir, ec);
+        for (int fileIdx = 0; fileIdx < TINY_FILES_PER_DIR; fileIdx++) {
+            // 1 到 1024 字节，大多不满一个盘块。
+            long long size = 1 + (dirIdx * 131 + fileIdx * 17) % 1024;
+            if (!writeHostFile(dir + "/f" + to_string(fileIdx), size, dirIdx * 1000 + fileIdx)) {
+                cerr << "[error] 无法写入：" << dir << endl;
+                return false;
+            }
+
+            tinyBytes += size;
+        }
+    }
+
+    // 与 FileSystemAdapter::FS_FILE_SIZE_MAX 相同：6 个直接块、1 个一级索引块、1 个二级索引块。
+    maxFileSize = MachineProps::BLOCK_SIZE * (6 + 128 + 128 * 128);
+
+    return writeHostFile(deepHostFile, 100, 7) && writeHostFile(maxHostFile, maxFileSize, 11);
+}
+
+void FsBench::measure(const string& name, long long ops, long long bytes, const function<void ()>& action) {
+    streambuf* coutBuffer = cout.rdbuf(&nullBuffer);
+    auto begin = steady_clock::now();
+    action();
+    uint64_t ns = duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+    cout.rdbuf(coutBuffer);
+
+    auto it = find_if(results.begin(), results.end(), [&] (const BenchResult& r) {
+        return r.name == name;
+    });
+
+    if (it == results.end()) {
+        results.push_back({ name, ops, bytes, {} });
+        it = results.end() - 1;
+    }
+
+    it->samplesNs.push_back(ns);
+}
+
+void FsBench::uploadDir(FileSystemAdapter& fs, const string& hostDir) {
+    vector<path> files;
+    for (auto& entry : directory_iterator(hostDir)) {
+        files.push_back(entry.path());
+    }
+
+    sort(files.begin(), files.end());
+    for (auto& file : files) {
+        fs.uploadFile(file.filename().string(), file.string());
+    }
+}
+
+bool FsBench::runOnce() {
+    error_code ec;
+    remove(imgPath, ec);
+    {
+        ofstream img(imgPath, ios::binary);
+    }
+
+    resize_file(imgPath, MachineProps::diskSize(), ec);
+    if (ec) {
+        cerr << "[error] 无法创建映像：" << imgPath << endl;
+        return false;
+    }
+
+    long long tinyFiles = 1LL * TINY_DIRS * TINY_FILES_PER_DIR;
+
+    // 第一阶段：构建。
+    {
+        FileSystemAdapter fs(imgPath.c_str());
+        measure("format", 1, 0, [&] {
+            fs.format();
+        });
+
+        measure("uploadFile.tiny", tinyFiles, tinyBytes, [&] {
+            fs.mkdir("tiny");
+            fs.cd("tiny");
+            for (int dirIdx = 0; dirIdx < TINY_DIRS; dirIdx++) {
+                string name = "d" + to_string(dirIdx);
+                fs.mkdir(name);
+                fs.cd(name);
+                uploadDir(fs, tinyHostDir + "/" + name);
+                fs.cd("..");
+            }
+
+            fs.cd("/");
+        });
+
+        measure("sync", 1, 0, [&] {
+            fs.sync();
+        });
+
+        measure("touch.wide", WIDE_ENTRIES, 0, [&] {
+            fs.mkdir("wide");
+            fs.cd("wide");
+            for (int idx = 0; idx < WIDE_ENTRIES; idx++) {
+                fs.touch("e" + to_string(idx), Inode::FileType::NORMAL);
+            }
+        });
+
+        measure("ls.wide", WIDE_ENTRIES, 0, [&] {
+            fs.ls();
+        });
+
+        fs.cd("/");
+
+        measure("uploadFile.deep", DEEP_LEVELS, 100LL * DEEP_LEVELS, [&] {
+            for (int level = 0; level < DEEP_LEVELS; level++) {
+                fs.mkdir("l" + to_string(level));
+                fs.uploadFile("deep.txt", deepHostFile);
+                fs.cd("l" + to_string(level));
+            }
+
+            fs.cd("/");
+        });
+    }
+
+    // 第二阶段：重新打开，读取与删除。
+    FileSystemAdapter* fsPtr = nullptr;
+    measure("load", 1, 0, [&] {
+        fsPtr = new FileSystemAdapter(imgPath.c_str());
+        fsPtr->load();
+    });
+
+    FileSystemAdapter& fs = *fsPtr;
+    string downloadPath = workDir + "/download.bin";
+    vector<char> buffer(((maxFileSize + sizeof(Block) - 1) / sizeof(Block)) * sizeof(Block));
+
+    measure("readFile.tiny", tinyFiles, tinyBytes, [&] {
+        fs.cd("tiny");
+        for (int dirIdx = 0; dirIdx < TINY_DIRS; dirIdx++) {
+            fs.cd("d" + to_string(dirIdx));
+            int dirIno = fs.session().inodeIdxStack.back();
+            for (int fileIdx = 0; fileIdx < TINY_FILES_PER_DIR; fileIdx++) {
+                int ino = fs.lookupEntry(dirIno, "f" + to_string(fileIdx));
+                if (ino > 0) {
+                    fs.readFile(buffer.data(), fs.inodes[ino]);
+                }
+            }
+
+            fs.cd("..");
+        }
+
+        fs.cd("/");
+    });
+
+    measure("downloadFile.tiny", tinyFiles, tinyBytes, [&] {
+        fs.cd("tiny");
+        for (int dirIdx = 0; dirIdx < TINY_DIRS; dirIdx++) {
+            fs.cd("d" + to_string(dirIdx));
+            for (int fileIdx = 0; fileIdx < TINY_FILES_PER_DIR; fileIdx++) {
+                fstream f(downloadPath, ios::out | ios::binary | ios::trunc);
+                fs.downloadFile("f" + to_string(fileIdx), f);
+            }
+
+            fs.cd("..");
+        }
+
+        fs.cd("/");
+    });
+
+    measure("rm.tiny", tinyFiles + TINY_DIRS + 1, 0, [&] {
+        fs.rm("tiny");
+    });
+
+    measure("rm.wide", WIDE_ENTRIES + 1, 0, [&] {
+        fs.rm("wide");
+    });
+
+    measure("rm.deep", 2LL * DEEP_LEVELS, 0, [&] {
+        fs.rm("l0");
+        fs.rm("deep.txt");
+    });
+
+    // 删空之后，最大尺寸的文件才放得下。
+    measure("uploadFile.max", 1, maxFileSize, [&] {
+        fs.uploadFile("max.bin", maxHostFile);
+    });
+
+    measure("readFile.max", 1, maxFileSize, [&] {
+        int ino = fs.lookupEntry(fs.ROOT_INODE_IDX, "max.bin");
+        if (ino > 0) {
+            fs.readFile(buffer.data(), fs.inodes[ino]);
+        }
+    });
+
+    measure("downloadFile.max", 1, maxFileSize, [&] {
+        fstream f(downloadPath, ios::out | ios::binary | ios::trunc);
+        fs.downloadFile("max.bin", f);
+    });
+
+    measure("rm.max", 1, 0, [&] {
+        fs.rm("max.bin");
+    });
+
+    measure("sync.final", 1, 0, [&] {
+        fs.sync();
+    });
+
+    delete fsPtr;
+    remove(downloadPath, ec);
+    return true;
+}
+
+bool FsBench::run() {
+    for (int rep = 0; rep < repetitions; rep++) {
+        if (!runOnce()) {
+            return false;
+        }
+
+        cerr << "[info] 第 " << rep + 1 << "/" << repetitions << " 轮完成。" << endl;
+    }
+
+    return true;
+}
+
+void FsBench::writeJson(ostream& out) const {
+    out << "{\"image\":{\"blocks\":" << MachineProps::diskBlocks()
+        << ",\"blockSize\":" << MachineProps::BLOCK_SIZE << "},"
+        << "\"workDir\":\"" << workDir << "\",\"repetitions\":" << repetitions << ",\"results\":[";
+
+    for (size_t idx = 0; idx < results.size(); idx++) {
+        const BenchResult& r = results[idx];
+        vector<uint64_t> sorted = r.samplesNs;
+        sort(sorted.begin(), sorted.end());
+
+        uint64_t total = 0;
+        for (uint64_t ns : sorted) {
+            total += ns;
+        }
+
+        uint64_t median = sorted[sorted.size() / 2];
+        out << (idx == 0 ? "" : ",") << "\n{\"name\":\"" << r.name << "\",\"ops\":" << r.ops
+            << ",\"bytes\":" << r.bytes
+            << ",\"minNs\":" << sorted.front() << ",\"medianNs\":" << median
+            << ",\"maxNs\":" << sorted.back() << ",\"meanNs\":" << total / sorted.size()
+            << ",\"nsPerOp\":" << (r.ops > 0 ? median / r.ops : median)
+            << ",\"mbPerSec\":" << (r.bytes > 0 && median > 0 ? r.bytes * 1000.0 / median : 0.0)
+            << ",\"samplesNs\":[";
+
+        for (size_t s = 0; s < r.samplesNs.size(); s++) {
+            out << (s == 0 ? "" : ",") << r.samplesNs[s];
+        }
+
+        out << "]}";
+    }
+
+    out << "\n]}" << endl;
+}
+
+int main(int argc, const char* argv[]) {
+    string baseDir = is_directory("/dev/shm") ? "/dev/shm" : temp_directory_path().string();
+    string outPath;
+    int repetitions = 5;
+
+    for (int idx = 1; idx < argc; idx++) {
+        string arg = argv[idx];
+        if (idx + 1 < argc && arg == "-d") {
+            baseDir = argv[++idx];
+        } else if (idx + 1 < argc && arg == "-n") {
+            repetitions = max(1, atoi(argv[++idx]));
+        } else if (idx + 1 < argc && arg == "-o") {
+            outPath = argv[++idx];
+        } else {
+            cerr << "usage: fsbench [-d workDir] [-n repetitions] [-o result.json]" << endl;
+            return -1;
+        }
+    }
+
+#ifdef __linux__
+    string workDir = baseDir + "/fsbench-" + to_string(getpid());
+#else
+    string workDir = baseDir + "/fsbench";
+#endif
+
+    FsBench bench(workDir, repetitions);
+    bool ok = bench.prepareHostTrees() && bench.run();
+
+    if (ok) {
+        if (outPath.empty()) {
+            bench.writeJson(cout);
+        } else {
+            ofstream out(outPath);
+            bench.writeJson(out);
+            ok = out.good();
+        }
+    }
+
+    error_code ec;
+    remove_all(workDir, ec);
+    return ok ? 0 : -1;
+}
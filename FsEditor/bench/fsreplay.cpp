@@ -0,0 +1,604 @@
+/*
+ * 盘块访问记录重放工具。
+ *
+ * 读入 fsedit 记录的盘块访问（o |iotrace| |file|），先输出记录的概况（按操作与调用方统计、
+ * 涉及的不同盘块数），再在映像的临时副本上，以不同的读写方式与缓存容量重放，比较耗时与实际读写量。
+ *
+ * 用法：fsreplay <记录文件> [-i 映像] [-b pread,stream,mmap] [-c 0,64,256,1024] [-o 结果文件]
+ * 不指定映像时只输出概况。缓存是写回式的 LRU 盘块缓存，容量以盘块计，0 表示不缓存。
+ *
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include "./BlockTrace.h"
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * 重放使用的读写方式。
+ */
+class ReplayBackend {
+public:
+    virtual ~ReplayBackend() {}
+
+    virtual bool read(char* buffer, int blockIdx, int blockCount) = 0;
+    virtual bool write(const char* buffer, int blockIdx, int blockCount) = 0;
+
+    /** 结束前落盘。 */
+    virtual void flush() {}
+
+    /**
+     * 创建读写方式。
+     *
+     * @return nullptr 表示名字不认识或打开失败。
+     */
+    static ReplayBackend* create(const string& name, const string& imgPath, int blockSize);
+
+public:
+    uint64_t readCalls = 0;
+    uint64_t readBlocks = 0;
+    uint64_t writeCalls = 0;
+    uint64_t writeBlocks = 0;
+};
+
+/** 文件流。与适配器在没有 pread 时的方式相同。 */
+class StreamBackend : public ReplayBackend {
+public:
+    StreamBackend(const string& imgPath, int blockSize) : blockSize(blockSize) {
+        f.open(imgPath, ios::in | ios::out | ios::binary);
+    }
+
+    bool read(char* buffer, int blockIdx, int blockCount) override {
+        f.seekg(1LL * blockIdx * blockSize, ios::beg);
+        f.read(buffer, 1LL * blockCount * blockSize);
+        return f.good();
+    }
+
+    bool write(const char* buffer, int blockIdx, int blockCount) override {
+        f.seekp(1LL * blockIdx * blockSize, ios::beg);
+        f.write(buffer, 1LL * blockCount * blockSize);
+        return f.good();
+    }
+
+    void flush() override {
+        f.flush();
+    }
+
+public:
+    fstream f;
+    int blockSize;
+};
+
+#ifdef __linux__
+
+/** pread/pwrite。与适配器的默认方式相同。 */
+class PreadBackend : public ReplayBackend {
+public:
+    PreadBackend(const string& imgPath, int blockSize) : blockSize(blockSize) {
+        fd = open(imgPath.c_str(), O_RDWR);
+    }
+
+    ~PreadBackend() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool read(char* buffer, int blockIdx, int blockCount) override {
+        long long bytes = 1LL * blockCount * blockSize;
+        return pread(fd, buffer, bytes, 1LL * blockIdx * blockSize) == bytes;
+    }
+
+    bool write(const char* buffer, int blockIdx, int blockCount) override {
+        long long bytes = 1LL * blockCount * blockSize;
+        return pwrite(fd, buffer, bytes, 1LL * blockIdx * blockSize) == bytes;
+    }
+
+    void flush() override {
+        fdatasync(fd);
+    }
+
+public:
+    int fd = -1;
+    int blockSize;
+};
+
+/** 整个映像映射到内存。 */
+class MmapBackend : public ReplayBackend {
+public:
+    MmapBackend(const string& imgPath, int blockSize) : blockSize(blockSize) {
+        int fd = open(imgPath.c_str(), O_RDWR);
+        if (fd < 0) {
+            return;
+        }
+
+        length = lseek(fd, 0, SEEK_END);
+        void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped != MAP_FAILED) {
+            data = (char*) mapped;
+        }
+    }
+
+    ~MmapBackend() {
+        if (data != nullptr) {
+            munmap(data, length);
+        }
+    }
+
+    bool read(char* buffer, int blockIdx, int blockCount) override {
+        memcpy(buffer, data + 1LL * blockIdx * blockSize, 1LL * blockCount * blockSize);
+        return true;
+    }
+
+    bool write(const char* buffer, int blockIdx, int blockCount) override {
+        memcpy(data + 1LL * blockIdx * blockSize, buffer, 1LL * blockCount * blockSize);
+        return true;
+    }
+
+    void flush() override {
+        msync(data, length, MS_SYNC);
+    }
+
+public:
+    char* data = nullptr;
+    long long length = 0;
+    int blockSize;
+};
+
+#endif
+
+ReplayBackend* ReplayBackend::create(const string& name, const string& imgPath, int blockSize) {
+    if (name == "stream") {
+        StreamBackend* backend = new StreamBackend(imgPath, blockSize);
+        if (backend->f.is_open()) {
+            return backend;
+        }
+
+        delete backend;
+    }
+
+#ifdef __linux__
+    if (name == "pread") {
+        PreadBackend* backend = new PreadBackend(imgPath, blockSize);
+        if (backend->fd >= 0) {
+            return backend;
+        }
+
+        delete backend;
+    } else if (name == "mmap") {
+        MmapBackend* backend = new MmapBackend(imgPath, blockSize);
+        if (backend->data != nullptr) {
+            return backend;
+        }
+
+        delete backend;
+    }
+#endif
+
+    return nullptr;
+}
+
+/**
+ * 写回式 LRU 盘块缓存。未命中的连续盘块合并成一次读。
+ */
+class ReplayCache {
+public:
+    ReplayCache(ReplayBackend& backend, int capacity, int blockSize)
+        : backend(backend), capacity(capacity), blockSize(blockSize) {}
+
+    bool read(char* buffer, int blockIdx, int blockCount);
+    bool write(const char* buffer, int blockIdx, int blockCount);
+
+    /** 写回所有脏盘块。 */
+    bool flush();
+
+public:
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t writeBacks = 0;
+
+private:
+    struct Entry {
+        int blockIdx;
+        bool dirty;
+        vector<char> data;
+    };
+
+    /** 放入缓存，成为最近使用的一项。必要时淘汰最久未用的一项。 */
+    Entry& insert(int blockIdx);
+
+private:
+    ReplayBackend& backend;
+    int capacity;
+    int blockSize;
+
+    /** 头部为最近使用。 */
+    list<Entry> lru;
+    unordered_map<int, list<Entry>::iterator> index;
+};
+
+ReplayCache::Entry& ReplayCache::insert(int blockIdx) {
+    auto it = index.find(blockIdx);
+    if (it != index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return lru.front();
+    }
+
+    if ((int) lru.size() >= capacity) {
+        Entry& victim = lru.back();
+        if (victim.dirty) {
+            backend.write(victim.data.data(), victim.blockIdx, 1);
+            writeBacks++;
+        }
+
+        index.erase(victim.blockIdx);
+        lru.splice(lru.begin(), lru, prev(lru.end()));
+        lru.front().blockIdx = blockIdx;
+        lru.front().dirty = false;
+    } else {
+        lru.push_front({ blockIdx, false, vector<char>(blockSize) });
+    }
+
+    index[blockIdx] = lru.begin();
+    return lru.front();
+}
+
+bool ReplayCache::read(char* buffer, int blockIdx, int blockCount) {
+    if (capacity == 0) {
+        misses += blockCount;
+        return backend.read(buffer, blockIdx, blockCount);
+    }
+
+    bool ok = true;
+    int idx = 0;
+    while (idx < blockCount) {
+        auto it = index.find(blockIdx + idx);
+        if (it != index.end()) {
+            hits++;
+            lru.splice(lru.begin(), lru, it->second);
+            memcpy(buffer + 1LL * idx * blockSize, lru.front().data.data(), blockSize);
+            idx++;
+            continue;
+        }
+
+        // 合并连续的未命中。
+        int runEnd = idx + 1;
+        while (runEnd < blockCount && index.find(blockIdx + runEnd) == index.end()) {
+            runEnd++;
+        }
+
+        int runLength = runEnd - idx;
+        misses += runLength;
+        ok &= backend.read(buffer + 1LL * idx * blockSize, blockIdx + idx, runLength);
+        for (; idx < runEnd; idx++) {
+            memcpy(insert(blockIdx + idx).data.data(), buffer + 1LL * idx * blockSize, blockSize);
+        }
+    }
+
+    return ok;
+}
+
+bool ReplayCache::write(const char* buffer, int blockIdx, int blockCount) {
+    if (capacity == 0) {
+        return backend.write(buffer, blockIdx, blockCount);
+    }
+
+    for (int idx = 0; idx < blockCount; idx++) {
+        Entry& entry = insert(blockIdx + idx);
+        memcpy(entry.data.data(), buffer + 1LL * idx * blockSize, blockSize);
+        entry.dirty = true;
+    }
+
+    return true;
+}
+
+bool ReplayCache::flush() {
+    vector<Entry*> dirty;
+    for (Entry& entry : lru) {
+        if (entry.dirty) {
+            dirty.push_back(&entry);
+        }
+    }
+
+    // 按盘块号排序，连续的脏盘块合并成一次写。
+    sort(dirty.begin(), dirty.end(), [] (const Entry* a, const Entry* b) {
+        return a->blockIdx < b->blockIdx;
+    });
+
+    bool ok = true;
+    vector<char> run;
+    for (size_t idx = 0; idx < dirty.size(); ) {
+        size_t runEnd = idx + 1;
+        while (runEnd < dirty.size() && dirty[runEnd]->blockIdx == dirty[runEnd - 1]->blockIdx + 1) {
+            runEnd++;
+        }
+
+        run.resize((runEnd - idx) * blockSize);
+        for (size_t k = idx; k < runEnd; k++) {
+            memcpy(run.data() + (k - idx) * blockSize, dirty[k]->data.data(), blockSize);
+            dirty[k]->dirty = false;
+        }
+
+        ok &= backend.write(run.data(), dirty[idx]->blockIdx, runEnd - idx);
+        writeBacks += runEnd - idx;
+        idx = runEnd;
+    }
+
+    return ok;
+}
+
+/**
+ * 一次重放的结果。
+ */
+struct ReplayResult {
+    string backend;
+    int cacheBlocks;
+    uint64_t elapsedNs;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t writeBacks;
+    uint64_t readCalls;
+    uint64_t readBlocks;
+    uint64_t writeCalls;
+    uint64_t writeBlocks;
+};
+
+/**
+ * 按逗号分隔。
+ */
+static vector<string> splitList(const string& s) {
+    vector<string> items;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+
+    return items;
+}
+
+/**
+ * 输出记录概况。
+ */
+static void writeSummaryJson(ostream& out, const BlockTraceHeader& header, const vector<BlockTraceRecord>& records) {
+    uint64_t calls[2][BlockTrace::TAG_COUNT] = {};
+    uint64_t blocks[2][BlockTrace::TAG_COUNT] = {};
+    vector<bool> touched(header.diskBlocks, false);
+    uint64_t distinct = 0;
+    uint64_t sequential = 0;
+    long long nextBlock = -1;
+
+    for (const BlockTraceRecord& r : records) {
+        int op = r.op == BlockTrace::WRITE ? 1 : 0;
+        int tag = r.tag < BlockTrace::TAG_COUNT ? r.tag : (uint8_t) BlockTrace::TAG_OTHER;
+        calls[op][tag]++;
+        blocks[op][tag] += r.blockCount;
+
+        if (r.blockIdx == nextBlock) {
+            sequential++;
+        }
+
+        nextBlock = 1LL * r.blockIdx + r.blockCount;
+        for (uint32_t idx = r.blockIdx; idx < r.blockIdx + r.blockCount && idx < header.diskBlocks; idx++) {
+            if (!touched[idx]) {
+                touched[idx] = true;
+                distinct++;
+            }
+        }
+    }
+
+    out << "{\"records\":" << records.size() << ",\"diskBlocks\":" << header.diskBlocks
+        << ",\"blockSize\":" << header.blockSize << ",\"distinctBlocks\":" << distinct
+        << ",\"sequentialRecords\":" << sequential << ",\"byTag\":{";
+
+    bool first = true;
+    for (int tag = 0; tag < BlockTrace::TAG_COUNT; tag++) {
+        if (calls[0][tag] + calls[1][tag] == 0) {
+            continue;
+        }
+
+        out << (first ? "" : ",") << "\"" << BlockTrace::tagName(tag) << "\":{"
+            << "\"readCalls\":" << calls[0][tag] << ",\"readBlocks\":" << blocks[0][tag]
+            << ",\"writeCalls\":" << calls[1][tag] << ",\"writeBlocks\":" << blocks[1][tag] << "}";
+        first = false;
+    }
+
+    out << "}}";
+}
+
+/**
+ * 统计实际落到读写方式上的调用。
+ */
+class CountingBackend : public ReplayBackend {
+public:
+    CountingBackend(ReplayBackend* inner) : inner(inner) {}
+
+    ~CountingBackend() {
+        delete inner;
+    }
+
+    bool read(char* buffer, int blockIdx, int blockCount) override {
+        readCalls++;
+        readBlocks += blockCount;
+        return inner->read(buffer, blockIdx, blockCount);
+    }
+
+    bool write(const char* buffer, int blockIdx, int blockCount) override {
+        writeCalls++;
+        writeBlocks += blockCount;
+        return inner->write(buffer, blockIdx, blockCount);
+    }
+
+    void flush() override {
+        inner->flush();
+    }
+
+private:
+    ReplayBackend* inner;
+};
+
+/**
+ * 在映像副本上重放一次。
+ */
+static bool replay(
+    const string& scratchPath, const string& backendName, int cacheBlocks,
+    const BlockTraceHeader& header, const vector<BlockTraceRecord>& records, ReplayResult& result
+) {
+    ReplayBackend* inner = ReplayBackend::create(backendName, scratchPath, header.blockSize);
+    if (inner == nullptr) {
+        cerr << "[error] 无法使用读写方式：" << backendName << endl;
+        return false;
+    }
+
+    ReplayBackend* backend = new CountingBackend(inner);
+
+    ReplayCache cache(*backend, cacheBlocks, header.blockSize);
+    vector<char> buffer;
+    bool ok = true;
+
+    auto begin = steady_clock::now();
+    for (const BlockTraceRecord& r : records) {
+        if (1ULL * r.blockIdx + r.blockCount > header.diskBlocks) {
+            continue;
+        }
+
+        buffer.resize(max(buffer.size(), (size_t) r.blockCount * header.blockSize));
+        if (r.op == BlockTrace::WRITE) {
+            // 记录里没有数据内容，写入缓冲区中现有的内容即可，副本用完即删。
+            ok &= cache.write(buffer.data(), r.blockIdx, r.blockCount);
+        } else {
+            ok &= cache.read(buffer.data(), r.blockIdx, r.blockCount);
+        }
+    }
+
+    ok &= cache.flush();
+    backend->flush();
+    uint64_t elapsed = duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+
+    result = {
+        backendName, cacheBlocks, elapsed, cache.hits, cache.misses, cache.writeBacks,
+        backend->readCalls, backend->readBlocks, backend->writeCalls, backend->writeBlocks
+    };
+
+    delete backend;
+    return ok;
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc < 2) {
+        cerr << "usage: fsreplay <trace> [-i image] [-b pread,stream,mmap] [-c 0,64,256,1024] [-o result.json]" << endl;
+        return -1;
+    }
+
+    string tracePath = argv[1];
+    string imgPath;
+    string outPath;
+#ifdef __linux__
+    vector<string> backends = { "pread", "stream", "mmap" };
+#else
+    vector<string> backends = { "stream" };
+#endif
+    vector<int> cacheSizes = { 0, 64, 256, 1024 };
+
+    for (int idx = 2; idx + 1 < argc; idx += 2) {
+        string arg = argv[idx];
+        if (arg == "-i") {
+            imgPath = argv[idx + 1];
+        } else if (arg == "-b") {
+            backends = splitList(argv[idx + 1]);
+        } else if (arg == "-c") {
+            cacheSizes.clear();
+            for (auto& item : splitList(argv[idx + 1])) {
+                cacheSizes.push_back(max(0, atoi(item.c_str())));
+            }
+        } else if (arg == "-o") {
+            outPath = argv[idx + 1];
+        }
+    }
+
+    BlockTraceHeader header;
+    vector<BlockTraceRecord> records;
+    if (!BlockTrace::load(tracePath, header, records)) {
+        cerr << "[error] 无法读取记录文件：" << tracePath << endl;
+        return -1;
+    }
+
+    vector<ReplayResult> results;
+    bool ok = true;
+
+    if (!imgPath.empty()) {
+        // 在副本上重放，不改动原映像。
+        string scratchPath = imgPath + ".replay";
+        error_code ec;
+
+        for (const string& backendName : backends) {
+            for (int cacheBlocks : cacheSizes) {
+                filesystem::copy_file(imgPath, scratchPath, filesystem::copy_options::overwrite_existing, ec);
+                if (ec) {
+                    cerr << "[error] 无法复制映像：" << imgPath << endl;
+                    return -1;
+                }
+
+                ReplayResult result;
+                if (!replay(scratchPath, backendName, cacheBlocks, header, records, result)) {
+                    ok = false;
+                    continue;
+                }
+
+                results.push_back(result);
+                cerr << "[info] " << backendName << ", cache " << cacheBlocks << ": "
+                    << result.elapsedNs / 1000 << " us" << endl;
+            }
+        }
+
+        filesystem::remove(scratchPath, ec);
+    }
+
+    ostringstream out;
+    out << "{\"trace\":";
+    writeSummaryJson(out, header, records);
+    out << ",\"replays\":[";
+    for (size_t idx = 0; idx < results.size(); idx++) {
+        const ReplayResult& r = results[idx];
+        out << (idx == 0 ? "" : ",") << "\n{\"backend\":\"" << r.backend << "\",\"cacheBlocks\":" << r.cacheBlocks
+            << ",\"elapsedNs\":" << r.elapsedNs << ",\"hits\":" << r.hits << ",\"misses\":" << r.misses
+            << ",\"writeBacks\":" << r.writeBacks
+            << ",\"backendReadCalls\":" << r.readCalls << ",\"backendReadBlocks\":" << r.readBlocks
+            << ",\"backendWriteCalls\":" << r.writeCalls << ",\"backendWriteBlocks\":" << r.writeBlocks << "}";
+    }
+
+    out << "\n]}" << endl;
+
+    if (outPath.empty()) {
+        cout << out.str();
+    } else {
+        ofstream f(outPath);
+        f << out.str();
+        ok &= f.good();
+    }
+
+    return ok ? 0 : -1;
+}
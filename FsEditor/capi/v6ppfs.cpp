@@ -0,0 +1,742 @@
+/*
+ * libv6ppfs：文件系统的 C 接口 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <string>
+#include <vector>
+#include <new>
+#include <mutex>
+#include <shared_mutex>
+#include <cstring>
+#include <ctime>
+#include "./v6ppfs.h"
+#include "../FileSystemAdapter.h"
+#include "../structures/Inode.h"
+#include "../structures/Block.h"
+#include "../structures/InodeDirectory.h"
+
+using namespace std;
+
+struct v6ppfs {
+    FileSystemAdapter* adapter = nullptr;
+};
+
+struct v6ppfs_dir {
+    vector<v6ppfs_dirent> entries;
+    size_t next = 0;
+};
+
+/**
+ * 执行 fn，把异常转换为错误码。
+ */
+template<typename Fn>
+static auto guarded(Fn fn) noexcept -> decltype(fn()) {
+    try {
+        return fn();
+    } catch (const bad_alloc&) {
+        return V6PPFS_ENOMEM;
+    } catch (...) {
+        return V6PPFS_EIO;
+    }
+}
+
+/**
+ * 在调用期间为当前线程绑定一个会话，当前目录为 dirIno。
+ * 适配器的 touch、mkdir、rm 等操作都基于当前目录，分配上下文也保存在会话中。
+ */
+class SessionScope {
+public:
+    SessionScope(FileSystemAdapter& adapter, int dirIno) : adapter(adapter) {
+        session.inodeIdxStack = { adapter.ROOT_INODE_IDX, dirIno };
+        adapter.bindSession(&session);
+    }
+
+    ~SessionScope() {
+        adapter.bindSession(nullptr);
+    }
+
+private:
+    FileSystemAdapter& adapter;
+    AdapterSession session;
+};
+
+static int inodeCount(FileSystemAdapter& adapter) {
+    return sizeof(adapter.inodes) / sizeof(Inode);
+}
+
+/**
+ * 检查 inode 号有效且已分配。
+ */
+static int checkIno(FileSystemAdapter& adapter, int ino) {
+    if (ino <= 0 || ino >= inodeCount(adapter)) {
+        return V6PPFS_EINVAL;
+    }
+
+    return adapter.inodes[ino].ialloc ? V6PPFS_OK : V6PPFS_ENOENT;
+}
+
+/**
+ * 拆分路径。空段与 "." 被忽略，".." 回退一段。
+ */
+static int splitPath(const char* path, vector<string>& segments) {
+    if (path == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    segments.clear();
+    const char* p = path;
+    while (*p != '\0') {
+        const char* end = strchr(p, '/');
+        if (end == nullptr) {
+            end = p + strlen(p);
+        }
+
+        string seg(p, end);
+        if (seg.size() > V6PPFS_NAME_MAX) {
+            return V6PPFS_ENAMETOOLONG;
+        } else if (seg == "..") {
+            if (!segments.empty()) {
+                segments.pop_back();
+            }
+        } else if (!seg.empty() && seg != ".") {
+            segments.push_back(seg);
+        }
+
+        p = *end == '\0' ? end : end + 1;
+    }
+
+    return V6PPFS_OK;
+}
+
+/**
+ * 从根目录出发，解析 segments 的前 count 段。
+ *
+ * @param chain 可选输出。经过的目录（含根目录，不含结果本身）的 inode 号。
+ * @return inode 号，或错误码。
+ */
+static int resolveSegments(
+    FileSystemAdapter& adapter, const vector<string>& segments, size_t count, vector<int>* chain = nullptr
+) {
+    int ino = adapter.ROOT_INODE_IDX;
+    for (size_t idx = 0; idx < count; idx++) {
+        if (adapter.inodes[ino].file_type != Inode::FileType::DIR) {
+            return V6PPFS_ENOTDIR;
+        }
+
+        if (chain != nullptr) {
+            chain->push_back(ino);
+        }
+
+        ino = adapter.lookupEntry(ino, segments[idx]);
+        if (ino <= 0 || ino >= inodeCount(adapter)) {
+            return V6PPFS_ENOENT;
+        }
+    }
+
+    return ino;
+}
+
+/**
+ * 解析路径的父目录。
+ *
+ * @param parentIno 输出。父目录 inode 号。
+ * @param name 输出。最后一段文件名。
+ */
+static int resolveParent(FileSystemAdapter& adapter, const char* path, int& parentIno, string& name) {
+    vector<string> segments;
+    int result = splitPath(path, segments);
+    if (result < 0) {
+        return result;
+    }
+
+    if (segments.empty()) {
+        return V6PPFS_EINVAL; // 根目录没有父目录。
+    }
+
+    parentIno = resolveSegments(adapter, segments, segments.size() - 1);
+    if (parentIno < 0) {
+        return parentIno;
+    }
+
+    if (adapter.inodes[parentIno].file_type != Inode::FileType::DIR) {
+        return V6PPFS_ENOTDIR;
+    }
+
+    name = segments.back();
+    return V6PPFS_OK;
+}
+
+extern "C" {
+
+int v6ppfs_open(const char* imgPath, int flags, v6ppfs** out) {
+    if (imgPath == nullptr || out == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    *out = nullptr;
+    return guarded([&] () {
+        FileSystemAdapter* adapter = new FileSystemAdapter(imgPath, nullptr, (flags & V6PPFS_RDONLY) != 0);
+        try {
+            adapter->load();
+        } catch (...) {
+            delete adapter;
+            throw;
+        }
+
+        *out = new v6ppfs;
+        (*out)->adapter = adapter;
+        return (int) V6PPFS_OK;
+    });
+}
+
+int v6ppfs_close(v6ppfs* fs) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    int result = guarded([&] () {
+        delete fs->adapter; // 析构时同步。
+        return (int) V6PPFS_OK;
+    });
+
+    delete fs;
+    return result;
+}
+
+int v6ppfs_sync(v6ppfs* fs) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    return guarded([&] () {
+        fs->adapter->sync();
+        return (int) V6PPFS_OK;
+    });
+}
+
+int v6ppfs_format(v6ppfs* fs) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    } else if (fs->adapter->readOnly) {
+        return V6PPFS_EROFS;
+    }
+
+    return guarded([&] () {
+        fs->adapter->format();
+        return (int) V6PPFS_OK;
+    });
+}
+
+int v6ppfs_resolve(v6ppfs* fs, const char* path) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    return guarded([&] () {
+        vector<string> segments;
+        int result = splitPath(path, segments);
+        return result < 0 ? result : resolveSegments(*fs->adapter, segments, segments.size());
+    });
+}
+
+int v6ppfs_stat(v6ppfs* fs, int ino, v6ppfs_statbuf* st) {
+    if (fs == nullptr || st == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    FileSystemAdapter& adapter = *fs->adapter;
+    int result = checkIno(adapter, ino);
+    if (result < 0) {
+        return result;
+    }
+
+    return guarded([&] () {
+        shared_lock<shared_mutex> lock(adapter.inodeLock(ino));
+        Inode& inode = adapter.inodes[ino];
+
+        memset(st, 0, sizeof(*st));
+        st->ino = ino;
+        st->type = inode.file_type;
+        st->mode = (inode.permission_owner << 6) | (inode.permission_group << 3) | inode.permission_others;
+        st->nlink = inode.d_nlink;
+        st->uid = inode.d_uid;
+        st->gid = inode.d_gid;
+        st->size = inode.d_size;
+        st->atime = inode.d_atime;
+        st->mtime = inode.d_mtime;
+
+        int64_t blocks = 0;
+        adapter.iterateOverInodeDataBlocks(
+            inode,
+            [] (...) {},
+            [] (int prevBlockIdx) { return prevBlockIdx; },
+            [] (...) {},
+            [&] (int) { blocks++; },
+            [&] (const char*, int) { blocks++; }
+        );
+
+        st->blocks = blocks;
+        return (int) V6PPFS_OK;
+    });
+}
+
+int64_t v6ppfs_read(v6ppfs* fs, int ino, int64_t offset, void* buf, int64_t len) {
+    if (fs == nullptr || (buf == nullptr && len > 0) || offset < 0 || len < 0) {
+        return V6PPFS_EINVAL;
+    }
+
+    FileSystemAdapter& adapter = *fs->adapter;
+    int result = checkIno(adapter, ino);
+    if (result < 0) {
+        return result;
+    }
+
+    return guarded([&] () {
+        shared_lock<shared_mutex> lock(adapter.inodeLock(ino));
+        Inode& inode = adapter.inodes[ino];
+
+        if (offset >= inode.d_size) {
+            return (int64_t) 0;
+        }
+
+        len = min(len, (int64_t) inode.d_size - offset);
+        char* out = (char*) buf;
+        bool failed = false;
+
+        adapter.iterateOverInodeDataBlocks(
+            inode,
+            [&] (int dataByteOffset, int blockIdx) {
+                // 只处理与 [offset, offset + len) 相交的数据块。
+                int64_t begin = max((int64_t) dataByteOffset, offset);
+                int64_t end = min((int64_t) dataByteOffset + (int64_t) sizeof(Block), offset + len);
+                if (begin >= end) {
+                    return;
+                }
+
+                if (blockIdx == 0) { // 空洞。
+                    memset(out + (begin - offset), 0, end - begin);
+                    return;
+                }
+
+                Block b;
+                failed |= !adapter.readBlock(b, blockIdx);
+                memcpy(out + (begin - offset), b.asCharArray() + (begin - dataByteOffset), end - begin);
+            },
+            [] (int prevBlockIdx) { return prevBlockIdx; },
+            [] (...) {},
+            [] (...) {},
+            [] (...) {}
+        );
+
+        return failed ? (int64_t) V6PPFS_EIO : len;
+    });
+}
+
+int64_t v6ppfs_write(v6ppfs* fs, int ino, int64_t offset, const void* buf, int64_t len) {
+    if (fs == nullptr || (buf == nullptr && len > 0) || offset < 0 || len < 0) {
+        return V6PPFS_EINVAL;
+    }
+
+    FileSystemAdapter& adapter = *fs->adapter;
+    if (adapter.readOnly) {
+        return V6PPFS_EROFS;
+    }
+
+    int result = checkIno(adapter, ino);
+    if (result < 0) {
+        return result;
+    }
+
+    if (offset + len > adapter.FS_FILE_SIZE_MAX) {
+        return V6PPFS_EFBIG;
+    }
+
+    return guarded([&] () {
+        SessionScope scope(adapter, adapter.ROOT_INODE_IDX);
+        unique_lock<shared_mutex> lock(adapter.inodeLock(ino));
+        Inode& inode = adapter.inodes[ino];
+
+        if (inode.file_type == Inode::FileType::DIR) {
+            return (int64_t) V6PPFS_EISDIR;
+        }
+
+        const char* in = (const char*) buf;
+        int64_t end = offset + len;
+        int64_t oldSize = inode.d_size;
+        int64_t newSize = max(oldSize, end);
+
+        // 原有的数据块。索引块中超出文件末尾的条目可能是旧数据，不能直接采用。
+        vector<uint32_t> oldBlocks;
+        oldBlocks.reserve((oldSize + sizeof(Block) - 1) / sizeof(Block));
+        adapter.iterateOverInodeDataBlocks(
+            inode,
+            [&] (int dataByteOffset, int blockIdx) { oldBlocks.push_back(blockIdx); },
+            [] (int prevBlockIdx) { return prevBlockIdx; },
+            [] (...) {},
+            [] (...) {},
+            [] (...) {}
+        );
+
+        auto oldBlockAt = [&] (int64_t dataByteOffset) -> uint32_t {
+            size_t idx = dataByteOffset / sizeof(Block);
+            return idx < oldBlocks.size() ? oldBlocks[idx] : 0;
+        };
+
+        auto inRange = [&] (int64_t dataByteOffset) {
+            return dataByteOffset < end && dataByteOffset + (int64_t) sizeof(Block) > offset;
+        };
+
+        AllocationContext& allocContext = adapter.session().allocContext;
+        allocContext.ino = ino;
+        allocContext.goal = oldBlocks.empty() || oldBlocks.back() == 0 ? 0 : oldBlocks.back() + 1;
+        allocContext.blocksWanted = max(
+            0, AllocationContext::blocksForFileSize(newSize) - AllocationContext::blocksForFileSize(oldSize)
+        );
+
+        // 只改写与写入范围重叠的盘块；新增的部分只为写入范围申请盘块，其余留作空洞。
+        // 遍历时，数据块槽位先经过空洞探测再申请盘块，索引块则直接申请，据此区分两者。
+        int64_t nextDataOffset = 0;
+        bool dataSlot = false;
+        bool failed = false;
+        Block zeroBlock;
+        memset(zeroBlock.asCharArray(), 0, sizeof(Block));
+
+        inode.d_size = newSize;
+        inode.ilarg = !!(newSize > (int64_t) sizeof(Block) * 6);
+
+        bool walked = adapter.iterateOverInodeDataBlocks(
+            inode,
+
+            [&] (int dataByteOffset, int blockIdx) {
+                nextDataOffset = dataByteOffset + (int64_t) sizeof(Block);
+                bool tailGrows = oldBlockAt(dataByteOffset) != 0 && newSize > oldSize
+                    && dataByteOffset + (int64_t) sizeof(Block) > oldSize;
+
+                if (blockIdx == 0 || (!inRange(dataByteOffset) && !tailGrows)) {
+                    return;
+                }
+
+                Block b;
+                int64_t blockEnd = dataByteOffset + (int64_t) sizeof(Block);
+                bool whole = offset <= dataByteOffset && end >= blockEnd;
+                if (oldBlockAt(dataByteOffset) == 0) {
+                    b = zeroBlock; // 新盘块，或原来的空洞。
+                } else if (!whole) {
+                    failed |= !adapter.readBlock(b, blockIdx); // 部分改写。
+                }
+
+                // 原来文件末尾之后的部分读出应为 0。
+                if (tailGrows && !whole) {
+                    int64_t zeroBegin = max((int64_t) dataByteOffset, oldSize);
+                    memset(b.asCharArray() + (zeroBegin - dataByteOffset), 0, blockEnd - zeroBegin);
+                }
+
+                if (inRange(dataByteOffset)) {
+                    int64_t begin = max((int64_t) dataByteOffset, offset);
+                    int64_t stop = min(blockEnd, end);
+                    memcpy(b.asCharArray() + (begin - dataByteOffset), in + (begin - offset), stop - begin);
+                }
+
+                failed |= !adapter.writeBlock(b, blockIdx);
+            },
+
+            [&] (int prevBlockIdx) {
+                if (dataSlot) {
+                    dataSlot = false;
+                    uint32_t oldBlock = oldBlockAt(nextDataOffset);
+                    return oldBlock != 0 ? (int) oldBlock : adapter.getFreeBlock();
+                }
+
+                // 索引块：覆盖的范围从原来的文件内部开始时沿用，否则申请新的并清零。
+                if (nextDataOffset < oldSize && prevBlockIdx != 0) {
+                    return prevBlockIdx;
+                }
+
+                int blockIdx = adapter.getFreeBlock();
+                if (blockIdx > 0) {
+                    failed |= !adapter.writeBlock(zeroBlock, blockIdx);
+                }
+
+                return blockIdx;
+            },
+
+            [&] (Inode& inode, int sizeRemaining, const char* msg) {
+                // 原有的内容不受影响，文件至少保持原来的大小。
+                inode.d_size = max(oldSize, (int64_t) inode.d_size - sizeRemaining);
+                inode.ilarg = !!(inode.d_size > sizeof(Block) * 6);
+            },
+
+            [] (...) {},
+
+            [&] (const char* pBlock, int blockIndex) {
+                failed |= !adapter.writeBlocks(pBlock, blockIndex, 1);
+            },
+
+            [&] (int dataByteOffset) {
+                // 原来的盘块保留；写入范围之外新增的部分留作空洞。
+                bool hole = oldBlockAt(dataByteOffset) == 0 && !inRange(dataByteOffset);
+                dataSlot = !hole;
+                return hole;
+            }
+        );
+
+        inode.d_mtime = time(nullptr);
+        adapter.metadataDirty = true;
+
+        if (!walked) {
+            return (int64_t) V6PPFS_ENOSPC;
+        }
+
+        return failed ? (int64_t) V6PPFS_EIO : len;
+    });
+}
+
+/**
+ * 在父目录中创建文件或目录。
+ */
+static int createEntry(v6ppfs* fs, const char* path, Inode::FileType type) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    FileSystemAdapter& adapter = *fs->adapter;
+    if (adapter.readOnly) {
+        return V6PPFS_EROFS;
+    }
+
+    return guarded([&] () {
+        int parentIno;
+        string name;
+        int result = resolveParent(adapter, path, parentIno, name);
+        if (result < 0) {
+            return result;
+        }
+
+        int ino = adapter.lookupEntry(parentIno, name);
+        if (ino > 0) {
+            if (type == Inode::FileType::DIR) {
+                return (int) V6PPFS_EEXIST;
+            }
+
+            if (adapter.inodes[ino].file_type == Inode::FileType::DIR) {
+                return (int) V6PPFS_EISDIR;
+            }
+
+            return adapter.inodes[ino].file_type == type ? ino : (int) V6PPFS_EEXIST;
+        }
+
+        SessionScope scope(adapter, parentIno);
+        ino = type == Inode::FileType::DIR ? adapter.mkdir(name) : adapter.touch(name, type);
+        return ino > 0 ? ino : (int) V6PPFS_ENOSPC;
+    });
+}
+
+int v6ppfs_create(v6ppfs* fs, const char* path) {
+    return createEntry(fs, path, Inode::FileType::NORMAL);
+}
+
+int v6ppfs_mkdir(v6ppfs* fs, const char* path) {
+    return createEntry(fs, path, Inode::FileType::DIR);
+}
+
+int v6ppfs_unlink(v6ppfs* fs, const char* path) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    FileSystemAdapter& adapter = *fs->adapter;
+    if (adapter.readOnly) {
+        return V6PPFS_EROFS;
+    }
+
+    return guarded([&] () {
+        int parentIno;
+        string name;
+        int result = resolveParent(adapter, path, parentIno, name);
+        if (result < 0) {
+            return result;
+        }
+
+        int ino = adapter.lookupEntry(parentIno, name);
+        if (ino <= 0) {
+            return (int) V6PPFS_ENOENT;
+        }
+
+        Inode& inode = adapter.inodes[ino];
+        if (inode.file_type == Inode::FileType::DIR && inode.d_size >= sizeof(DirectoryEntry)) {
+            return (int) V6PPFS_ENOTEMPTY;
+        }
+
+        SessionScope scope(adapter, parentIno);
+        adapter.rm(name);
+        return (int) V6PPFS_OK;
+    });
+}
+
+int v6ppfs_rename(v6ppfs* fs, const char* from, const char* to) {
+    if (fs == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    FileSystemAdapter& adapter = *fs->adapter;
+    if (adapter.readOnly) {
+        return V6PPFS_EROFS;
+    }
+
+    return guarded([&] () {
+        // 持有移动锁时解析路径，路径链在移动完成前有效。
+        lock_guard<mutex> renameLock(adapter.renameMutex);
+
+        vector<string> srcSegments;
+        int result = splitPath(from, srcSegments);
+        if (result < 0) {
+            return result;
+        } else if (srcSegments.empty()) {
+            return (int) V6PPFS_EINVAL;
+        }
+
+        vector<int> srcChain;
+        int srcParentIno = resolveSegments(adapter, srcSegments, srcSegments.size() - 1, &srcChain);
+        if (srcParentIno < 0) {
+            return srcParentIno;
+        } else if (adapter.inodes[srcParentIno].file_type != Inode::FileType::DIR) {
+            return (int) V6PPFS_ENOTDIR;
+        }
+
+        srcChain.push_back(srcParentIno);
+        const string& srcName = srcSegments.back();
+
+        int ino = adapter.lookupEntry(srcParentIno, srcName);
+        if (ino <= 0) {
+            return (int) V6PPFS_ENOENT;
+        }
+
+        vector<string> segments;
+        result = splitPath(to, segments);
+        if (result < 0) {
+            return result;
+        } else if (segments.empty()) {
+            return (int) V6PPFS_EINVAL;
+        }
+
+        // 逐段解析目标的父目录，同时检查不会把目录移入它自己的子目录。
+        vector<int> dstChain;
+        int dstParentIno = adapter.ROOT_INODE_IDX;
+        for (size_t idx = 0; idx + 1 < segments.size(); idx++) {
+            if (adapter.inodes[dstParentIno].file_type != Inode::FileType::DIR) {
+                return (int) V6PPFS_ENOTDIR;
+            }
+
+            dstChain.push_back(dstParentIno);
+            dstParentIno = adapter.lookupEntry(dstParentIno, segments[idx]);
+            if (dstParentIno <= 0 || dstParentIno >= inodeCount(adapter)) {
+                return (int) V6PPFS_ENOENT;
+            } else if (dstParentIno == ino) {
+                return (int) V6PPFS_EINVAL;
+            }
+        }
+
+        if (adapter.inodes[dstParentIno].file_type != Inode::FileType::DIR) {
+            return (int) V6PPFS_ENOTDIR;
+        }
+
+        dstChain.push_back(dstParentIno);
+
+        int existingIno = adapter.lookupEntry(dstParentIno, segments.back());
+        if (existingIno == ino && dstParentIno == srcParentIno && segments.back() == srcName) {
+            return (int) V6PPFS_OK;
+        } else if (existingIno > 0) {
+            return (int) V6PPFS_EEXIST;
+        }
+
+        return adapter.moveEntry(srcChain, srcName, ino, dstChain, segments.back())
+            ? (int) V6PPFS_OK : (int) V6PPFS_EIO;
+    });
+}
+
+int v6ppfs_opendir(v6ppfs* fs, const char* path, v6ppfs_dir** out) {
+    if (fs == nullptr || out == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    *out = nullptr;
+    FileSystemAdapter& adapter = *fs->adapter;
+
+    return guarded([&] () {
+        int ino = v6ppfs_resolve(fs, path);
+        if (ino < 0) {
+            return ino;
+        }
+
+        if (adapter.inodes[ino].file_type != Inode::FileType::DIR) {
+            return (int) V6PPFS_ENOTDIR;
+        }
+
+        v6ppfs_dir* dir = new v6ppfs_dir;
+        {
+            shared_lock<shared_mutex> lock(adapter.inodeLock(ino));
+            DirectoryView entries(adapter.inodes[ino], adapter);
+
+            entries.forEach([&] (const DirectoryEntry& entry) {
+                if (entry.m_ino == 0 || entry.m_ino >= inodeCount(adapter)) {
+                    return;
+                }
+
+                v6ppfs_dirent dirent;
+                memset(&dirent, 0, sizeof(dirent));
+                dirent.ino = entry.m_ino;
+                dirent.type = adapter.inodes[entry.m_ino].file_type;
+                memcpy(dirent.name, entry.m_name, strnlen(entry.m_name, V6PPFS_NAME_MAX));
+                dir->entries.push_back(dirent);
+            });
+        }
+
+        *out = dir;
+        return (int) V6PPFS_OK;
+    });
+}
+
+int v6ppfs_readdir(v6ppfs_dir* dir, v6ppfs_dirent* entry) {
+    if (dir == nullptr || entry == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    if (dir->next >= dir->entries.size()) {
+        return 0;
+    }
+
+    *entry = dir->entries[dir->next++];
+    return 1;
+}
+
+int v6ppfs_closedir(v6ppfs_dir* dir) {
+    if (dir == nullptr) {
+        return V6PPFS_EINVAL;
+    }
+
+    delete dir;
+    return V6PPFS_OK;
+}
+
+const char* v6ppfs_strerror(int err) {
+    switch (err) {
+        case V6PPFS_OK: return "success";
+        case V6PPFS_ENOENT: return "no such file or directory";
+        case V6PPFS_EIO: return "i/o error";
+        case V6PPFS_ENOMEM: return "out of memory";
+        case V6PPFS_EEXIST: return "file exists";
+        case V6PPFS_ENOTDIR: return "not a directory";
+        case V6PPFS_EISDIR: return "is a directory";
+        case V6PPFS_EINVAL: return "invalid argument";
+        case V6PPFS_EFBIG: return "file too large";
+        case V6PPFS_ENOSPC: return "no space left on device";
+        case V6PPFS_EROFS: return "read-only file system";
+        case V6PPFS_ENAMETOOLONG: return "file name too long";
+        case V6PPFS_ENOTEMPTY: return "directory not empty";
+        default: return "unknown error";
+    }
+}
+
+} // extern "C"
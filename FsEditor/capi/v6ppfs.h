@@ -0,0 +1,189 @@
+/*
+ * libv6ppfs：文件系统的 C 接口。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #define V6PPFS_API __declspec(dllexport)
+#else
+    #define V6PPFS_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 约定：
+ *   - 所有函数都不抛出异常，也不结束进程。结果通过返回值报告，失败时为负的错误码（V6PPFS_E*）；
+ *     映像损坏（例如盘块号越界）时返回 V6PPFS_EIO。
+ *   - 库不向标准输出写任何内容。
+ *   - 路径以 '/' 分隔，总是从根目录开始解析（开头的 '/' 可以省略）。"." 与 ".." 按通常含义处理。
+ *   - 同一个句柄可以被多个线程同时使用：读操作可以并行，写操作只与同一目录或同一文件上的操作互斥。
+ *     format、sync、close 要求没有其他线程同时使用该句柄。
+ */
+
+/** 错误码。与常见的 errno 取值一致（取负）。 */
+enum {
+    V6PPFS_OK = 0,
+    V6PPFS_ENOENT = -2,
+    V6PPFS_EIO = -5,
+    V6PPFS_ENOMEM = -12,
+    V6PPFS_EEXIST = -17,
+    V6PPFS_ENOTDIR = -20,
+    V6PPFS_EISDIR = -21,
+    V6PPFS_EINVAL = -22,
+    V6PPFS_EFBIG = -27,
+    V6PPFS_ENOSPC = -28,
+    V6PPFS_EROFS = -30,
+    V6PPFS_ENAMETOOLONG = -36,
+    V6PPFS_ENOTEMPTY = -39
+};
+
+/** 打开方式。 */
+enum {
+    /** 只读打开。写操作返回 V6PPFS_EROFS。 */
+    V6PPFS_RDONLY = 1
+};
+
+/** 文件类型。与 Inode::FileType 一致。 */
+enum {
+    V6PPFS_TYPE_FILE = 0,
+    V6PPFS_TYPE_CHAR_DEV = 1,
+    V6PPFS_TYPE_DIR = 2,
+    V6PPFS_TYPE_BLOCK_DEV = 3
+};
+
+/** 文件名的最大长度（字节，不含结尾的 0）。 */
+#define V6PPFS_NAME_MAX 28
+
+typedef struct v6ppfs v6ppfs;
+typedef struct v6ppfs_dir v6ppfs_dir;
+
+typedef struct v6ppfs_statbuf {
+    uint32_t ino;
+    uint32_t type;
+
+    /** 权限位：owner、group、others 各 3 位，与 Unix 的 0777 相同。 */
+    uint32_t mode;
+    uint32_t nlink;
+    uint32_t uid;
+    uint32_t gid;
+    int64_t size;
+
+    /** 占用的盘块数（含索引块，不含空洞）。 */
+    int64_t blocks;
+    int64_t atime;
+    int64_t mtime;
+} v6ppfs_statbuf;
+
+typedef struct v6ppfs_dirent {
+    uint32_t ino;
+    uint32_t type;
+    char name[V6PPFS_NAME_MAX + 1];
+} v6ppfs_dirent;
+
+/**
+ * 打开磁盘映像。
+ *
+ * @param imgPath 映像文件路径。
+ * @param flags 0 或 V6PPFS_RDONLY。
+ * @param out 输出句柄。
+ * @return V6PPFS_OK 或错误码。
+ */
+V6PPFS_API int v6ppfs_open(const char* imgPath, int flags, v6ppfs** out);
+
+/**
+ * 关闭句柄。可写打开时会先同步。
+ */
+V6PPFS_API int v6ppfs_close(v6ppfs* fs);
+
+/**
+ * 将 superblock 与 inode 表写回映像。
+ */
+V6PPFS_API int v6ppfs_sync(v6ppfs* fs);
+
+/**
+ * 格式化。清空所有数据。
+ */
+V6PPFS_API int v6ppfs_format(v6ppfs* fs);
+
+/**
+ * 解析路径。
+ *
+ * @return inode 号（大于 0），或错误码。
+ */
+V6PPFS_API int v6ppfs_resolve(v6ppfs* fs, const char* path);
+
+/**
+ * 查询 inode 信息。
+ */
+V6PPFS_API int v6ppfs_stat(v6ppfs* fs, int ino, v6ppfs_statbuf* st);
+
+/**
+ * 从文件的 offset 处读取至多 len 字节。空洞读出为 0。
+ *
+ * @return 读取的字节数（到达文件末尾时小于 len），或错误码。
+ */
+V6PPFS_API int64_t v6ppfs_read(v6ppfs* fs, int ino, int64_t offset, void* buf, int64_t len);
+
+/**
+ * 在文件的 offset 处写入 len 字节。写入范围超出文件末尾时文件变长，中间的部分读出为 0（空洞）。
+ * 只改写与写入范围重叠的盘块，只为新增的部分申请盘块，追加写入的代价与写入量成正比。
+ *
+ * @return 写入的字节数，或错误码。
+ */
+V6PPFS_API int64_t v6ppfs_write(v6ppfs* fs, int ino, int64_t offset, const void* buf, int64_t len);
+
+/**
+ * 创建普通文件。文件已存在时直接返回其 inode 号。
+ *
+ * @return inode 号，或错误码。
+ */
+V6PPFS_API int v6ppfs_create(v6ppfs* fs, const char* path);
+
+/**
+ * 创建目录。
+ *
+ * @return inode 号，或错误码。目录已存在时返回 V6PPFS_EEXIST。
+ */
+V6PPFS_API int v6ppfs_mkdir(v6ppfs* fs, const char* path);
+
+/**
+ * 删除文件或空目录。
+ */
+V6PPFS_API int v6ppfs_unlink(v6ppfs* fs, const char* path);
+
+/**
+ * 移动或重命名。只修改目录项，文件数据与 inode 不动。
+ * 目标已存在时返回 V6PPFS_EEXIST（不会覆盖）；把目录移入它自己的子目录时返回 V6PPFS_EINVAL。
+ */
+V6PPFS_API int v6ppfs_rename(v6ppfs* fs, const char* from, const char* to);
+
+/**
+ * 打开目录，开始遍历。遍历的是打开时目录内容的快照。
+ */
+V6PPFS_API int v6ppfs_opendir(v6ppfs* fs, const char* path, v6ppfs_dir** out);
+
+/**
+ * 读取下一个目录项。
+ *
+ * @return 1 表示读到一项；0 表示遍历结束；或错误码。
+ */
+V6PPFS_API int v6ppfs_readdir(v6ppfs_dir* dir, v6ppfs_dirent* entry);
+
+V6PPFS_API int v6ppfs_closedir(v6ppfs_dir* dir);
+
+/**
+ * 错误码的说明文字。
+ */
+V6PPFS_API const char* v6ppfs_strerror(int err);
+
+#ifdef __cplusplus
+}
+#endif
@@ -33,6 +33,16 @@
 #include "./MacroDefines.h"
 #include "./structures/Inode.h"
 #include "./FileSystemAdapter.h"
+#include "./Tracer.h"
+#include "./BlockOverlay.h"
+#include "./tools/ImageTools.h"
+#include "./tools/Fsck.h"
+#include "./tools/Defragmenter.h"
+#include "./tools/AllocationBenchmark.h"
+#include "./tools/Daemon.h"
+#include "./tools/TarArchive.h"
+#include "./tools/TreeWalk.h"
+#include <sstream>
 
 using namespace std;
 using namespace std::filesystem;
@@ -48,24 +58,77 @@ void usage(const char* hint = nullptr) {
     cout << endl;
     cout << "usage: fsedit.exe imgFile option [imgsize]" << endl;
     cout << "   之后，使用标准输入传递操作指令。" << endl;
+    cout << "       fsedit.exe imgFile tool-option [args...]" << endl;
+    cout << "   映像工具，执行完毕后直接退出。" << endl;
     cout << endl;
     cout << "options:" << endl;
     cout << "  c: 创建一个磁盘映像文件。大小默认为默认文件大小。" << endl;
     cout << "  m: 格式化img文件。" << endl;
     cout << "  e: 打开文件系统，并对其进行编辑操作。" << endl;
     cout << "     注意，使用损坏的img文件会造成未定义的行为。" << endl;
+    cout << "  o [overlay file]: 以写时复制方式打开：映像只读，修改写入覆盖层文件（不存在则新建）。" << endl;
+    cout << "  u [socket]: 常驻服务。加载映像后在 Unix 域套接字上接收命令，每行一条，" << endl;
+    cout << "     每条回复一行 JSON：{\"seq\",\"ok\",\"cwd\",\"output\"}。#shutdown 存盘并停止服务。" << endl;
+    cout << "usage: fsedit.exe socket t" << endl;
+    cout << "  t: 瘦客户端。把标准输入的每一行发送给常驻服务，并输出回复。" << endl;
+    cout << endl;
+    cout << "tool-options:" << endl;
+    cout << "  s [out file]: 只导出在用的盘块，生成稀疏映像。" << endl;
+    cout << "     输出文件以 .gz 结尾或为 - 时，输出 gzip 压缩流（需 zlib）。" << endl;
+    cout << "  d [new img] [delta file]: 逐盘块比较 imgFile 与 new img，输出差分文件。" << endl;
+    cout << "  a [delta file]: 将差分文件合并到 imgFile 上。" << endl;
+    cout << "  w [overlay file]: 将覆盖层写回 imgFile。" << endl;
+    cout << "  r [overlay file]: 丢弃（删除）覆盖层。" << endl;
+    cout << "  z [threads]: 以只读方式检查文件系统一致性（fsck）。有错误时返回非 0。" << endl;
+    cout << "  l [host dir]: 以 imgFile 为临时映像（会被覆盖），用目录中的文件对比各分配策略的" << endl;
+    cout << "     碎片率与顺序读取吞吐。" << endl;
+    cout << "  i [tar file] [v6++ fs dir]: 把 tar 包（ustar/pax）导入到文件系统的目录中。tar file 为 - 时读标准输入。" << endl;
+    cout << "  x [v6++ fs path] [tar file]: 把文件或目录导出为 tar 包。tar file 为 - 时写到标准输出。" << endl;
     cout << endl;
     cout << "operations:" << endl;
     cout << "> h 或其他未定义操作: 显示帮助" << endl;
     cout << "> f: 格式化磁盘。" << endl;
     cout << "> l: 相当于 ls -l" << endl;
     cout << "> c [target dir]: 相当于 cd [target dir]" << endl;
+    cout << "> t [path]: 相当于 ls -lR，按层遍历整棵树。" << endl;
+    cout << "> j [path] [expression]: 相当于 find。expression 由以下条件组成，全部满足才输出：" << endl;
+    cout << "     -name 通配符、-type f|d|c|b、-size [+-]N[c|k|M]（不带单位时以盘块计）、-maxdepth N。" << endl;
+    cout << "> u [path]: 相当于 du。输出每个目录占用的盘块数（含索引块）与文件大小之和，最后一行为合计。" << endl;
+    cout << "> q: 相当于 df。输出数据区盘块与 inode 的总计、已用与可用。" << endl;
     cout << "> p [file path] [v6++ fs path]: 将文件写入v6++文件系统。" << endl;
     cout << "> g [v6++ fs path] [file path]: 从文件系统取出文件。" << endl;
     cout << "> r [path]: 相当于 rm -rf。" << endl;
     cout << "> m [dir name]: 相当于 mkdir。" << endl;
+    cout << "> v [path] [new path]: 相当于 mv。只修改目录项，不复制文件数据。" << endl;
+    cout << "     路径以 / 开头时从根目录出发；new path 是已有的文件夹时移入其中。" << endl;
+    cout << "> y [path] [new path]: 相当于 cp -r，在映像内复制。new path 是已有的文件夹时复制到其中。" << endl;
+    cout << "     副本的盘块一次申请、尽量连续；设置 cplink 选项时普通文件只建立硬链接。" << endl;
+    cout << "> i [tar file] [v6++ fs dir]: 把 tar 包边读边导入到目录中，不经过临时文件。" << endl;
+    cout << "> e [v6++ fs path] [tar file]: 把文件或目录导出为 tar 包，文件数据按盘块顺序读取。" << endl;
     cout << "> k [file path]: 写入内核文件。" << endl;
     cout << "> b [file path]: 写入 bootloader 文件。" << endl;
+    cout << "> z: 检查文件系统一致性（fsck）。" << endl;
+    cout << "> w [block idx]: 查询盘块归属（所属文件与文件内位置）。" << endl;
+    cout << "> d: 碎片整理。使每个文件连续存放，并输出整理前后的碎片统计。" << endl;
+    cout << "     设置了 layout 选项时，先按布局文件的顺序排列 inode、目录与文件。" << endl;
+    cout << "> n: 整理空闲表。空闲盘块按升序重新链接，空闲 inode 表填入编号最小的 inode。" << endl;
+    cout << "> s: 输出本次会话按命令分组的 I/O 统计（调用、盘块、字节、寻道与耗时分位数）。" << endl;
+    cout << "> o [name] [value]: 设置选项。" << endl;
+    cout << "    sparse on|off: 上传与写入文件时，全零盘块留作空洞（默认 off）。" << endl;
+    cout << "    owners on: 开启盘块归属反查表，并保存为映像旁的 .owners 附属文件。" << endl;
+    cout << "    cache on|off: 在映像旁维护 .cache 附属缓存（空闲位图、目录名索引、盘块归属），" << endl;
+    cout << "          供之后的调用直接映射使用。缓存文件存在时自动开启。" << endl;
+    cout << "    cplink on|off: 复制（y）时普通文件只建立硬链接（d_nlink 加 1），不复制数据（默认 off）。" << endl;
+    cout << "    alloc stack|first-fit|locality|pack: 盘块与 inode 的分配策略（默认 stack，即 V6++ 的空闲栈）。" << endl;
+    cout << "          first-fit 把新文件放进第一段足够长的连续空闲区；locality 靠近所在目录；" << endl;
+    cout << "          pack 按写入顺序紧密排列，适合构建映像。" << endl;
+    cout << "    layout [file]: 碎片整理使用的布局文件。每行一个路径（以 / 开头）或盘块号，" << endl;
+    cout << "                   例如记录下来的启动时访问顺序。- 表示取消。" << endl;
+    cout << "    stats [file]: 退出时把 I/O 统计以 JSON 写入文件。- 表示取消。" << endl;
+    cout << "    trace [file]: 开始记录时间线（format、上传、盘块遍历、目录加载、sync 及其盘块读写），" << endl;
+    cout << "                  退出时以 Chrome trace event JSON 写入文件。- 表示立即结束并写出。" << endl;
+    cout << "    iotrace [file]: 把之后的每次盘块读写（操作、盘块号、盘块数、调用方）记录到二进制文件，" << endl;
+    cout << "                    供 fsreplay 重放。- 表示结束记录。" << endl;
     cout << "> x: 退出（并存盘）。" << endl;
     cout << endl;
     cout << "路径使用 '|' 分隔。" << endl;
@@ -104,7 +167,16 @@ static int prepareImgFile(
             
     } else if (option == 'e') { 
         // 读盘
-        // 不做任何处理。
+        // 映像须已存在且尺寸精确。
+        error_code ec;
+        auto fileSize = file_size(filePath, ec);
+        if (ec) {
+            cout << "[error] 无法打开映像：" << filePath << endl;
+            result = -1;
+        } else if (fileSize != MachineProps::diskSize()) {
+            cout << "[error] 映像尺寸应为 " << MachineProps::diskSize() << " 字节，实际 " << fileSize << " 字节。" << endl;
+            result = -1;
+        }
     } else {
         usage("未知命令。");
         result = -1;
@@ -113,6 +185,14 @@ static int prepareImgFile(
     return result;
 }
 
+/**
+ * 输入流在读完一条命令之前结束。
+ */
+class BadStreamError : public runtime_error {
+public:
+    BadStreamError() : runtime_error("bad stream") {}
+};
+
 /**
  * 读取一个字母。
  */
@@ -126,7 +206,7 @@ static char readLatinChar() {
 
     cout << "[error 2] bad stream!" << endl;
     cout << "        main::readLatinChar" << endl;
-    exit(-1);
+    throw BadStreamError();
 }
 
 
@@ -182,7 +262,7 @@ static string readPath() {
 
     cout << "[error 3] bad stream!" << endl;
     cout << "        main::readPath" << endl;
-    exit(-1);
+    throw BadStreamError();
 }
 
 static void readPath(vector<string>& pathSegments) {
@@ -224,133 +304,573 @@ static void readPath(vector<string>& pathSegments) {
     }
 }
 
+/**
+ * 解析开关型选项值。
+ * 
+ * @return 1: 开。0: 关。-1: 无法识别。
+ */
+static int parseSwitch(const string& value) {
+    if (value == "on" || value == "1" || value == "true") {
+        return 1;
+    } else if (value == "off" || value == "0" || value == "false") {
+        return 0;
+    } else {
+        return -1;
+    }
+}
+
+/**
+ * 设置会话选项。
+ * 
+ * @return 是否设置成功。
+ */
+static bool setOption(FileSystemAdapter& fsAdapter, const string& name, const string& value) {
+    if (name == "sparse") {
+        int sw = parseSwitch(value);
+        if (sw < 0) {
+            return false;
+        }
+
+        fsAdapter.sparseFiles = sw;
+        return true;
+    } else if (name == "owners") {
+        if (parseSwitch(value) != 1) {
+            return false;
+        }
+
+        cout << "[info] 盘块归属反查表" 
+            << (fsAdapter.enableOwnerMap() ? "已从附属文件读取。" : "已重建。") << endl;
+        return true;
+    } else if (name == "cache") {
+        int sw = parseSwitch(value);
+        if (sw < 0) {
+            return false;
+        }
+
+        fsAdapter.setCacheEnabled(sw);
+        return true;
+    } else if (name == "cplink") {
+        int sw = parseSwitch(value);
+        if (sw < 0) {
+            return false;
+        }
+
+        fsAdapter.copyAsHardLinks = sw;
+        return true;
+    } else if (name == "alloc") {
+        return fsAdapter.setAllocationPolicy(value);
+    } else if (name == "layout") {
+        if (value != "-" && !exists(value)) {
+            return false;
+        }
+
+        fsAdapter.layoutProfilePath = value == "-" ? "" : value;
+        return true;
+    } else if (name == "stats") {
+        fsAdapter.ioStats.jsonPath = value == "-" ? "" : value;
+        return true;
+    } else if (name == "trace") {
+        if (value == "-") {
+            return Tracer::instance().stop();
+        }
+
+        Tracer::instance().start(value);
+        return true;
+    } else if (name == "iotrace") {
+        return fsAdapter.setBlockTrace(value == "-" ? "" : value);
+    }
+
+    return false;
+}
+
+/**
+ * 分派一条命令。命令参数从标准输入读取，结果输出到标准输出。
+ * 
+ * @param pathSegments 当前路径（用于显示）。
+ * @return 是否继续读取下一条命令。x 命令返回 false。
+ */
+static bool dispatchCommand(FileSystemAdapter& fsAdapter, vector<string>& pathSegments, int operation) {
+    if (operation == 'h') { // help
+
+        usage();
+
+    } else if (operation == 'f') { // format
+
+        fsAdapter.format();
+
+    } else if (operation == 'l') { // list
+
+        fsAdapter.ls();
+
+    } else if (operation == 'c') { // change dir
+
+        string path = readPath();
+        
+        if (fsAdapter.cd(path)) {
+            pathSegments.push_back(path);
+            cout << "[info] 切换路径。" << endl;
+        } else {
+            // nothing to do..
+            cout << "[info] 试图切换路径，但没有任何事发生。" << endl;
+        }
+
+    } else if (operation == 't') { // tree
+
+        string path = readPath();
+        TreeWalk tree(fsAdapter);
+        if (tree.walk(path)) {
+            tree.list();
+        }
+
+    } else if (operation == 'j') { // find
+
+        string path = readPath();
+        string expression = readPath();
+        TreeWalk tree(fsAdapter);
+        if (tree.walk(path)) {
+            int count = tree.find(expression);
+            if (count >= 0) {
+                cout << "[info] 匹配项数：" << count << endl;
+            }
+        }
+
+    } else if (operation == 'u') { // disk usage
+
+        string path = readPath();
+        TreeWalk tree(fsAdapter);
+        if (tree.walk(path)) {
+            tree.du();
+        }
+
+    } else if (operation == 'q') { // disk free
+
+        TreeWalk::df(fsAdapter);
+
+    } else if (operation == 'p') { // put
+
+        string path = readPath();
+        fstream f(path, ios::in | ios::binary);
+        if (!f.is_open()) {
+            cout << "[error 4] 无法打开：" << path << endl;
+        } else {
+            f.close();
+            string v6ppFileName = readPath();
+            fsAdapter.uploadFile(v6ppFileName, path);
+            cout << "[info 5] 上传成功：" << v6ppFileName << endl;
+        }
+
+    } else if (operation == 'g') { // get
+
+        string v6ppPath = readPath();
+        string localPath = readPath();
+        fstream f(localPath, ios::out | ios::binary);
+        if (!f.is_open()) {
+            cout << "[error 6] 无法打开：" << localPath << endl;
+        } else {
+            fsAdapter.downloadFile(v6ppPath, f);
+            cout << "[info 7] 下载成功：" << v6ppPath << " -> " << localPath << endl;
+        }
+
+    } else if (operation == 'r') { // remove
+
+        string path = readPath();
+        int count = fsAdapter.rm(path);
+        cout << "[info 8] 删除文件（夹）数：" << count << endl;
+
+    } else if (operation == 'm') { // make dir
+
+        string path = readPath();
+        fsAdapter.mkdir(path);
+        cout << "[info 9] 创建文件夹：" << path << endl;
+
+    } else if (operation == 'v') { // move
+
+        string srcPath = readPath();
+        string dstPath = readPath();
+        if (fsAdapter.mv(srcPath, dstPath)) {
+            cout << "[info] 移动完成：" << srcPath << " -> " << dstPath << endl;
+        }
+
+    } else if (operation == 'y') { // copy
+
+        string srcPath = readPath();
+        string dstPath = readPath();
+        int count = fsAdapter.cp(srcPath, dstPath, fsAdapter.copyAsHardLinks);
+        if (count >= 0) {
+            cout << "[info] 复制文件（夹）数：" << count << endl;
+        }
+
+    } else if (operation == 'i') { // import tar
+
+        string tarPath = readPath();
+        string dirPath = readPath();
+        ifstream f(tarPath, ios::in | ios::binary);
+        if (!f.is_open()) {
+            cout << "[error] 无法打开：" << tarPath << endl;
+        } else {
+            TarArchive::importTar(fsAdapter, f, dirPath);
+        }
+
+    } else if (operation == 'e') { // export tar
+
+        string v6ppPath = readPath();
+        string tarPath = readPath();
+        ofstream f(tarPath, ios::out | ios::binary | ios::trunc);
+        if (!f.is_open()) {
+            cout << "[error] 无法打开：" << tarPath << endl;
+        } else {
+            TarArchive::exportTar(fsAdapter, v6ppPath, f);
+        }
+
+    } else if (operation == 'k') { // write kernel
+
+        string path = readPath();
+        fstream f(path, ios::in | ios::binary);
+        if (!f.is_open()) {
+            cout << "[error 10] 无法打开：" << path << endl;
+        } else {
+            f.close();
+            fsAdapter.writeKernel(path);
+            cout << "[info 11] 内核写入完毕。" << endl;
+        }
+    
+    } else if (operation == 'b') { // write bootloader
+    
+        string path = readPath();
+        fstream f(path, ios::in | ios::binary);
+        if (!f.is_open()) {
+            cout << "[error 12] 无法打开：" << path << endl;
+        } else {
+            f.close();
+            fsAdapter.writeBootLoader(path);
+            cout << "[info 13] 启动引导程序写入完毕。" << endl;
+        }
+    
+    } else if (operation == 'z') { // fsck
+
+        Fsck(fsAdapter).run();
+
+    } else if (operation == 'd') { // defrag
+
+        Defragmenter defragmenter(fsAdapter);
+        vector<int> preferredOrder;
+        if (fsAdapter.layoutProfilePath.empty() 
+            || defragmenter.loadProfile(fsAdapter.layoutProfilePath, preferredOrder)
+        ) {
+            defragmenter.run(preferredOrder);
+        }
+
+    } else if (operation == 'n') { // tidy
+
+        int freeBlocks = fsAdapter.tidyFreeLists();
+        cout << "[info] 空闲表已整理。空闲盘块：" << freeBlocks 
+            << "，空闲 inode 表：" << fsAdapter.superBlock.s_ninode << endl;
+
+    } else if (operation == 'w') { // who owns
+
+        string blockIdx = readPath();
+        try {
+            fsAdapter.whoOwns(stoi(blockIdx));
+        } catch (...) {
+            cout << "[error 16] 无效的盘块号：" << blockIdx << endl;
+        }
+
+    } else if (operation == 's') { // stat
+
+        fsAdapter.ioStats.printReport(cout);
+
+    } else if (operation == 'o') { // option
+
+        string name = readPath();
+        string value = readPath();
+        if (setOption(fsAdapter, name, value)) {
+            cout << "[info 14] 选项已设置：" << name << " = " << value << endl;
+        } else {
+            cout << "[error 15] 无法设置选项：" << name << " = " << value << endl;
+        }
+
+    } else if (operation == 'x') { // exit
+    
+        fsAdapter.sync();
+        cout << "bye!" << endl;
+        return false; // 结束。
+    
+    } else {
+    
+        string msg = "未知选项：";
+        msg += char(operation);
+        msg += " (";
+        msg += to_string(operation);
+        msg += ")"; 
+        usage(msg.c_str());
+    
+    }
+    // 注：你知道为什么要用一堆 if else，而不是一个 switch 么...
+
+    return true;
+}
+
+/**
+ * 执行一条命令，并把命令期间的 I/O 计入该命令的统计。
+ * 
+ * @return 是否继续读取下一条命令。x 命令返回 false。
+ */
+static bool runCommand(FileSystemAdapter& fsAdapter, vector<string>& pathSegments, int operation) {
+    fsAdapter.ioStats.beginCommand(operation);
+    bool keepGoing;
+    try {
+        keepGoing = dispatchCommand(fsAdapter, pathSegments, operation);
+    } catch (...) {
+        fsAdapter.ioStats.endCommand();
+        throw;
+    }
+
+    fsAdapter.ioStats.endCommand();
+    return keepGoing;
+}
+
+/**
+ * 输出当前路径提示符。
+ */
+static void printPrompt(const vector<string>& pathSegments) {
+    cout << '[';
+    for (int idx = 0; idx < pathSegments.size(); idx++) {
+        if (idx > 0) {
+            cout << "/";
+        }
+
+        cout << pathSegments[idx];
+    }
+
+    cout << "] > ";
+}
+
 /**
  * 交互式命令行界面。 
  */
 static void runInteractiveCli(FileSystemAdapter& fsAdapter) {
     vector<string> pathSegments;
 
-    while (true) {
-        // 输出 path。
-        cout << '[';
-        for (int idx = 0; idx < pathSegments.size(); idx++) {
-            if (idx > 0) {
-                cout << "/";
+    try {
+        while (true) {
+            // 输出 path。
+            printPrompt(pathSegments);
+
+            // 读取输入内容，并处理用户命令。
+            int operation = readLatinChar();
+            if (!runCommand(fsAdapter, pathSegments, operation)) {
+                break;
             }
+        }
+    } catch (const BadStreamError&) {
+        exit(-1); // 输入流异常结束。
+    } catch (const runtime_error& e) {
+        cout << "[critical] " << e.what() << endl;
+        exit(-1); // 映像损坏（例如盘块号越界）。
+    }
+}
+
+/**
+ * 常驻服务：在 Unix 域套接字上执行命令。
+ * 
+ * @return 程序返回值。
+ */
+static int runDaemon(FileSystemAdapter& fsAdapter, const string& socketPath) {
+    vector<string> pathSegments;
+
+    auto executor = [&] (const string& request) {
+        DaemonReply reply;
+
+        // 把请求作为标准输入，收集标准输出，复用交互模式的命令实现。
+        istringstream in(request + "\n");
+        ostringstream out;
+        streambuf* oldIn = cin.rdbuf(in.rdbuf());
+        streambuf* oldOut = cout.rdbuf(out.rdbuf());
+
+        try {
+            int operation = readLatinChar();
+            reply.closeConnection = !runCommand(fsAdapter, pathSegments, operation);
+        } catch (const BadStreamError&) {
+            reply.ok = false;
+        } catch (const exception& e) {
+            cout << "[error] " << e.what() << endl;
+            reply.ok = false;
+        }
 
-            cout << pathSegments[idx];
+        cin.rdbuf(oldIn);
+        cout.rdbuf(oldOut);
+        cin.clear();
+
+        reply.output = out.str();
+        if (reply.output.find("[error") != string::npos || reply.output.find("[critical") != string::npos) {
+            reply.ok = false;
         }
 
-        cout << "] > ";
+        for (auto& seg : pathSegments) {
+            reply.cwd += "/" + seg;
+        }
 
-        // 读取输入内容。
-        int operation = readLatinChar();
+        if (reply.cwd.empty()) {
+            reply.cwd = "/";
+        }
 
-        // 处理用户命令。
+        return reply;
+    };
 
-        if (operation == 'h') { // help
+    auto sessionReset = [&] () {
+        fsAdapter.cd("/");
+        pathSegments.clear();
+    };
 
-            usage();
+    auto shutdown = [&] () {
+        fsAdapter.sync();
+    };
 
-        } else if (operation == 'f') { // format
+    return Daemon(socketPath, executor, sessionReset, shutdown).serve() ? 0 : -1;
+}
 
-            fsAdapter.format();
+/** 映像工具选项。这些选项不进入交互式命令行。 */
+static const char* IMAGE_TOOL_OPTIONS = "sdawrzlix";
 
-        } else if (operation == 'l') { // list
+/**
+ * 执行映像工具。
+ * 
+ * @return 程序返回值。
+ */
+static int runImageTool(const char* imgPath, const char option, int argc, const char* argv[]) {
+    if (option == 's') { // sparse export
 
-            fsAdapter.ls();
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
 
-        } else if (operation == 'c') { // change dir
+        string outPath = argv[3];
+        FileSystemAdapter fsAdapter(imgPath, nullptr, true);
+        fsAdapter.load();
+        return ImageTools::exportImage(fsAdapter, outPath, outPath == "-") ? 0 : -1;
 
-            string path = readPath();
-            
-            if (fsAdapter.cd(path)) {
-                pathSegments.push_back(path);
-                cout << "[info] 切换路径。" << endl;
-            } else {
-                // nothing to do..
-                cout << "[info] 试图切换路径，但没有任何事发生。" << endl;
-            }
+    } else if (option == 'd') { // delta
+
+        if (argc < 5) {
+            usage("too few arguments.");
+            return -1;
+        }
 
-        } else if (operation == 'p') { // put
+        return ImageTools::diffImages(imgPath, argv[3], argv[4]) ? 0 : -1;
 
-            string path = readPath();
-            fstream f(path, ios::in | ios::binary);
-            if (!f.is_open()) {
-                cout << "[error 4] 无法打开：" << path << endl;
-            } else {
-                string v6ppFileName = readPath();
-                fsAdapter.uploadFile(v6ppFileName, f);
-                cout << "[info 5] 上传成功：" << v6ppFileName << endl;
-            }
+    } else if (option == 'a') { // apply delta
 
-        } else if (operation == 'g') { // get
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
 
-            string v6ppPath = readPath();
-            string localPath = readPath();
-            fstream f(localPath, ios::out | ios::binary);
-            if (!f.is_open()) {
-                cout << "[error 6] 无法打开：" << localPath << endl;
-            } else {
-                fsAdapter.downloadFile(v6ppPath, f);
-                cout << "[info 7] 下载成功：" << v6ppPath << " -> " << localPath << endl;
+        return ImageTools::applyDelta(imgPath, argv[3]) ? 0 : -1;
+
+    } else if (option == 'w') { // commit overlay
+
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
+
+        return BlockOverlay::commit(imgPath, argv[3]) ? 0 : -1;
+
+    } else if (option == 'r') { // discard overlay
+
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
+
+        return BlockOverlay::discard(argv[3]) ? 0 : -1;
+
+    } else if (option == 'z') { // fsck
+
+        int threadCount = 0;
+        if (argc >= 4) {
+            try {
+                threadCount = stoi(argv[3]);
+            } catch (...) {
+                cout << "warning: failed to convert threads from argument list." << endl;
             }
+        }
 
-        } else if (operation == 'r') { // remove
+        FileSystemAdapter fsAdapter(imgPath, nullptr, true);
+        fsAdapter.load();
+        return Fsck(fsAdapter, threadCount).run() == 0 ? 0 : 1;
 
-            string path = readPath();
-            int count = fsAdapter.rm(path);
-            cout << "[info 8] 删除文件（夹）数：" << count << endl;
+    } else if (option == 'l') { // allocation policy benchmark
 
-        } else if (operation == 'm') { // make dir
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
 
-            string path = readPath();
-            fsAdapter.mkdir(path);
-            cout << "[info 9] 创建文件夹：" << path << endl;
+        return AllocationBenchmark(imgPath, argv[3]).run() ? 0 : -1;
 
-        } else if (operation == 'k') { // write kernel
+    } else if (option == 'i') { // import tar
 
-            string path = readPath();
-            fstream f(path, ios::in | ios::binary);
+        if (argc < 5) {
+            usage("too few arguments.");
+            return -1;
+        }
+
+        string tarPath = argv[3];
+        ifstream f;
+        if (tarPath != "-") {
+            f.open(tarPath, ios::in | ios::binary);
             if (!f.is_open()) {
-                cout << "[error 10] 无法打开：" << path << endl;
-            } else {
-                fsAdapter.writeKernel(f);
-                f.close();
-                cout << "[info 11] 内核写入完毕。" << endl;
+                cout << "[error] 无法打开：" << tarPath << endl;
+                return -1;
             }
-        
-        } else if (operation == 'b') { // write bootloader
-        
-            string path = readPath();
-            fstream f(path, ios::in | ios::binary);
-            if (!f.is_open()) {
-                cout << "[error 12] 无法打开：" << path << endl;
-            } else {
-                fsAdapter.writeBootLoader(f);
-                f.close();
-                cout << "[info 13] 启动引导程序写入完毕。" << endl;
+        }
+
+        FileSystemAdapter fsAdapter(imgPath);
+        fsAdapter.load();
+        bool ok = TarArchive::importTar(fsAdapter, tarPath == "-" ? cin : f, argv[4]);
+        fsAdapter.sync();
+        return ok ? 0 : -1;
+
+    } else if (option == 'x') { // export tar
+
+        if (argc < 5) {
+            usage("too few arguments.");
+            return -1;
+        }
+
+        string tarPath = argv[4];
+        if (tarPath == "-") {
+            // tar 流占用标准输出，提示信息改写到标准错误。
+            ostream out(cout.rdbuf());
+            cout.rdbuf(cerr.rdbuf());
+
+            bool ok;
+            {
+                FileSystemAdapter fsAdapter(imgPath, nullptr, true);
+                fsAdapter.load();
+                ok = TarArchive::exportTar(fsAdapter, argv[3], out);
             }
-        
-        } else if (operation == 'x') { // exit
-        
-            fsAdapter.sync();
-            cout << "bye!" << endl;
-            break; // 结束。
-        
-        } else {
-        
-            string msg = "未知选项：";
-            msg += char(operation);
-            msg += " (";
-            msg += to_string(operation);
-            msg += ")"; 
-            usage(msg.c_str());
-        
+
+            cout.rdbuf(out.rdbuf());
+            return ok ? 0 : -1;
+        }
+
+        ofstream f(tarPath, ios::out | ios::binary | ios::trunc);
+        if (!f.is_open()) {
+            cout << "[error] 无法打开：" << tarPath << endl;
+            return -1;
         }
-        // 注：你知道为什么要用一堆 if else，而不是一个 switch 么...
+
+        FileSystemAdapter fsAdapter(imgPath, nullptr, true);
+        fsAdapter.load();
+        return TarArchive::exportTar(fsAdapter, argv[3], f) ? 0 : -1;
 
     }
+
+    usage("未知命令。");
+    return -1;
 }
 
 /**
@@ -369,6 +889,50 @@ int main(int argc, const char* argv[]) {
         option += 'a' - 'A';
     }
 
+    if (option == 't') { // daemon client
+        return Daemon::runClient(argv[1]);
+    }
+
+    if (strchr(IMAGE_TOOL_OPTIONS, option) != nullptr) {
+        return runImageTool(imgPath, option, argc, argv);
+    }
+
+    if (option == 'o') { // overlay
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
+
+        FileSystemAdapter* fsAdapter;
+        try {
+            fsAdapter = new FileSystemAdapter(imgPath, argv[3]);
+        } catch (const runtime_error& e) {
+            cout << "[error] 无法打开映像或覆盖层：" << e.what() << endl;
+            return -1;
+        }
+
+        fsAdapter->load();
+        runInteractiveCli(*fsAdapter);
+        delete fsAdapter;
+        return 0;
+    }
+
+    if (option == 'u') { // daemon
+        if (argc < 4) {
+            usage("too few arguments.");
+            return -1;
+        }
+
+        // 与 e 相同的映像检查。
+        if (prepareImgFile(imgPath, 'e') != 0) {
+            return -1;
+        }
+
+        FileSystemAdapter fsAdapter(imgPath);
+        fsAdapter.load();
+        return runDaemon(fsAdapter, argv[3]);
+    }
+
     unsigned long long imgSize = MachineProps::diskSize();
     if (argc >= 4) { // 读取用户希望的磁盘大小。
         try {
@@ -7,8 +7,13 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include "../MachineProps.h"
 
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
 class Block {
 public:
     uint8_t bytes[MachineProps::BLOCK_SIZE] = {0};
@@ -21,6 +26,115 @@ public:
     inline const char* asConstCharArray() const {
         return (const char*) this;
     }
+
+    /** 盘块内容是否全为 0。 */
+    inline bool isZero() const {
+        return Block::isZero(this->bytes, sizeof(bytes));
+    }
+
+    /**
+     * 判断一段内存是否全为 0。
+     * 有 SSE2 时每次比较 64 字节，否则按 8 字节字比较。
+     * 
+     * @param data 数据起始位置。无对齐要求。
+     * @param length 字节数。
+     */
+    static inline bool isZero(const void* data, size_t length) {
+        const uint8_t* p = (const uint8_t*) data;
+        size_t pos = 0;
+
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (; pos + 64 <= length; pos += 64) {
+            __m128i acc = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_loadu_si128((const __m128i*) (p + pos)),
+                    _mm_loadu_si128((const __m128i*) (p + pos + 16))
+                ),
+                _mm_or_si128(
+                    _mm_loadu_si128((const __m128i*) (p + pos + 32)),
+                    _mm_loadu_si128((const __m128i*) (p + pos + 48))
+                )
+            );
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xffff) {
+                return false;
+            }
+        }
+#endif
+
+        uint64_t acc = 0;
+        for (; pos + sizeof(uint64_t) <= length; pos += sizeof(uint64_t)) {
+            uint64_t word;
+            __builtin_memcpy(&word, p + pos, sizeof(word));
+            acc |= word;
+        }
+
+        for (; pos < length; pos++) {
+            acc |= p[pos];
+        }
+
+        return acc == 0;
+    }
+
+    /**
+     * 判断两段内存内容是否相同。
+     * 有 SSE2 时每次比较 64 字节，否则按 8 字节字比较。
+     * 
+     * @param a 数据 a。无对齐要求。
+     * @param b 数据 b。无对齐要求。
+     * @param length 字节数。
+     */
+    static inline bool isEqual(const void* a, const void* b, size_t length) {
+        const uint8_t* pa = (const uint8_t*) a;
+        const uint8_t* pb = (const uint8_t*) b;
+        size_t pos = 0;
+
+#ifdef __SSE2__
+        for (; pos + 64 <= length; pos += 64) {
+            __m128i diff = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_xor_si128(
+                        _mm_loadu_si128((const __m128i*) (pa + pos)),
+                        _mm_loadu_si128((const __m128i*) (pb + pos))
+                    ),
+                    _mm_xor_si128(
+                        _mm_loadu_si128((const __m128i*) (pa + pos + 16)),
+                        _mm_loadu_si128((const __m128i*) (pb + pos + 16))
+                    )
+                ),
+                _mm_or_si128(
+                    _mm_xor_si128(
+                        _mm_loadu_si128((const __m128i*) (pa + pos + 32)),
+                        _mm_loadu_si128((const __m128i*) (pb + pos + 32))
+                    ),
+                    _mm_xor_si128(
+                        _mm_loadu_si128((const __m128i*) (pa + pos + 48)),
+                        _mm_loadu_si128((const __m128i*) (pb + pos + 48))
+                    )
+                )
+            );
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff) {
+                return false;
+            }
+        }
+#endif
+
+        uint64_t acc = 0;
+        for (; pos + sizeof(uint64_t) <= length; pos += sizeof(uint64_t)) {
+            uint64_t wa, wb;
+            __builtin_memcpy(&wa, pa + pos, sizeof(wa));
+            __builtin_memcpy(&wb, pb + pos, sizeof(wb));
+            acc |= wa ^ wb;
+        }
+
+        for (; pos < length; pos++) {
+            acc |= pa[pos] ^ pb[pos];
+        }
+
+        return acc == 0;
+    }
 } __packed;
 
 #if 0
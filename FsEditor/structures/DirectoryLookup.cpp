@@ -0,0 +1,146 @@
+/*
+ * 目录项按名查找 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include "./FileSystemAdapter.h"
+#include "./structures/InodeDirectory.h"
+#include "./structures/DirectoryLookup.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define V6PP_LOOKUP_X86
+    #include <immintrin.h>
+#endif
+
+using namespace std;
+
+static_assert(sizeof(DirectoryEntry) == 32, "目录项应为 32 字节。");
+
+/** 文件名在目录项中的偏移。 */
+static const int NAME_OFFSET = 4;
+
+DirectoryNameKey::DirectoryNameKey(const string& name) {
+    memset(bytes, 0, sizeof(bytes));
+    valid = !name.empty() && name.length() <= DirectoryEntry::DIRSIZE;
+    mask = 0;
+
+    if (valid) {
+        int compareBytes = min((int) name.length() + 1, DirectoryEntry::DIRSIZE);
+        memcpy(bytes + NAME_OFFSET, name.data(), min((int) name.length(), compareBytes));
+        mask = ((1u << compareBytes) - 1) << NAME_OFFSET;
+    }
+}
+
+static int findScalar(const DirectoryEntry* entries, int count, const DirectoryNameKey& key) {
+    int compareBytes = __builtin_popcount(key.mask);
+    for (int idx = 0; idx < count; idx++) {
+        if (memcmp(entries[idx].m_name, key.bytes + NAME_OFFSET, compareBytes) == 0) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef V6PP_LOOKUP_X86
+
+/**
+ * SSE2：每个目录项分两次载入 16 字节。x86-64 上总是可用。
+ */
+__attribute__((target("sse2")))
+static int findSse2(const DirectoryEntry* entries, int count, const DirectoryNameKey& key) {
+    const __m128i keyLo = _mm_load_si128((const __m128i*) key.bytes);
+    const __m128i keyHi = _mm_load_si128((const __m128i*) (key.bytes + 16));
+    const char* p = (const char*) entries;
+
+    for (int idx = 0; idx < count; idx++, p += sizeof(DirectoryEntry)) {
+        uint32_t lo = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) p), keyLo));
+        uint32_t hi = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (p + 16)), keyHi));
+        if ((((hi << 16) | lo) & key.mask) == key.mask) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * AVX2：每次载入 32 字节，正好一个目录项。循环展开为一次两项。
+ */
+__attribute__((target("avx2")))
+static int findAvx2(const DirectoryEntry* entries, int count, const DirectoryNameKey& key) {
+    const __m256i keyVec = _mm256_load_si256((const __m256i*) key.bytes);
+    const char* p = (const char*) entries;
+    int idx = 0;
+
+    for (; idx + 2 <= count; idx += 2, p += 2 * sizeof(DirectoryEntry)) {
+        uint32_t m0 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) p), keyVec));
+        uint32_t m1 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (p + 32)), keyVec));
+        if ((m0 & key.mask) == key.mask) {
+            return idx;
+        }
+
+        if ((m1 & key.mask) == key.mask) {
+            return idx + 1;
+        }
+    }
+
+    if (idx < count) {
+        uint32_t m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) p), keyVec));
+        if ((m & key.mask) == key.mask) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+#endif
+
+typedef int (*FindFunc)(const DirectoryEntry*, int, const DirectoryNameKey&);
+
+struct LookupImpl {
+    FindFunc func;
+    const char* name;
+};
+
+/**
+ * 选择实现。环境变量 V6PP_LOOKUP 可以指定较低的实现（sse2 或 scalar），便于对比。
+ */
+static LookupImpl selectImpl() {
+    const char* env = getenv("V6PP_LOOKUP");
+    string wanted = env == nullptr ? "" : env;
+
+#ifdef V6PP_LOOKUP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && (wanted.empty() || wanted == "avx2")) {
+        return { findAvx2, "avx2" };
+    }
+
+    if (__builtin_cpu_supports("sse2") && wanted != "scalar") {
+        return { findSse2, "sse2" };
+    }
+#endif
+
+    return { findScalar, "scalar" };
+}
+
+static const LookupImpl& lookupImpl() {
+    static const LookupImpl impl = selectImpl();
+    return impl;
+}
+
+int findDirectoryEntry(const DirectoryEntry* entries, int count, const DirectoryNameKey& key) {
+    if (!key.valid || count <= 0) {
+        return -1;
+    }
+
+    return lookupImpl().func(entries, count, key);
+}
+
+const char* directoryLookupImpl() {
+    return lookupImpl().name;
+}
@@ -0,0 +1,45 @@
+/*
+ * 目录项按名查找 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class DirectoryEntry;
+
+/**
+ * 查找用的键。布局与 DirectoryEntry 相同（前 4 字节对应 m_ino，不参与比较），
+ * 一次载入 32 字节即可与一个目录项比较。
+ *
+ * 比较的范围是文件名与结尾的 0；文件名恰好 28 字节时没有结尾的 0，比较全部 28 字节。
+ * 这与按 C 字符串比较的结果一致，且不依赖目录项中结尾 0 之后的内容。
+ */
+class DirectoryNameKey {
+public:
+    DirectoryNameKey(const std::string& name);
+
+public:
+    alignas(32) uint8_t bytes[32];
+
+    /** 参与比较的字节位。第 i 位对应 bytes[i]。 */
+    uint32_t mask;
+
+    /** 名字为空或超过 28 字节时不可能匹配任何目录项。 */
+    bool valid;
+};
+
+/**
+ * 在目录项数组中查找名字。按 CPU 支持的指令集在运行时选择 AVX2、SSE2 或逐项比较。
+ *
+ * @return 目录项下标。找不到时返回 -1。
+ */
+int findDirectoryEntry(const DirectoryEntry* entries, int count, const DirectoryNameKey& key);
+
+/**
+ * 实际使用的实现："avx2"、"sse2" 或 "scalar"。
+ */
+const char* directoryLookupImpl();
@@ -0,0 +1,104 @@
+/*
+ * 目录的只读视图 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include "./FileSystemAdapter.h"
+#include "./BlockTrace.h"
+#include "./Tracer.h"
+#include "./structures/InodeDirectory.h"
+#include "./structures/DirectoryLookup.h"
+#include "./structures/DirectoryView.h"
+
+using namespace std;
+
+DirectoryView::DirectoryView(Inode& inode, FileSystemAdapter& adapter) {
+    int dirFileSize = inode.d_size;
+    int blockCount = (dirFileSize + sizeof(Block) - 1) / sizeof(Block);
+    V6PP_STAT_SCOPE(adapter.ioStats, LOAD_DIRECTORY, -1, blockCount);
+    V6PP_TRACE_SCOPE("loadDirectory", int(&inode - adapter.inodes));
+
+    length = dirFileSize / sizeof(DirectoryEntry);
+    if (length == 0) {
+        return;
+    }
+
+    segments = arena.allocateArray<Segment>(blockCount);
+    const int entriesPerBlock = sizeof(Block) / sizeof(DirectoryEntry);
+
+    if (adapter.imgMap != nullptr) {
+        bool hasHole = false;
+        int prevBlockIdx = -1;
+
+        // 只收集盘块号。索引块仍经过 readBlocks 读取。
+        adapter.iterateOverInodeDataBlocks(
+            inode,
+
+            [&] (int dataByteOffset, int blockIdx) {
+                if (blockIdx == 0) {
+                    hasHole = true;
+                    return;
+                }
+
+                int count = min(entriesPerBlock, length - dataByteOffset / (int) sizeof(DirectoryEntry));
+                if (segmentCount > 0 && blockIdx == prevBlockIdx + 1) {
+                    segments[segmentCount - 1].count += count;
+                } else {
+                    segments[segmentCount++] = {
+                        (const DirectoryEntry*) (adapter.imgMap + 1LL * blockIdx * sizeof(Block)), count
+                    };
+                }
+
+                prevBlockIdx = blockIdx;
+            },
+
+            [] (int prevBlockIdx) {
+                return prevBlockIdx;
+            },
+
+            [&] (Inode&, int, const char*) {
+                hasHole = true;
+            },
+
+            [] (...) {},
+
+            [] (...) {}
+        );
+
+        if (!hasHole) {
+            zeroCopy = true;
+            if (adapter.blockTrace != nullptr) {
+                BlockTraceTag tag(BlockTrace::TAG_DIRECTORY);
+                for (int seg = 0; seg < segmentCount; seg++) {
+                    int blockIdx = (int) (((const char*) segments[seg].entries - adapter.imgMap) / sizeof(Block));
+                    adapter.blockTrace->record(
+                        BlockTrace::READ, blockIdx, (segments[seg].count + entriesPerBlock - 1) / entriesPerBlock
+                    );
+                }
+            }
+
+            return;
+        }
+
+        segmentCount = 0;
+    }
+
+    // 复制到内存区。
+    DirectoryEntry* copy = arena.allocateArray<DirectoryEntry>(blockCount * entriesPerBlock);
+    adapter.readFile((char*) copy, inode);
+    segments[0] = { copy, length };
+    segmentCount = 1;
+}
+
+const DirectoryEntry* DirectoryView::find(const string& name) const {
+    DirectoryNameKey key(name);
+    for (int seg = 0; seg < segmentCount; seg++) {
+        int idx = findDirectoryEntry(segments[seg].entries, segments[seg].count, key);
+        if (idx >= 0) {
+            return segments[seg].entries + idx;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,78 @@
+/*
+ * 目录的只读视图 - 头文件。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include "../Arena.h"
+#include "./Inode.h"
+
+class DirectoryEntry;
+class FileSystemAdapter;
+
+/**
+ * 目录的只读视图。
+ *
+ * 映像映射到内存（FileSystemAdapter::imgMap）时，直接指向映像中的目录盘块，不复制；
+ * 盘块号连续的部分合并为一段。没有映射（覆盖层模式、只能使用文件流）或目录中有空洞时，
+ * 复制到当前线程的 Arena 中。段表同样分配在 Arena 中，析构时归还。
+ *
+ * 视图有效期间，调用者须持有目录 inode 的锁（共享锁即可），且不能修改或释放该目录的盘块。
+ * 同一线程上的多个视图须按栈的顺序析构。
+ */
+class DirectoryView {
+public:
+    /** 连续的一段目录项。 */
+    struct Segment {
+        const DirectoryEntry* entries;
+        int count;
+    };
+
+public:
+    DirectoryView(Inode& inode, FileSystemAdapter& adapter);
+
+    ~DirectoryView() {
+        arena.release(marker);
+    }
+
+    DirectoryView(const DirectoryView&) = delete;
+    DirectoryView& operator = (const DirectoryView&) = delete;
+
+    /**
+     * 依次处理每个目录项。
+     */
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (int seg = 0; seg < segmentCount; seg++) {
+            for (int idx = 0; idx < segments[seg].count; idx++) {
+                fn(segments[seg].entries[idx]);
+            }
+        }
+    }
+
+    /**
+     * 按名查找目录项。
+     *
+     * @return 目录项。找不到时返回 nullptr。
+     */
+    const DirectoryEntry* find(const std::string& name) const;
+
+    /** 是否直接指向映像（没有复制）。 */
+    inline bool isZeroCopy() const {
+        return zeroCopy;
+    }
+
+public:
+    int length = 0;
+
+private:
+    Segment* segments = nullptr;
+    int segmentCount = 0;
+    bool zeroCopy = false;
+
+    Arena& arena = Arena::local();
+    Arena::Marker marker = arena.mark();
+};
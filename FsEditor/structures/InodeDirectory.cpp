@@ -10,8 +10,10 @@
 #include "./FileSystemAdapter.h"
 #include "./MacroDefines.h"
 #include "./MachineProps.h"
+#include "./Tracer.h"
 #include "./structures/Inode.h"
 #include "./structures/InodeDirectory.h"
+#include "./structures/DirectoryLookup.h"
 
 using namespace std;
 
@@ -26,16 +28,22 @@ InodeDirectory::InodeDirectory(
     }
 
     int dirFileSize = inode.d_size;
+    V6PP_STAT_SCOPE(adapter.ioStats, LOAD_DIRECTORY, -1, (dirFileSize + 511) / 512);
+    V6PP_TRACE_SCOPE("loadDirectory", int(&inode - adapter.inodes));
     int allocDirFileSize = dirFileSize + sizeof(DirectoryEntry) * extraEntriesToAlloc;
     length = dirFileSize / sizeof(DirectoryEntry);
-    this->entries = new DirectoryEntry[
+    this->entries = arena.allocateArray<DirectoryEntry>(
         (allocDirFileSize / 512 + !!(allocDirFileSize % 512)) * 512 / sizeof(DirectoryEntry)
-    ];
+    );
     
     adapter.readFile((char*) this->entries, inode);
 
 } // InodeDirectory::InodeDirectory
 
 InodeDirectory::InodeDirectory(int nEntries) {
-    this->entries = new DirectoryEntry[nEntries];
+    this->entries = arena.allocateArray<DirectoryEntry>(nEntries);
+}
+
+int InodeDirectory::find(const string& name) const {
+    return findDirectoryEntry(entries, length, DirectoryNameKey(name));
 }
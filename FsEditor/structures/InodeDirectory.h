@@ -7,7 +7,9 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include "../MacroDefines.h"
+#include "../Arena.h"
 #include "../FileSystemAdapter.h"
 #include "./Inode.h"
 
@@ -16,7 +18,7 @@
  */
 class DirectoryEntry {
 public:
-    static const int DIRSIZE = 28;
+    static constexpr int DIRSIZE = 28;
 
 public:
     /** 对应文件的 inode 编号。 */
@@ -27,14 +29,14 @@ public:
 } __packed;
 
 /**
- * 目录文件。
+ * 目录文件的可修改副本。目录项数组从当前线程的 Arena 中分配，析构时归还，
+ * 因此同一线程上的多个 InodeDirectory 须按栈的顺序析构（局部变量自然满足）。
+ * 只需读取时使用 DirectoryView，可以不复制。
  */
 class InodeDirectory {
 public:
     ~InodeDirectory() {
-        if (entries != nullptr) {
-            delete[] entries;
-        }
+        arena.release(marker);
     }
 
     InodeDirectory(
@@ -46,11 +48,24 @@ public:
 
     InodeDirectory(int nEntries);
 
+    /**
+     * 按名查找目录项。
+     * 
+     * @return 目录项下标。找不到时返回 -1。
+     */
+    int find(const std::string& name) const;
+
+    InodeDirectory(const InodeDirectory&) = delete;
+    InodeDirectory& operator = (const InodeDirectory&) = delete;
+
 public:
     int length = 0;
     DirectoryEntry* entries = nullptr;
 
-} __packed;
+private:
+    Arena& arena = Arena::local();
+    Arena::Marker marker = arena.mark();
+};
 
 
 
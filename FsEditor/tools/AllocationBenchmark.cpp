@@ -0,0 +1,220 @@
+/*
+ * 分配策略对比。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "./MachineProps.h"
+#include "./FileSystemAdapter.h"
+#include "./tools/AllocationBenchmark.h"
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::filesystem;
+
+/** 参与对比的策略。stack 为 V6++ 默认方式。 */
+static const char* POLICIES[] = { "stack", "first-fit", "locality", "pack" };
+
+/** 模拟使用过程时的目录数。 */
+static const int BENCH_DIRS = 4;
+
+/** 单次读取的最大盘块数。 */
+static const int EXTENT_BLOCKS_MAX = 2048;
+
+AllocationBenchmark::AllocationBenchmark(const string& scratchImgPath, const string& hostDirPath) 
+    : scratchImgPath(scratchImgPath), hostDirPath(hostDirPath) {
+
+}
+
+bool AllocationBenchmark::collectHostFiles() {
+    error_code ec;
+    if (!is_directory(hostDirPath, ec)) {
+        cout << "[error] 不是目录：" << hostDirPath << endl;
+        return false;
+    }
+
+    vector<string> candidates;
+    for (auto& entry : recursive_directory_iterator(hostDirPath, ec)) {
+        if (entry.is_regular_file(ec)) {
+            candidates.push_back(entry.path().string());
+        }
+    }
+
+    sort(candidates.begin(), candidates.end());
+
+    // 数据区约 17000 块。两轮上传，删掉一半，再留出索引块与目录的余量。
+    FileSystemAdapter probe(scratchImgPath.c_str());
+    long long budget = 1LL * probe.superBlock.data_zone_blocks * sizeof(Block) / 3;
+    long long used = 0;
+
+    for (const auto& file : candidates) {
+        long long size = file_size(file, ec);
+        if (ec || size > probe.FS_FILE_SIZE_MAX || used + size > budget) {
+            continue;
+        }
+
+        hostFiles.push_back(file);
+        used += size;
+    }
+
+    if (hostFiles.empty()) {
+        cout << "[error] 没有可用的测试文件：" << hostDirPath << endl;
+        return false;
+    }
+
+    cout << "[info] 测试文件：" << hostFiles.size() << " 个，共 " << used << " 字节。" << endl;
+    return true;
+}
+
+bool AllocationBenchmark::runPolicy(const string& policy, AllocationBenchmarkResult& result) {
+    result.policy = policy;
+
+    {
+        FileSystemAdapter adapter(scratchImgPath.c_str());
+        adapter.format();
+        adapter.setAllocationPolicy(policy);
+
+        vector<int> dirs;
+        for (int idx = 0; idx < BENCH_DIRS; idx++) {
+            dirs.push_back(adapter.mkdir("d" + to_string(idx)));
+        }
+
+        auto uploadRound = [&] (const char* prefix, int dirShift) {
+            for (int idx = 0; idx < hostFiles.size(); idx++) {
+                adapter.session().inodeIdxStack.push_back(dirs[(idx + dirShift) % BENCH_DIRS]);
+                adapter.uploadFile(prefix + to_string(idx), hostFiles[idx]);
+                adapter.session().inodeIdxStack.pop_back();
+            }
+        };
+
+        uploadRound("a", 0);
+
+        for (int idx = 0; idx < hostFiles.size(); idx += 2) {
+            adapter.session().inodeIdxStack.push_back(dirs[idx % BENCH_DIRS]);
+            adapter.rm("a" + to_string(idx));
+            adapter.session().inodeIdxStack.pop_back();
+        }
+
+        uploadRound("b", 1);
+        adapter.sync();
+    }
+
+    FileSystemAdapter adapter(scratchImgPath.c_str(), nullptr, true);
+    adapter.load();
+    result.fragmentation = Defragmenter(adapter).measure();
+    measureReads(result);
+
+    return true;
+}
+
+void AllocationBenchmark::measureReads(AllocationBenchmarkResult& result) {
+    vector<uint32_t> order;
+    {
+        FileSystemAdapter adapter(scratchImgPath.c_str(), nullptr, true);
+        adapter.load();
+        order = Defragmenter(adapter).readOrder();
+    }
+
+    // 合并成连续的区段。
+    vector<pair<uint32_t, int>> runs;
+    long long seekDistance = 0;
+    for (uint32_t blockIdx : order) {
+        if (!runs.empty() 
+            && runs.back().first + runs.back().second == blockIdx 
+            && runs.back().second < EXTENT_BLOCKS_MAX
+        ) {
+            runs.back().second++;
+            continue;
+        }
+
+        if (!runs.empty()) {
+            seekDistance += llabs((long long) blockIdx - (runs.back().first + runs.back().second));
+        }
+
+        runs.push_back({ blockIdx, 1 });
+    }
+
+    result.seeks = runs.empty() ? 0 : runs.size() - 1;
+    result.meanSeekDistance = result.seeks == 0 ? 0 : double(seekDistance) / result.seeks;
+
+#ifdef __linux__
+    // 丢弃页缓存，让读取尽量落到设备上。
+    int fd = open(scratchImgPath.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+
+    FileSystemAdapter adapter(scratchImgPath.c_str(), nullptr, true);
+    adapter.load();
+
+    vector<char> buffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+    auto begin = chrono::steady_clock::now();
+    for (const auto& [blockIdx, count] : runs) {
+        adapter.readBlocks(buffer.data(), blockIdx, count);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    double megabytes = double(order.size()) * sizeof(Block) / (1024 * 1024);
+    result.readThroughput = seconds > 0 ? megabytes / seconds : 0;
+}
+
+bool AllocationBenchmark::run() {
+    // 准备临时映像。
+    if (!ofstream(scratchImgPath).is_open()) {
+        cout << "[error] 无法创建临时映像：" << scratchImgPath << endl;
+        return false;
+    }
+
+    resize_file(scratchImgPath, MachineProps::diskSize());
+
+    if (!collectHostFiles()) {
+        return false;
+    }
+
+    vector<AllocationBenchmarkResult> results;
+    for (const char* policy : POLICIES) {
+        AllocationBenchmarkResult result;
+        if (!runPolicy(policy, result)) {
+            return false;
+        }
+
+        results.push_back(result);
+    }
+
+    cout << endl;
+    cout << left << setw(12) << "policy" 
+        << right << setw(10) << "frag(%)" 
+        << setw(10) << "extents" 
+        << setw(12) << "fragmented" 
+        << setw(8) << "seeks" 
+        << setw(14) << "seek dist" 
+        << setw(12) << "read MB/s" << endl;
+
+    for (const auto& result : results) {
+        cout << left << setw(12) << result.policy 
+            << right << fixed << setprecision(2) 
+            << setw(10) << result.fragmentation.fragmentation() * 100 
+            << setw(10) << result.fragmentation.extents 
+            << setw(12) << result.fragmentation.fragmentedFiles 
+            << setw(8) << result.seeks 
+            << setw(14) << result.meanSeekDistance 
+            << setw(12) << result.readThroughput << endl;
+    }
+
+    cout << defaultfloat;
+    return true;
+}
@@ -0,0 +1,68 @@
+/*
+ * 分配策略对比。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "../FileSystemAdapter.h"
+#include "./Defragmenter.h"
+
+/**
+ * 一种分配策略的测试结果。
+ */
+class AllocationBenchmarkResult {
+public:
+    std::string policy;
+    FragmentationReport fragmentation;
+
+    /** 按目录树顺序读取所有文件时，盘块号不连续的次数。 */
+    int seeks = 0;
+
+    /** 平均每次寻道跨越的盘块数。 */
+    double meanSeekDistance = 0;
+
+    /** 顺序读取所有文件的吞吐，MB/s。 */
+    double readThroughput = 0;
+};
+
+/**
+ * 分配策略对比。
+ * 
+ * 对每种策略，在临时映像上格式化后，用宿主机目录中的文件模拟一段使用过程：
+ * 把文件轮流上传到 4 个目录中，删除其中一半，再上传一轮。
+ * 之后统计碎片情况，并按目录树顺序读取所有文件，记录寻道次数与读取吞吐。
+ * Linux 下读取前会丢弃映像文件的页缓存。
+ */
+class AllocationBenchmark {
+public:
+    /**
+     * @param scratchImgPath 临时映像路径。会被覆盖。
+     * @param hostDirPath 提供测试文件的宿主机目录。
+     */
+    AllocationBenchmark(const std::string& scratchImgPath, const std::string& hostDirPath);
+
+    /**
+     * 依次测试所有策略，并输出对比表。
+     * 
+     * @return 是否成功。
+     */
+    bool run();
+
+private:
+    /** 收集测试文件。总大小限制在数据区的三分之一左右，保证两轮上传都放得下。 */
+    bool collectHostFiles();
+
+    bool runPolicy(const std::string& policy, AllocationBenchmarkResult& result);
+
+    /** 按目录树顺序读取所有文件。 */
+    void measureReads(AllocationBenchmarkResult& result);
+
+private:
+    std::string scratchImgPath;
+    std::string hostDirPath;
+    std::vector<std::string> hostFiles;
+};
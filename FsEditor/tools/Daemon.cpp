@@ -0,0 +1,349 @@
+/*
+ * 常驻服务：通过 Unix 域套接字接收命令。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include "./Daemon.h"
+
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+
+#ifdef __linux__
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <csignal>
+#endif
+
+using namespace std;
+
+Daemon::Daemon(const string& socketPath, Executor executor, SessionReset sessionReset, Shutdown shutdown)
+    : socketPath(socketPath), executor(executor), sessionReset(sessionReset), shutdown(shutdown) {
+
+}
+
+string Daemon::jsonString(const string& s) {
+    string res = "\"";
+    for (unsigned char c : s) {
+        if (c == '"') {
+            res += "\\\"";
+        } else if (c == '\\') {
+            res += "\\\\";
+        } else if (c == '\n') {
+            res += "\\n";
+        } else if (c == '\r') {
+            res += "\\r";
+        } else if (c == '\t') {
+            res += "\\t";
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            res += buf;
+        } else {
+            res += char(c);
+        }
+    }
+
+    res += '"';
+    return res;
+}
+
+int Daemon::handleRequest(const string& request, long long seq, string& out) {
+    DaemonReply reply;
+    int action = 0;
+
+    if (!request.empty() && request[0] == '#') { // 服务控制命令。
+        if (request == "#ping") {
+            reply.output = "pong";
+        } else if (request == "#shutdown") {
+            reply.output = "bye!";
+            action = 2;
+        } else {
+            reply.ok = false;
+            reply.output = "[error] unknown control command: " + request;
+        }
+    } else {
+        reply = executor(request);
+        if (reply.closeConnection) {
+            action = 1;
+        }
+    }
+
+    out += "{\"seq\":";
+    out += to_string(seq);
+    out += ",\"ok\":";
+    out += reply.ok ? "true" : "false";
+    out += ",\"cwd\":";
+    out += jsonString(reply.cwd);
+    out += ",\"output\":";
+    out += jsonString(reply.output);
+    out += "}\n";
+
+    return action;
+}
+
+#ifdef __linux__
+
+/**
+ * 收到 SIGTERM 或 SIGINT 后置位。serve 据此存盘退出。
+ */
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int) {
+    stopRequested = 1;
+}
+
+/**
+ * 写出全部数据。
+ */
+static bool sendAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+bool Daemon::serveConnection(int fd) {
+    sessionReset();
+
+    string pending; // 尚未成为完整一行的数据。
+    char buf[4096];
+    long long seq = 0;
+
+    while (true) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (stopRequested) {
+            return true;
+        }
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return false; // 客户端断开。
+        }
+
+        pending.append(buf, n);
+
+        // 依次执行已经收到的所有完整请求，回复合并后一次写回。
+        string out;
+        size_t lineBegin = 0;
+        int action = 0;
+        while (action == 0) {
+            size_t lineEnd = pending.find('\n', lineBegin);
+            if (lineEnd == string::npos) {
+                break;
+            }
+
+            string request = pending.substr(lineBegin, lineEnd - lineBegin);
+            lineBegin = lineEnd + 1;
+            if (!request.empty() && request.back() == '\r') {
+                request.pop_back();
+            }
+
+            if (request.empty()) {
+                continue;
+            }
+
+            action = handleRequest(request, ++seq, out);
+        }
+
+        pending.erase(0, lineBegin);
+
+        if (!sendAll(fd, out.data(), out.size())) {
+            return false;
+        }
+
+        if (action == 1) {
+            return false;
+        } else if (action == 2) {
+            return true;
+        }
+    }
+}
+
+bool Daemon::serve() {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        cout << "[error] socket path too long: " << socketPath << endl;
+        return false;
+    }
+
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        cout << "[error] failed to create socket: " << strerror(errno) << endl;
+        return false;
+    }
+
+    // 清理上次遗留的套接字文件。同名的普通文件等不是我们留下的，不能删。
+    struct stat st;
+    if (lstat(socketPath.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            cout << "[error] " << socketPath << " exists and is not a socket." << endl;
+            close(listenFd);
+            return false;
+        }
+
+        unlink(socketPath.c_str());
+    }
+
+    if (bind(listenFd, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(listenFd, 8) < 0) {
+        cout << "[error] failed to listen on " << socketPath << ": " << strerror(errno) << endl;
+        close(listenFd);
+        return false;
+    }
+
+    // 被 kill 或 Ctrl+C 时也要存盘并删除套接字文件。不设 SA_RESTART，让阻塞的 accept、recv 返回。
+    struct sigaction action, oldTerm, oldInt;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    stopRequested = 0;
+    sigaction(SIGTERM, &action, &oldTerm);
+    sigaction(SIGINT, &action, &oldInt);
+
+    cout << "listening on " << socketPath << endl;
+
+    bool stop = false;
+    while (!stop) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (stopRequested) {
+            if (fd >= 0) {
+                close(fd);
+            }
+
+            stop = true;
+            break;
+        }
+
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            cout << "[error] accept failed: " << strerror(errno) << endl;
+            break;
+        }
+
+        stop = serveConnection(fd);
+        close(fd);
+    }
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+    shutdown();
+
+    sigaction(SIGTERM, &oldTerm, nullptr);
+    sigaction(SIGINT, &oldInt, nullptr);
+
+    return stop;
+}
+
+int Daemon::runClient(const string& socketPath) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        cout << "[error] socket path too long: " << socketPath << endl;
+        return -1;
+    }
+
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0) {
+        cout << "[error] failed to connect to " << socketPath << ": " << strerror(errno) << endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return -1;
+    }
+
+    // 发送线程：逐行转发标准输入，结束后关闭写端。
+    thread sender([fd] () {
+        string line;
+        while (getline(cin, line)) {
+            line += '\n';
+            if (!sendAll(fd, line.data(), line.size())) {
+                break;
+            }
+        }
+
+        ::shutdown(fd, SHUT_WR);
+    });
+
+    // 接收：原样输出回复，直到服务端关闭连接。
+    bool allOk = true;
+    string pending;
+    char buf[4096];
+    while (true) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            break;
+        }
+
+        pending.append(buf, n);
+        size_t lineEnd;
+        while ((lineEnd = pending.find('\n')) != string::npos) {
+            string reply = pending.substr(0, lineEnd);
+            pending.erase(0, lineEnd + 1);
+            if (reply.find("\"ok\":false") != string::npos) {
+                allOk = false;
+            }
+
+            cout << reply << '\n';
+        }
+
+        cout.flush();
+    }
+
+    // 服务端可能先于标准输入结束而关闭连接（例如收到 x），此时不再等待发送线程。
+    sender.detach();
+    close(fd);
+
+    return allOk ? 0 : 1;
+}
+
+#else
+
+bool Daemon::serveConnection(int fd) {
+    return false;
+}
+
+bool Daemon::serve() {
+    cout << "[error] daemon mode requires unix domain sockets (linux only)." << endl;
+    return false;
+}
+
+int Daemon::runClient(const string& socketPath) {
+    cout << "[error] daemon mode requires unix domain sockets (linux only)." << endl;
+    return -1;
+}
+
+#endif
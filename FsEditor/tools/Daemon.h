@@ -0,0 +1,107 @@
+/*
+ * 常驻服务：通过 Unix 域套接字接收命令。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include <functional>
+
+/**
+ * 一条命令的执行结果。
+ */
+struct DaemonReply {
+    /** 命令输出（即交互模式下打印到标准输出的内容）。 */
+    std::string output;
+
+    /** 执行后的当前目录。 */
+    std::string cwd;
+
+    /** 命令是否成功。 */
+    bool ok = true;
+
+    /** 是否结束当前连接（x 命令）。 */
+    bool closeConnection = false;
+};
+
+/**
+ * 常驻服务。
+ *
+ * 映像只加载一次，superblock、inode、缓存与附属文件常驻内存，
+ * 之后的每次调用只需连接套接字发送命令，省去进程启动与加载的开销。
+ *
+ * 协议（按行）：
+ *   请求：一行一条命令，语法与交互模式相同，例如 "c |bin|"、"g |a.txt| |/tmp/a.txt|"。
+ *         以 # 开头的行是服务控制命令：
+ *           #ping      仅回复，不执行任何操作。
+ *           #shutdown  存盘并停止服务。
+ *   回复：每条请求对应一行 JSON，按请求顺序返回：
+ *         {"seq":1,"ok":true,"cwd":"/bin","output":"..."}
+ *         seq 为连接内的请求序号（从 1 开始）。
+ *
+ * 客户端可以不等回复，连续发送多条请求（流水线）。服务端一次读入尽可能多的完整请求，
+ * 依次执行后把回复合并写回。
+ *
+ * 连接依次处理：同一时刻只服务一个客户端。每个新连接的当前目录都从根目录开始。
+ */
+class Daemon {
+public:
+    /**
+     * 执行一条命令。
+     */
+    using Executor = std::function<DaemonReply (const std::string& request)>;
+
+    /**
+     * 新连接建立时调用（用于重置当前目录等会话状态）。
+     */
+    using SessionReset = std::function<void ()>;
+
+    /**
+     * 服务结束前调用（用于存盘）。
+     */
+    using Shutdown = std::function<void ()>;
+
+    Daemon(const std::string& socketPath, Executor executor, SessionReset sessionReset, Shutdown shutdown);
+
+    /**
+     * 开始服务，直到收到 #shutdown、SIGTERM 或 SIGINT。
+     *
+     * @return 是否正常结束。
+     */
+    bool serve();
+
+    /**
+     * 瘦客户端：把标准输入的每一行作为请求发送，并把回复逐行打印到标准输出。
+     * 发送与接收同时进行，请求不必等待前一条的回复。
+     *
+     * @return 程序返回值。所有请求都成功时为 0。
+     */
+    static int runClient(const std::string& socketPath);
+
+    /**
+     * 把字符串转义为 JSON 字符串（含引号）。
+     */
+    static std::string jsonString(const std::string& s);
+
+protected:
+    std::string socketPath;
+    Executor executor;
+    SessionReset sessionReset;
+    Shutdown shutdown;
+
+    /**
+     * 服务一个连接。
+     *
+     * @return 是否收到了 #shutdown。
+     */
+    bool serveConnection(int fd);
+
+    /**
+     * 处理一条请求，并把回复追加到 out。
+     *
+     * @return 0 继续；1 关闭连接；2 停止服务。
+     */
+    int handleRequest(const std::string& request, long long seq, std::string& out);
+};
@@ -0,0 +1,580 @@
+/*
+ * 碎片整理。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "./MachineProps.h"
+#include "./FileSystemAdapter.h"
+#include "./BlockOwnerMap.h"
+#include "./structures/Block.h"
+#include "./structures/Inode.h"
+#include "./structures/InodeDirectory.h"
+#include "./tools/Defragmenter.h"
+
+using namespace std;
+
+/** 每个索引块的条目数。 */
+static const int ENTRIES_PER_IDX_BLOCK = sizeof(Block) / sizeof(uint32_t);
+
+/** 单次读写的最大盘块数。 */
+static const int EXTENT_BLOCKS_MAX = 2048;
+
+Defragmenter::Defragmenter(FileSystemAdapter& adapter) : adapter(adapter) {
+    dataZoneBegin = adapter.superBlock.data_zone_begin;
+    dataZoneEnd = adapter.superBlock.data_zone_begin + adapter.superBlock.data_zone_blocks;
+}
+
+bool Defragmenter::loadDataZone() {
+    if (dataZoneEnd > MachineProps::diskBlocks() || dataZoneBegin >= dataZoneEnd) {
+        cout << "[error] SuperBlock 中的数据区信息有误。" << endl;
+        return false;
+    }
+
+    int zoneBlocks = dataZoneEnd - dataZoneBegin;
+    zone.resize(1LL * zoneBlocks * sizeof(Block));
+
+    for (int offset = 0; offset < zoneBlocks; offset += EXTENT_BLOCKS_MAX) {
+        int count = min(EXTENT_BLOCKS_MAX, zoneBlocks - offset);
+        if (!adapter.readBlocks(zone.data() + 1LL * offset * sizeof(Block), dataZoneBegin + offset, count)) {
+            cout << "[error] 读取数据区失败。" << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Defragmenter::collectFileBlocks(Inode& inode, vector<uint32_t>& blocks, bool dataBlocksOnly) {
+    blocks.clear();
+    if (!inode.ialloc 
+        || (inode.file_type != Inode::FileType::NORMAL && inode.file_type != Inode::FileType::DIR)
+    ) {
+        return true; // 设备文件等没有数据块。
+    }
+
+    long long size = min((long long) inode.d_size, (long long) adapter.FS_FILE_SIZE_MAX);
+    int blocksRemaining = (size + sizeof(Block) - 1) / sizeof(Block);
+
+    auto addBlock = [&] (uint32_t blockIdx) {
+        if (blockIdx == 0) {
+            return true; // 空洞。
+        }
+
+        if (!inDataZone(blockIdx)) {
+            return false;
+        }
+
+        blocks.push_back(blockIdx);
+        return true;
+    };
+
+    // 索引块先于它索引的数据块，与顺序读取时的访问顺序一致。
+    auto addIdxBlock = [&] (uint32_t idxBlockIdx, int count) {
+        if (idxBlockIdx == 0) {
+            return true;
+        }
+
+        if (!inDataZone(idxBlockIdx) || (!dataBlocksOnly && !addBlock(idxBlockIdx))) {
+            return false;
+        }
+
+        const uint32_t* entries = (const uint32_t*) blockInZone(zone, idxBlockIdx);
+        for (int idx = 0; idx < count; idx++) {
+            if (!addBlock(entries[idx])) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    for (int idx = 0; idx < 6 && blocksRemaining > 0; idx++, blocksRemaining--) {
+        if (!addBlock(inode.direct_index[idx])) {
+            return false;
+        }
+    }
+
+    for (int k = 0; k < 2 && blocksRemaining > 0; k++) {
+        int count = min(ENTRIES_PER_IDX_BLOCK, blocksRemaining);
+        if (!addIdxBlock(inode.indirect_index[k], count)) {
+            return false;
+        }
+
+        blocksRemaining -= count;
+    }
+
+    for (int k = 0; k < 2 && blocksRemaining > 0; k++) {
+        uint32_t secIdxBlockIdx = inode.secondary_indirect_index[k];
+        int secCount = min(ENTRIES_PER_IDX_BLOCK * ENTRIES_PER_IDX_BLOCK, blocksRemaining);
+
+        if (secIdxBlockIdx != 0) {
+            if (!inDataZone(secIdxBlockIdx) || (!dataBlocksOnly && !addBlock(secIdxBlockIdx))) {
+                return false;
+            }
+
+            const uint32_t* firEntries = (const uint32_t*) blockInZone(zone, secIdxBlockIdx);
+            int remaining = secCount;
+            for (int fir = 0; fir < ENTRIES_PER_IDX_BLOCK && remaining > 0; fir++) {
+                int count = min(ENTRIES_PER_IDX_BLOCK, remaining);
+                if (!addIdxBlock(firEntries[fir], count)) {
+                    return false;
+                }
+
+                remaining -= count;
+            }
+        }
+
+        blocksRemaining -= secCount;
+    }
+
+    return true;
+}
+
+void Defragmenter::remapFileIndexes(Inode& inode, const vector<uint32_t>& remap) {
+    if (!inode.ialloc 
+        || (inode.file_type != Inode::FileType::NORMAL && inode.file_type != Inode::FileType::DIR)
+    ) {
+        return;
+    }
+
+    long long size = min((long long) inode.d_size, (long long) adapter.FS_FILE_SIZE_MAX);
+    int blocksRemaining = (size + sizeof(Block) - 1) / sizeof(Block);
+
+    auto mapped = [&] (uint32_t blockIdx) {
+        return blockIdx == 0 ? 0 : remap[blockIdx];
+    };
+
+    // 改写一个一级索引块（已在新位置）中的条目。
+    auto remapIdxBlock = [&] (uint32_t newIdxBlockIdx, int count) {
+        uint32_t* entries = (uint32_t*) blockInZone(newZone, newIdxBlockIdx);
+        for (int idx = 0; idx < ENTRIES_PER_IDX_BLOCK; idx++) {
+            entries[idx] = idx < count ? mapped(entries[idx]) : 0;
+        }
+    };
+
+    for (int idx = 0; idx < 6 && blocksRemaining > 0; idx++, blocksRemaining--) {
+        inode.direct_index[idx] = mapped(inode.direct_index[idx]);
+    }
+
+    for (int k = 0; k < 2 && blocksRemaining > 0; k++) {
+        int count = min(ENTRIES_PER_IDX_BLOCK, blocksRemaining);
+        uint32_t newIdxBlockIdx = mapped(inode.indirect_index[k]);
+        inode.indirect_index[k] = newIdxBlockIdx;
+        if (newIdxBlockIdx != 0) {
+            remapIdxBlock(newIdxBlockIdx, count);
+        }
+
+        blocksRemaining -= count;
+    }
+
+    for (int k = 0; k < 2 && blocksRemaining > 0; k++) {
+        int secCount = min(ENTRIES_PER_IDX_BLOCK * ENTRIES_PER_IDX_BLOCK, blocksRemaining);
+        uint32_t newSecIdxBlockIdx = mapped(inode.secondary_indirect_index[k]);
+        inode.secondary_indirect_index[k] = newSecIdxBlockIdx;
+
+        if (newSecIdxBlockIdx != 0) {
+            uint32_t* firEntries = (uint32_t*) blockInZone(newZone, newSecIdxBlockIdx);
+            int remaining = secCount;
+            for (int fir = 0; fir < ENTRIES_PER_IDX_BLOCK; fir++) {
+                if (remaining <= 0) {
+                    firEntries[fir] = 0;
+                    continue;
+                }
+
+                int count = min(ENTRIES_PER_IDX_BLOCK, remaining);
+                firEntries[fir] = mapped(firEntries[fir]);
+                if (firEntries[fir] != 0) {
+                    remapIdxBlock(firEntries[fir], count);
+                }
+
+                remaining -= count;
+            }
+        }
+
+        blocksRemaining -= secCount;
+    }
+}
+
+vector<int> Defragmenter::treeOrder() {
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    vector<bool> visited(inodeCount, false);
+    vector<int> order;
+
+    vector<int> frontier = { adapter.ROOT_INODE_IDX };
+    visited[adapter.ROOT_INODE_IDX] = true;
+
+    while (!frontier.empty()) {
+        vector<int> next;
+        for (int dirIno : frontier) {
+            order.push_back(dirIno);
+
+            DirectoryView dir(adapter.inodes[dirIno], adapter);
+            dir.forEach([&] (const DirectoryEntry& entry) {
+                uint32_t ino = entry.m_ino;
+                if (ino >= inodeCount || visited[ino] || !adapter.inodes[ino].ialloc) {
+                    return;
+                }
+
+                visited[ino] = true;
+                if (adapter.inodes[ino].file_type == Inode::FileType::DIR) {
+                    next.push_back(ino);
+                } else {
+                    order.push_back(ino); // 文件紧跟在所在目录之后。
+                }
+            });
+        }
+
+        frontier.swap(next);
+    }
+
+    // 不可达的已分配 inode。
+    for (int ino = 1; ino < inodeCount; ino++) {
+        if (!visited[ino] && adapter.inodes[ino].ialloc) {
+            order.push_back(ino);
+        }
+    }
+
+    return order;
+}
+
+vector<int> Defragmenter::planInodeNumbers(const vector<int>& order, const vector<uint32_t>& remap) {
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    vector<int> newIno(inodeCount, 0);
+    vector<bool> used(inodeCount, false);
+
+    newIno[adapter.ROOT_INODE_IDX] = adapter.ROOT_INODE_IDX;
+    used[adapter.ROOT_INODE_IDX] = true;
+    int nextIno = adapter.ROOT_INODE_IDX + 1;
+    for (int ino : order) {
+        if (ino != adapter.ROOT_INODE_IDX) {
+            newIno[ino] = nextIno;
+            used[nextIno] = true;
+            nextIno++;
+        }
+    }
+
+    // 空闲 inode 依次填入剩下的编号。
+    int freeIno = 1;
+    for (int ino = 0; ino < inodeCount; ino++) {
+        if (ino == adapter.ROOT_INODE_IDX || adapter.inodes[ino].ialloc) {
+            continue;
+        }
+
+        while (ino != 0 && used[freeIno]) {
+            freeIno++;
+        }
+
+        newIno[ino] = ino == 0 ? 0 : freeIno;
+        if (ino != 0) {
+            used[freeIno] = true;
+        }
+    }
+
+    // 改写目录项。
+    vector<uint32_t> blocks;
+    for (int ino : order) {
+        Inode& inode = adapter.inodes[ino];
+        if (inode.file_type != Inode::FileType::DIR) {
+            continue;
+        }
+
+        collectFileBlocks(inode, blocks, true);
+
+        int entriesRemaining = inode.d_size / sizeof(DirectoryEntry);
+        for (uint32_t blockIdx : blocks) {
+            DirectoryEntry* entries = (DirectoryEntry*) blockInZone(newZone, remap[blockIdx]);
+            int count = min(entriesRemaining, int(sizeof(Block) / sizeof(DirectoryEntry)));
+            for (int idx = 0; idx < count; idx++) {
+                if (entries[idx].m_ino < inodeCount) {
+                    entries[idx].m_ino = newIno[entries[idx].m_ino];
+                }
+            }
+
+            entriesRemaining -= count;
+        }
+    }
+
+    return newIno;
+}
+
+void Defragmenter::applyInodeNumbers(const vector<int>& newIno) {
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    vector<char> oldInodes(sizeof(adapter.inodes));
+    memcpy(oldInodes.data(), adapter.inodes, sizeof(adapter.inodes));
+
+    for (int ino = 0; ino < inodeCount; ino++) {
+        memcpy(&adapter.inodes[newIno[ino]], oldInodes.data() + ino * sizeof(Inode), sizeof(Inode));
+    }
+
+    for (int& ino : adapter.session().inodeIdxStack) {
+        ino = newIno[ino];
+    }
+
+    // 空闲 inode 表里的编号已经失效。清空后由 tidyFreeLists 重新填入。
+    adapter.superBlock.s_ninode = 0;
+}
+
+bool Defragmenter::loadProfile(const string& profilePath, vector<int>& order) {
+    ifstream profile(profilePath);
+    if (!profile.is_open()) {
+        cout << "[error] 无法打开布局文件：" << profilePath << endl;
+        return false;
+    }
+
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    BlockOwnerMap* owners = adapter.ownerMap;
+    bool ownersBuilt = false;
+
+    string line;
+    int lineNo = 0;
+    while (getline(profile, line)) {
+        lineNo++;
+
+        // 去掉首尾空白。
+        size_t begin = line.find_first_not_of(" \t\r");
+        size_t end = line.find_last_not_of(" \t\r");
+        if (begin == string::npos || line[begin] == '#') {
+            continue;
+        }
+
+        line = line.substr(begin, end - begin + 1);
+
+        // 盘块号：换算成所属文件的路径。
+        if (line.find_first_not_of("0123456789") == string::npos) {
+            if (line.size() > 9) {
+                cout << "[warning] 布局文件第 " << lineNo << " 行：无效的盘块号 " << line << endl;
+                continue;
+            }
+
+            int blockIdx = stoi(line);
+            if (owners == nullptr) {
+                owners = new BlockOwnerMap(MachineProps::diskBlocks());
+                owners->build(adapter);
+                ownersBuilt = true;
+            }
+
+            if (blockIdx >= MachineProps::diskBlocks() || owners->get(blockIdx).ino == 0) {
+                cout << "[warning] 布局文件第 " << lineNo << " 行：盘块 " << line << " 不属于任何文件。" << endl;
+                continue;
+            }
+
+            line = adapter.pathOfInode(owners->get(blockIdx).ino);
+            if (line.empty()) {
+                cout << "[warning] 布局文件第 " << lineNo << " 行：盘块 " << blockIdx << " 所属的文件不可达。" << endl;
+                continue;
+            }
+        }
+
+        // 路径：各级目录依次加入。
+        int currIno = adapter.ROOT_INODE_IDX;
+        order.push_back(currIno);
+
+        stringstream segments(line);
+        string seg;
+        while (getline(segments, seg, '/')) {
+            if (seg.empty() || seg == ".") {
+                continue;
+            }
+
+            if (adapter.inodes[currIno].file_type != Inode::FileType::DIR) {
+                currIno = -1;
+                break;
+            }
+
+            int nextIno = adapter.lookupEntry(currIno, seg);
+            if (nextIno <= 0 || nextIno >= inodeCount) {
+                currIno = -1;
+                break;
+            }
+
+            currIno = nextIno;
+            order.push_back(currIno);
+        }
+
+        if (currIno < 0) {
+            cout << "[warning] 布局文件第 " << lineNo << " 行：找不到 " << line << endl;
+        }
+    }
+
+    if (ownersBuilt) {
+        delete owners;
+    }
+
+    return true;
+}
+
+FragmentationReport Defragmenter::measure() {
+    FragmentationReport report;
+    if (zone.empty() && !loadDataZone()) {
+        return report;
+    }
+
+    vector<uint32_t> blocks;
+    for (int ino = 1; ino < sizeof(adapter.inodes) / sizeof(Inode); ino++) {
+        if (!collectFileBlocks(adapter.inodes[ino], blocks) || blocks.empty()) {
+            continue;
+        }
+
+        int extents = 1;
+        for (int idx = 1; idx < blocks.size(); idx++) {
+            extents += blocks[idx] != blocks[idx - 1] + 1;
+        }
+
+        report.files++;
+        report.blocks += blocks.size();
+        report.extents += extents;
+        report.fragmentedFiles += extents > 1;
+    }
+
+    return report;
+}
+
+vector<uint32_t> Defragmenter::readOrder() {
+    vector<uint32_t> order;
+    if (zone.empty() && !loadDataZone()) {
+        return order;
+    }
+
+    vector<uint32_t> blocks;
+    for (int ino : treeOrder()) {
+        if (collectFileBlocks(adapter.inodes[ino], blocks)) {
+            order.insert(order.end(), blocks.begin(), blocks.end());
+        }
+    }
+
+    return order;
+}
+
+void Defragmenter::printReport(const char* title, const FragmentationReport& report) {
+    cout << "[info] " << title << "：文件 " << report.files 
+        << "，盘块 " << report.blocks 
+        << "，区段 " << report.extents 
+        << "，不连续的文件 " << report.fragmentedFiles 
+        << "，碎片率 " << fixed << setprecision(2) << report.fragmentation() * 100 << "%" 
+        << defaultfloat << endl;
+}
+
+bool Defragmenter::run(const vector<int>& preferredOrder) {
+    if (!loadDataZone()) {
+        return false;
+    }
+
+    adapter.metadataDirty = true;
+
+    printReport("整理前", measure());
+
+    // 排列顺序：优先列表在前，其余按目录树层序。
+    int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    vector<bool> ordered(inodeCount, false);
+    vector<int> order;
+    for (int ino : preferredOrder) {
+        if (ino > 0 && ino < inodeCount && !ordered[ino] && adapter.inodes[ino].ialloc) {
+            ordered[ino] = true;
+            order.push_back(ino);
+        }
+    }
+
+    for (int ino : treeOrder()) {
+        if (!ordered[ino]) {
+            ordered[ino] = true;
+            order.push_back(ino);
+        }
+    }
+
+    // 规划新位置。
+    vector<uint32_t> remap(MachineProps::diskBlocks(), 0);
+    vector<pair<uint32_t, uint32_t>> moves; // 旧盘块号，新盘块号。
+    uint32_t nextBlockIdx = dataZoneBegin;
+    vector<uint32_t> blocks;
+
+    for (int ino : order) {
+        if (!collectFileBlocks(adapter.inodes[ino], blocks)) {
+            cout << "[error] inode " << ino << " 的索引有误，放弃整理。请先执行 fsck。" << endl;
+            return false;
+        }
+
+        for (uint32_t blockIdx : blocks) {
+            if (remap[blockIdx] != 0) {
+                cout << "[error] 盘块 " << blockIdx << " 被重复分配，放弃整理。请先执行 fsck。" << endl;
+                return false;
+            }
+
+            remap[blockIdx] = nextBlockIdx;
+            if (blockIdx != nextBlockIdx) {
+                moves.push_back({ blockIdx, nextBlockIdx });
+            }
+
+            nextBlockIdx++;
+        }
+    }
+
+    // 在内存中搬移，并改写索引。
+    newZone = zone;
+    for (const auto& [oldIdx, newIdx] : moves) {
+        memcpy(blockInZone(newZone, newIdx), blockInZone(zone, oldIdx), sizeof(Block));
+    }
+
+    // 有布局要求时，inode 也按同样的顺序重新编号。
+    vector<int> newIno;
+    if (!preferredOrder.empty()) {
+        newIno = planInodeNumbers(order, remap);
+    }
+
+    for (int ino : order) {
+        remapFileIndexes(adapter.inodes[ino], remap);
+    }
+
+    if (!newIno.empty()) {
+        applyInodeNumbers(newIno);
+    }
+
+    // 只把有变化的区段顺序写回。
+    int zoneBlocks = dataZoneEnd - dataZoneBegin;
+    int blocksWritten = 0;
+    int idx = 0;
+    while (idx < zoneBlocks) {
+        auto changed = [&] (int i) {
+            return !Block::isEqual(
+                newZone.data() + 1LL * i * sizeof(Block), 
+                zone.data() + 1LL * i * sizeof(Block), 
+                sizeof(Block)
+            );
+        };
+
+        if (!changed(idx)) {
+            idx++;
+            continue;
+        }
+
+        int runBegin = idx;
+        while (idx < zoneBlocks && idx - runBegin < EXTENT_BLOCKS_MAX && changed(idx)) {
+            idx++;
+        }
+
+        adapter.writeBlocks(newZone.data() + 1LL * runBegin * sizeof(Block), dataZoneBegin + runBegin, idx - runBegin);
+        blocksWritten += idx - runBegin;
+    }
+
+    // 按升序重建空闲盘块链与空闲 inode 表。
+    adapter.tidyFreeLists();
+
+    if (adapter.ownerMap != nullptr) {
+        adapter.ownerMap->build(adapter);
+    }
+
+    adapter.sync();
+
+    // 空闲链的链接块只落在空闲区，不影响文件盘块，直接用新的数据区统计。
+    zone.swap(newZone);
+    newZone.clear();
+    printReport("整理后", measure());
+    cout << "[info] 搬移盘块：" << moves.size() << "，写入盘块：" << blocksWritten << endl;
+
+    return true;
+}
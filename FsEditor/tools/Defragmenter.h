@@ -0,0 +1,130 @@
+/*
+ * 碎片整理。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include "../FileSystemAdapter.h"
+
+/**
+ * 碎片统计。
+ */
+class FragmentationReport {
+public:
+    /** 文件数（含目录）。 */
+    int files = 0;
+
+    /** 文件占用的盘块数（含索引块）。 */
+    int blocks = 0;
+
+    /** 按读取顺序，盘块号连续的区段总数。 */
+    int extents = 0;
+
+    /** 区段数大于 1 的文件数。 */
+    int fragmentedFiles = 0;
+
+    /** 碎片率：多出来的区段数占盘块数的比例。0 表示所有文件都完全连续。 */
+    inline double fragmentation() const {
+        return blocks == 0 ? 0 : double(extents - files) / blocks;
+    }
+};
+
+/**
+ * 碎片整理器。
+ * 
+ * 按文件依次规划新的连续位置：每个文件的盘块按读取顺序排列，索引块紧挨在它索引的数据块之前。
+ * 整个数据区按大块顺序读入内存，在内存中完成搬移与索引改写，再只把有变化的区段顺序写回。
+ * 最后按升序重建空闲盘块链，使之后的分配也是连续的。
+ */
+class Defragmenter {
+public:
+    Defragmenter(FileSystemAdapter& adapter);
+
+    /**
+     * 统计当前的碎片情况。
+     */
+    FragmentationReport measure();
+
+    /**
+     * 执行碎片整理。
+     * 
+     * @param preferredOrder 优先排列的 inode 号，按给出的顺序放在数据区最前面。
+     *                       其余文件按目录树的层序排在后面（目录在前，其中的文件紧随其后）。
+     *                       非空时，inode 也按同样的顺序重新编号，使 inode 区同样连续。
+     * @return 是否成功。索引损坏时不会做任何修改。
+     */
+    bool run(const std::vector<int>& preferredOrder = {});
+
+    /**
+     * 读取布局文件，得到优先排列的 inode 顺序。
+     * 
+     * 布局文件每行一项：以 / 开头的路径，或一个盘块号（归为所属的文件）。
+     * 空行与 # 开头的行忽略。路径上的各级目录排在文件之前。
+     * 
+     * @return 是否成功打开文件。无法解析的行只给出警告。
+     */
+    bool loadProfile(const std::string& profilePath, std::vector<int>& order);
+
+    /**
+     * 按目录树层序依次完整读取所有文件时，访问到的盘块序列（含索引块，不含空洞）。
+     */
+    std::vector<uint32_t> readOrder();
+
+    /** 输出碎片统计。 */
+    static void printReport(const char* title, const FragmentationReport& report);
+
+private:
+    /** 读入整个数据区。 */
+    bool loadDataZone();
+
+    /** 数据区缓存中某个盘块的起始位置。 */
+    inline char* blockInZone(std::vector<char>& zone, uint32_t blockIdx) {
+        return zone.data() + 1LL * (blockIdx - dataZoneBegin) * sizeof(Block);
+    }
+
+    inline bool inDataZone(uint32_t blockIdx) const {
+        return blockIdx >= dataZoneBegin && blockIdx < dataZoneEnd;
+    }
+
+    /**
+     * 按读取顺序列出一个文件的所有盘块（含索引块，不含空洞）。
+     * 
+     * @param dataBlocksOnly 只列出数据块。
+     * @return 索引是否有效。
+     */
+    bool collectFileBlocks(Inode& inode, std::vector<uint32_t>& blocks, bool dataBlocksOnly = false);
+
+    /**
+     * 改写一个文件的索引：inode 内的索引与索引块中的条目都换成新盘块号。
+     * 索引块已经位于 newZone 中的新位置。超出文件大小的条目清零。
+     */
+    void remapFileIndexes(Inode& inode, const std::vector<uint32_t>& remap);
+
+    /** 目录树层序下的 inode 顺序。不可达的已分配 inode 排在最后。 */
+    std::vector<int> treeOrder();
+
+    /**
+     * 按 order 给已分配的 inode 重新编号（根目录保持不变），并改写 newZone 中的目录项。
+     * 需在改写索引之前调用：目录的数据块按旧索引查找，再经 remap 定位到新位置。
+     * 
+     * @return 新旧编号对照，下标为旧编号。
+     */
+    std::vector<int> planInodeNumbers(const std::vector<int>& order, const std::vector<uint32_t>& remap);
+
+    /** 按新编号重排 inode 表，并修正当前路径。 */
+    void applyInodeNumbers(const std::vector<int>& newIno);
+
+private:
+    FileSystemAdapter& adapter;
+    uint32_t dataZoneBegin;
+    uint32_t dataZoneEnd;
+
+    /** 数据区缓存。 */
+    std::vector<char> zone;
+    std::vector<char> newZone;
+};
@@ -0,0 +1,403 @@
+/*
+ * 文件系统一致性检查（fsck）。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+#include <shared_mutex>
+#include "./MachineProps.h"
+#include "./FileSystemAdapter.h"
+#include "./structures/Block.h"
+#include "./structures/Inode.h"
+#include "./structures/InodeDirectory.h"
+#include "./tools/Fsck.h"
+
+using namespace std;
+
+/** 每个索引块的条目数。 */
+static const int ENTRIES_PER_IDX_BLOCK = sizeof(Block) / sizeof(uint32_t);
+
+Fsck::Fsck(FileSystemAdapter& adapter, int threadCount) : adapter(adapter) {
+    if (threadCount <= 0) {
+        threadCount = max(1U, thread::hardware_concurrency());
+    }
+
+    this->threadCount = threadCount;
+    this->inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+}
+
+template<typename Worker>
+void Fsck::parallelFor(int total, Worker worker) {
+    const int chunk = 64;
+    atomic<int> next(0);
+
+    auto loop = [&] () {
+        int begin;
+        while ((begin = next.fetch_add(chunk)) < total) {
+            int end = min(total, begin + chunk);
+            for (int idx = begin; idx < end; idx++) {
+                worker(idx);
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threadCount; t++) {
+        workers.emplace_back(loop);
+    }
+
+    loop(); // 当前线程也参与。
+
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void Fsck::report(bool isError, int ino, const string& msg) {
+    lock_guard<mutex> lock(reportMutex);
+
+    if (isError) {
+        errorCount++;
+    } else {
+        warningCount++;
+    }
+
+    if (reportedLines++ < REPORT_LINES_MAX) {
+        cout << (isError ? "[error] " : "[warning] ");
+        if (ino >= 0) {
+            cout << "inode " << ino << ": ";
+        }
+
+        cout << msg << endl;
+    }
+}
+
+bool Fsck::readBlock(Block& block, int blockIdx) {
+    return adapter.readBlock(block, blockIdx);
+}
+
+bool Fsck::claimBlock(int ino, uint32_t blockIdx, const char* role) {
+    if (blockIdx == 0) {
+        return false; // 空洞。
+    }
+
+    const SuperBlock& sb = adapter.superBlock;
+    if (blockIdx < sb.data_zone_begin || blockIdx >= sb.data_zone_begin + sb.data_zone_blocks) {
+        report(true, ino, string(role) + " 盘块号越界：" + to_string(blockIdx));
+        return false;
+    }
+
+    uint64_t mask = 1ULL << (blockIdx % 64);
+    uint64_t prev = usedBitmap[blockIdx / 64].fetch_or(mask, memory_order_relaxed);
+    if (prev & mask) {
+        report(true, ino, string(role) + " 盘块重复分配：" + to_string(blockIdx));
+    }
+
+    return true;
+}
+
+void Fsck::checkInodeBlocks(int ino) {
+    Inode& inode = adapter.inodes[ino];
+    if (!inode.ialloc) {
+        return;
+    }
+
+    bool sane = true;
+    long long size = inode.d_size;
+    if (size > adapter.FS_FILE_SIZE_MAX) {
+        report(true, ino, "文件大小超出上限：" + to_string(size));
+        size = adapter.FS_FILE_SIZE_MAX;
+        sane = false;
+    }
+
+    if (inode.ilarg != (size > 6 * (long long) sizeof(Block))) {
+        report(false, ino, "ilarg 标志与文件大小不符。");
+    }
+
+    int blocksRemaining = (size + sizeof(Block) - 1) / sizeof(Block);
+
+    auto claimData = [&] (uint32_t blockIdx) {
+        if (blockIdx != 0 && !claimBlock(ino, blockIdx, "数据块")) {
+            sane = false;
+        }
+    };
+
+    // 直接索引。
+    for (int idx = 0; idx < 6 && blocksRemaining > 0; idx++, blocksRemaining--) {
+        claimData(inode.direct_index[idx]);
+    }
+
+    // 一级索引。
+    Block firstIdxBlock;
+    for (int k = 0; k < 2 && blocksRemaining > 0; k++) {
+        int count = min(ENTRIES_PER_IDX_BLOCK, blocksRemaining);
+        uint32_t idxBlockIdx = inode.indirect_index[k];
+
+        if (claimBlock(ino, idxBlockIdx, "一级索引块") && readBlock(firstIdxBlock, idxBlockIdx)) {
+            const uint32_t* entries = (const uint32_t*) firstIdxBlock.bytes;
+            for (int idx = 0; idx < count; idx++) {
+                claimData(entries[idx]);
+            }
+        } else if (idxBlockIdx != 0) {
+            sane = false;
+        }
+
+        blocksRemaining -= count;
+    }
+
+    // 二级索引。
+    Block secondIdxBlock;
+    for (int k = 0; k < 2 && blocksRemaining > 0; k++) {
+        uint32_t secIdxBlockIdx = inode.secondary_indirect_index[k];
+        bool secValid = claimBlock(ino, secIdxBlockIdx, "二级索引块") 
+            && readBlock(secondIdxBlock, secIdxBlockIdx);
+        if (!secValid && secIdxBlockIdx != 0) {
+            sane = false;
+        }
+
+        const uint32_t* firEntries = (const uint32_t*) secondIdxBlock.bytes;
+        for (int fir = 0; fir < ENTRIES_PER_IDX_BLOCK && blocksRemaining > 0; fir++) {
+            int count = min(ENTRIES_PER_IDX_BLOCK, blocksRemaining);
+
+            if (secValid) {
+                uint32_t idxBlockIdx = firEntries[fir];
+                if (claimBlock(ino, idxBlockIdx, "一级索引块") && readBlock(firstIdxBlock, idxBlockIdx)) {
+                    const uint32_t* entries = (const uint32_t*) firstIdxBlock.bytes;
+                    for (int idx = 0; idx < count; idx++) {
+                        claimData(entries[idx]);
+                    }
+                } else if (idxBlockIdx != 0) {
+                    sane = false;
+                }
+            }
+
+            blocksRemaining -= count;
+        }
+    }
+
+    inodeSane[ino] = sane;
+}
+
+void Fsck::checkFreeLists() {
+    const SuperBlock& sb = adapter.superBlock;
+    int diskBlocks = MachineProps::diskBlocks();
+    freeBlocks.assign(diskBlocks, false);
+
+    auto registerFree = [&] (uint32_t blockIdx) {
+        if (blockIdx < sb.data_zone_begin || blockIdx >= sb.data_zone_begin + sb.data_zone_blocks) {
+            report(true, -1, "空闲盘块号越界：" + to_string(blockIdx));
+            return false;
+        }
+
+        if (freeBlocks[blockIdx]) {
+            report(true, -1, "空闲盘块重复登记（或空闲链成环）：" + to_string(blockIdx));
+            return false;
+        }
+
+        freeBlocks[blockIdx] = true;
+        if (usedBitmap[blockIdx / 64].load(memory_order_relaxed) & (1ULL << (blockIdx % 64))) {
+            report(true, -1, "盘块既在空闲表中，又被文件占用：" + to_string(blockIdx));
+        }
+
+        return true;
+    };
+
+    // s_free 栈与空闲盘块链。s_free[0] 为下一个链接块（0 表示链尾），链接块本身也是空闲盘块。
+    uint32_t nfree = sb.s_nfree;
+    uint32_t freeEntries[100];
+    memcpy(freeEntries, (const char*) &sb + offsetof(SuperBlock, s_free), sizeof(freeEntries));
+    Block chainBlock;
+
+    while (true) {
+        if (nfree > 100) {
+            report(true, -1, "空闲盘块表长度异常：" + to_string(nfree));
+            break;
+        }
+
+        for (uint32_t idx = 1; idx < nfree; idx++) {
+            registerFree(freeEntries[idx]);
+        }
+
+        uint32_t next = nfree > 0 ? freeEntries[0] : 0;
+        if (next == 0 || !registerFree(next)) {
+            break;
+        }
+
+        adapter.readBlock(chainBlock, next);
+        memcpy(&nfree, chainBlock.bytes, sizeof(uint32_t));
+        memcpy(freeEntries, chainBlock.bytes + sizeof(uint32_t), sizeof(freeEntries));
+    }
+
+    // s_inode 中登记的 inode 需要是空闲的。
+    if (sb.s_ninode > 100) {
+        report(true, -1, "空闲 inode 表长度异常：" + to_string(sb.s_ninode));
+    } else {
+        for (uint32_t idx = 0; idx < sb.s_ninode; idx++) {
+            uint32_t ino = sb.s_inode[idx];
+            if (ino >= inodeCount || ino <= adapter.ROOT_INODE_IDX) {
+                report(true, -1, "空闲 inode 号越界：" + to_string(ino));
+            } else if (adapter.inodes[ino].ialloc) {
+                report(true, ino, "登记在空闲 inode 表中，但已被分配。");
+            }
+        }
+    }
+}
+
+void Fsck::checkDirectoryTree() {
+    vector<int> frontier = { adapter.ROOT_INODE_IDX };
+    dirVisited[adapter.ROOT_INODE_IDX] = true;
+
+    if (adapter.inodes[adapter.ROOT_INODE_IDX].file_type != Inode::FileType::DIR 
+        || !adapter.inodes[adapter.ROOT_INODE_IDX].ialloc
+    ) {
+        report(true, adapter.ROOT_INODE_IDX, "根目录不是已分配的目录。");
+        return;
+    }
+
+    // 按层并行：每一层的目录分给各线程读取，下一层的目录汇总后继续。
+    while (!frontier.empty()) {
+        vector<vector<int>> nextPerDir(frontier.size());
+
+        parallelFor(frontier.size(), [&] (int frontierIdx) {
+            int dirIno = frontier[frontierIdx];
+            Inode& dirInode = adapter.inodes[dirIno];
+            if (!inodeSane[dirIno]) {
+                report(false, dirIno, "目录索引有误，跳过其内容。");
+                return;
+            }
+
+            if (dirInode.d_size % sizeof(DirectoryEntry) != 0) {
+                report(false, dirIno, "目录大小不是目录项大小的整数倍。");
+            }
+
+            int length = dirInode.d_size / sizeof(DirectoryEntry);
+            int bufferBlocks = (dirInode.d_size + sizeof(Block) - 1) / sizeof(Block);
+            vector<DirectoryEntry> entries(bufferBlocks * sizeof(Block) / sizeof(DirectoryEntry));
+
+            {
+                shared_lock<shared_mutex> lock(adapter.inodeLock(dirIno));
+                adapter.readFile((char*) entries.data(), dirInode);
+            }
+
+            for (int idx = 0; idx < length; idx++) {
+                const DirectoryEntry& entry = entries[idx];
+                string name(entry.m_name, strnlen(entry.m_name, DirectoryEntry::DIRSIZE));
+
+                if (entry.m_ino == 0 && name.empty()) {
+                    continue; // 空目录项。
+                }
+
+                if (entry.m_ino >= inodeCount || entry.m_ino == 0) {
+                    report(true, dirIno, "目录项 " + name + " 的 inode 号越界：" + to_string(entry.m_ino));
+                    continue;
+                }
+
+                if (!adapter.inodes[entry.m_ino].ialloc) {
+                    report(true, dirIno, "目录项 " + name + " 指向未分配的 inode " + to_string(entry.m_ino));
+                    continue;
+                }
+
+                refCount[entry.m_ino]++;
+
+                if (name == "." || name == "..") {
+                    continue;
+                }
+
+                if (adapter.inodes[entry.m_ino].file_type == Inode::FileType::DIR) {
+                    if (dirVisited[entry.m_ino].exchange(true)) {
+                        report(true, entry.m_ino, "目录被多个目录项引用：" + name);
+                    } else {
+                        nextPerDir[frontierIdx].push_back(entry.m_ino);
+                    }
+                }
+            }
+        });
+
+        frontier.clear();
+        for (const auto& next : nextPerDir) {
+            frontier.insert(frontier.end(), next.begin(), next.end());
+        }
+    }
+}
+
+void Fsck::checkLinkCounts() {
+    for (int ino = 1; ino < inodeCount; ino++) {
+        Inode& inode = adapter.inodes[ino];
+        if (!inode.ialloc) {
+            continue;
+        }
+
+        int refs = refCount[ino];
+
+        // 本工具创建的目录不含 . 与 ..，根目录的 d_nlink 为 1。
+        int expected = ino == adapter.ROOT_INODE_IDX ? max(refs, 1) : refs;
+
+        if (refs == 0 && ino != adapter.ROOT_INODE_IDX) {
+            report(false, ino, "已分配，但不能从根目录到达。");
+        } else if (inode.d_nlink != expected) {
+            report(false, ino, "d_nlink 为 " + to_string(inode.d_nlink) 
+                + "，目录项引用数为 " + to_string(expected) + "。");
+        }
+    }
+
+    // 泄漏的盘块。
+    const SuperBlock& sb = adapter.superBlock;
+    int leaked = 0;
+    for (uint32_t blockIdx = sb.data_zone_begin; blockIdx < sb.data_zone_begin + sb.data_zone_blocks; blockIdx++) {
+        bool used = usedBitmap[blockIdx / 64].load(memory_order_relaxed) & (1ULL << (blockIdx % 64));
+        if (!used && !freeBlocks[blockIdx]) {
+            leaked++;
+        }
+    }
+
+    if (leaked > 0) {
+        report(false, -1, "既不属于文件、也不在空闲表中的盘块数：" + to_string(leaked));
+    }
+}
+
+int Fsck::run() {
+    auto beginTime = chrono::steady_clock::now();
+    int diskBlocks = MachineProps::diskBlocks();
+
+    usedBitmap.reset(new atomic<uint64_t>[(diskBlocks + 63) / 64]());
+    refCount.reset(new atomic<int>[inodeCount]());
+    dirVisited.reset(new atomic<bool>[inodeCount]());
+    inodeSane.assign(inodeCount, false);
+    errorCount = warningCount = reportedLines = 0;
+
+    const SuperBlock& sb = adapter.superBlock;
+    if (sb.data_zone_begin + sb.data_zone_blocks > diskBlocks || sb.inode_zone_blocks > MachineProps::INODE_ZONE_BLOCKS) {
+        report(true, -1, "SuperBlock 中的分区信息与磁盘不符。");
+        return errorCount;
+    }
+
+    // 1. 并行扫描 inode。
+    parallelFor(inodeCount, [&] (int ino) {
+        checkInodeBlocks(ino);
+    });
+
+    // 2. 空闲表。
+    checkFreeLists();
+
+    // 3. 目录树。
+    checkDirectoryTree();
+
+    // 4. 引用数与泄漏。
+    checkLinkCounts();
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - beginTime);
+
+    if (reportedLines > REPORT_LINES_MAX) {
+        cout << "[info] 另有 " << reportedLines - REPORT_LINES_MAX << " 条问题未列出。" << endl;
+    }
+
+    cout << "[info] fsck 完成：错误 " << errorCount << "，警告 " << warningCount 
+        << "，线程 " << threadCount << "，耗时 " << elapsed.count() << " ms。" << endl;
+
+    return errorCount;
+}
@@ -0,0 +1,104 @@
+/*
+ * 文件系统一致性检查（fsck）。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "../FileSystemAdapter.h"
+
+/**
+ * 多线程一致性检查器。
+ * 
+ * 检查内容：
+ *   1. 并行扫描 inode 表，遍历每个文件的直接、一级、二级索引，检查盘块号越界；
+ *      用原子的测试并置位操作维护共享的盘块归属位图，发现重复分配。
+ *   2. 遍历 s_free 栈与空闲盘块链，检查空闲盘块越界、重复登记，或同时被文件占用；
+ *      检查 s_inode 中登记的 inode 确实空闲。
+ *   3. 从根目录出发按层并行遍历目录树，检查目录项指向的 inode、不可达的 inode，
+ *      以及 d_nlink 与目录项引用数是否一致。
+ *   4. 统计既不属于文件、也不在空闲表中的数据区盘块（泄漏）。
+ * 
+ * 检查只读取数据，不修改映像。
+ */
+class Fsck {
+public:
+    /**
+     * @param adapter 已加载的文件系统。
+     * @param threadCount 工作线程数。0 表示使用硬件线程数。
+     */
+    Fsck(FileSystemAdapter& adapter, int threadCount = 0);
+
+    /**
+     * 执行检查，并输出报告。
+     * 
+     * @return 错误数。0 表示映像一致（可能仍有警告）。
+     */
+    int run();
+
+public:
+    int errorCount = 0;
+    int warningCount = 0;
+
+private:
+    /** 检查一个 inode 的所有盘块，并在归属位图中登记。 */
+    void checkInodeBlocks(int ino);
+
+    /** 检查空闲盘块表和空闲 inode 表。 */
+    void checkFreeLists();
+
+    /** 遍历目录树，统计引用数。 */
+    void checkDirectoryTree();
+
+    /** 检查可达性与 d_nlink，统计泄漏的盘块。 */
+    void checkLinkCounts();
+
+    /**
+     * 在归属位图中登记盘块。
+     * 
+     * @return 盘块号是否有效（非空洞且在数据区内）。
+     */
+    bool claimBlock(int ino, uint32_t blockIdx, const char* role);
+
+    /** 读取盘块。适配器使用 pread，多个线程可以同时读取。 */
+    bool readBlock(Block& block, int blockIdx);
+
+    /** 在 [0, total) 上并行执行 worker，每个线程按块领取任务。 */
+    template<typename Worker>
+    void parallelFor(int total, Worker worker);
+
+    void report(bool isError, int ino, const std::string& msg);
+
+private:
+    FileSystemAdapter& adapter;
+    int threadCount;
+    int inodeCount;
+
+    /** 被文件占用的盘块位图。 */
+    std::unique_ptr<std::atomic<uint64_t>[]> usedBitmap;
+
+    /** 空闲表中登记的盘块。 */
+    std::vector<bool> freeBlocks;
+
+    /** inode 的盘块索引是否全部有效。只有有效的目录才会被读取。 */
+    std::vector<char> inodeSane;
+
+    /** 每个 inode 被目录项引用的次数。 */
+    std::unique_ptr<std::atomic<int>[]> refCount;
+
+    /** 目录是否已被遍历。 */
+    std::unique_ptr<std::atomic<bool>[]> dirVisited;
+
+    std::mutex reportMutex;
+
+    /** 最多输出的问题条数。超出的只计数。 */
+    static const int REPORT_LINES_MAX = 200;
+    int reportedLines = 0;
+};
@@ -0,0 +1,452 @@
+/*
+ * 映像文件工具：稀疏克隆与导出，盘块级差分与合并。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "./MachineProps.h"
+#include "./FileSystemAdapter.h"
+#include "./structures/Block.h"
+#include "./tools/ImageTools.h"
+
+#ifdef V6PP_WITH_ZLIB
+    #include <zlib.h>
+#endif
+
+using namespace std;
+
+/** 单次读写的最大盘块数。 */
+static const int EXTENT_BLOCKS_MAX = 2048;
+
+/**
+ * 遍历在用盘块组成的连续区段。
+ * 
+ * @param live 盘块在用表。
+ * @param extentHandler 对每个区段调用。返回 false 会终止遍历。
+ * @return 是否完整遍历。
+ */
+template<typename Handler>
+static bool forEachLiveExtent(const vector<bool>& live, Handler extentHandler) {
+    int blockCount = live.size();
+    int idx = 0;
+    while (idx < blockCount) {
+        if (!live[idx]) {
+            idx++;
+            continue;
+        }
+
+        int extentBegin = idx;
+        while (idx < blockCount && live[idx] && idx - extentBegin < EXTENT_BLOCKS_MAX) {
+            idx++;
+        }
+
+        if (!extentHandler(extentBegin, idx - extentBegin)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#ifdef V6PP_WITH_ZLIB
+
+/**
+ * 输出 gzip 压缩流。空闲盘块输出为 0，解压后得到完整映像。
+ */
+static bool exportCompressed(
+    FileSystemAdapter& adapter, const vector<bool>& live, const string& outPath
+) {
+    gzFile gz = outPath == "-" ? gzdopen(fileno(stdout), "wb") : gzopen(outPath.c_str(), "wb");
+    if (gz == nullptr) {
+        return false;
+    }
+
+    vector<char> buffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+    const vector<char> zeros(EXTENT_BLOCKS_MAX * sizeof(Block), 0);
+    int nextBlockIdx = 0; // 下一个要输出的盘块。
+    bool ok = true;
+
+    auto writeZeros = [&] (int blockCount) {
+        while (ok && blockCount > 0) {
+            int n = min(blockCount, EXTENT_BLOCKS_MAX);
+            ok = gzwrite(gz, zeros.data(), n * sizeof(Block)) == n * (int) sizeof(Block);
+            blockCount -= n;
+        }
+    };
+
+    forEachLiveExtent(live, [&] (int blockIdx, int blockCount) {
+        writeZeros(blockIdx - nextBlockIdx);
+        ok = ok && adapter.readBlocks(buffer.data(), blockIdx, blockCount);
+        ok = ok && gzwrite(gz, buffer.data(), blockCount * sizeof(Block)) 
+            == blockCount * (int) sizeof(Block);
+        nextBlockIdx = blockIdx + blockCount;
+        return ok;
+    });
+
+    writeZeros(live.size() - nextBlockIdx);
+
+    return gzclose(gz) == Z_OK && ok;
+}
+
+#endif
+
+bool ImageTools::exportImage(FileSystemAdapter& adapter, const string& outPath, bool quiet) {
+    // 输出到源映像自身会先把它截断，读到的全是空洞。
+    error_code ec;
+    if (outPath != "-" && filesystem::equivalent(outPath, adapter.imagePath(), ec)) {
+        cout << "[error] 输出文件就是源映像：" << outPath << endl;
+        return false;
+    }
+
+    adapter.sync(); // 保证盘上的 superblock 和 inode 区是最新的。
+
+    vector<bool> live;
+    int liveBlocks = adapter.markLiveBlocks(live);
+
+    bool compressed = outPath == "-" 
+        || (outPath.length() > 3 && outPath.substr(outPath.length() - 3) == ".gz");
+
+    bool ok;
+
+    if (compressed) {
+#ifdef V6PP_WITH_ZLIB
+        ok = exportCompressed(adapter, live, outPath);
+#else
+        cout << "[error] 编译时未启用 zlib，不支持压缩输出。" << endl;
+        return false;
+#endif
+    } else {
+        // 先截断为空文件，再扩展到映像大小。扩展出的部分在支持稀疏文件的文件系统上是空洞。
+        {
+            ofstream f(outPath, ios::out | ios::binary | ios::trunc);
+            if (!f.is_open()) {
+                cout << "[error] 无法打开：" << outPath << endl;
+                return false;
+            }
+        }
+
+        filesystem::resize_file(outPath, MachineProps::diskSize());
+
+        fstream f(outPath, ios::in | ios::out | ios::binary);
+        vector<char> buffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+
+        ok = forEachLiveExtent(live, [&] (int blockIdx, int blockCount) {
+            if (!adapter.readBlocks(buffer.data(), blockIdx, blockCount)) {
+                return false;
+            }
+
+            // 全零的盘块也不写，留作空洞。
+            int idx = 0;
+            while (idx < blockCount) {
+                if (Block::isZero(buffer.data() + idx * sizeof(Block), sizeof(Block))) {
+                    idx++;
+                    continue;
+                }
+
+                int runBegin = idx;
+                while (idx < blockCount 
+                    && !Block::isZero(buffer.data() + idx * sizeof(Block), sizeof(Block))
+                ) {
+                    idx++;
+                }
+
+                f.seekp(1LL * (blockIdx + runBegin) * sizeof(Block), ios::beg);
+                f.write(buffer.data() + runBegin * sizeof(Block), (idx - runBegin) * sizeof(Block));
+            }
+
+            return f.good();
+        });
+    }
+
+    if (!quiet) {
+        cout << "[info] 在用盘块：" << liveBlocks << " / " << live.size() << endl;
+        cout << "[info] 导出" << (ok ? "完成：" : "失败：") << outPath << endl;
+    }
+
+    return ok;
+}
+
+/**
+ * 比较 [beginBlock, endBlock) 范围内的盘块，把有变化的盘块号按顺序放进 changed。
+ */
+static bool diffBlockRange(
+    const string& basePath, const string& newPath, 
+    int beginBlock, int endBlock, 
+    vector<int>& changed
+) {
+    ifstream baseFile(basePath, ios::in | ios::binary);
+    ifstream newFile(newPath, ios::in | ios::binary);
+    if (!baseFile.is_open() || !newFile.is_open()) {
+        return false;
+    }
+
+    vector<char> baseBuffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+    vector<char> newBuffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+
+    baseFile.seekg(1LL * beginBlock * sizeof(Block), ios::beg);
+    newFile.seekg(1LL * beginBlock * sizeof(Block), ios::beg);
+
+    for (int chunkBegin = beginBlock; chunkBegin < endBlock; chunkBegin += EXTENT_BLOCKS_MAX) {
+        int chunkBlocks = min(EXTENT_BLOCKS_MAX, endBlock - chunkBegin);
+        int chunkBytes = chunkBlocks * sizeof(Block);
+
+        baseFile.read(baseBuffer.data(), chunkBytes);
+        newFile.read(newBuffer.data(), chunkBytes);
+        if (baseFile.gcount() != chunkBytes || newFile.gcount() != chunkBytes) {
+            return false;
+        }
+
+        for (int idx = 0; idx < chunkBlocks; idx++) {
+            if (!Block::isEqual(
+                baseBuffer.data() + idx * sizeof(Block), 
+                newBuffer.data() + idx * sizeof(Block), 
+                sizeof(Block)
+            )) {
+                changed.push_back(chunkBegin + idx);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * 一段盘块内容的校验值（FNV-1a）。
+ */
+static uint64_t extentChecksum(const char* data, size_t bytes) {
+    uint64_t checksum = 14695981039346656037ULL;
+    const uint8_t* p = (const uint8_t*) data;
+    for (size_t idx = 0; idx < bytes; idx++) {
+        checksum = (checksum ^ p[idx]) * 1099511628211ULL;
+    }
+
+    return checksum;
+}
+
+bool ImageTools::diffImages(const string& basePath, const string& newPath, const string& deltaPath) {
+    error_code ec;
+    unsigned long long baseSize = filesystem::file_size(basePath, ec);
+    unsigned long long newSize = ec ? 0 : filesystem::file_size(newPath, ec);
+    if (ec || baseSize != newSize || baseSize % sizeof(Block) != 0) {
+        cout << "[error] 两个映像需要存在且大小相同。" << endl;
+        return false;
+    }
+
+    int diskBlocks = baseSize / sizeof(Block);
+
+    // 按盘块区间分配给各个线程。每个线程至少分到一个读写区段，避免线程过多。
+    int threadCount = max(1U, thread::hardware_concurrency());
+    threadCount = max(1, min(threadCount, diskBlocks / EXTENT_BLOCKS_MAX));
+    int blocksPerThread = (diskBlocks + threadCount - 1) / threadCount;
+
+    vector<vector<int>> changedPerThread(threadCount);
+    vector<char> threadSucceeded(threadCount, false);
+    vector<thread> workers;
+
+    for (int t = 0; t < threadCount; t++) {
+        workers.emplace_back([&, t] () {
+            int beginBlock = min(diskBlocks, t * blocksPerThread);
+            int endBlock = min(diskBlocks, beginBlock + blocksPerThread);
+            threadSucceeded[t] = diffBlockRange(
+                basePath, newPath, beginBlock, endBlock, changedPerThread[t]
+            );
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (int t = 0; t < threadCount; t++) {
+        if (!threadSucceeded[t]) {
+            cout << "[error] 读取映像失败。" << endl;
+            return false;
+        }
+    }
+
+    // 合并为区段。各线程的区间本身有序，依次拼接即可。
+    vector<pair<int, int>> extents; // 起始盘块号，盘块数。
+    int changedBlocks = 0;
+    for (const auto& changed : changedPerThread) {
+        for (int blockIdx : changed) {
+            changedBlocks++;
+            if (!extents.empty() 
+                && extents.back().first + extents.back().second == blockIdx
+                && extents.back().second < EXTENT_BLOCKS_MAX
+            ) {
+                extents.back().second++;
+            } else {
+                extents.push_back({blockIdx, 1});
+            }
+        }
+    }
+
+    // 写出差分文件。
+    ofstream deltaFile(deltaPath, ios::out | ios::binary | ios::trunc);
+    ifstream baseFile(basePath, ios::in | ios::binary);
+    ifstream newFile(newPath, ios::in | ios::binary);
+    if (!deltaFile.is_open() || !baseFile.is_open() || !newFile.is_open()) {
+        cout << "[error] 无法打开：" << deltaPath << endl;
+        return false;
+    }
+
+    ImageDeltaHeader header;
+    memcpy(header.magic, ImageDeltaHeader::MAGIC, sizeof(header.magic));
+    header.blockSize = sizeof(Block);
+    header.diskBlocks = diskBlocks;
+    header.extentCount = extents.size();
+    header.changedBlocks = changedBlocks;
+    deltaFile.write((const char*) &header, sizeof(header));
+
+    vector<char> buffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+    for (const auto& extent : extents) {
+        uint32_t extentHeader[2] = { (uint32_t) extent.first, (uint32_t) extent.second };
+        int extentBytes = extent.second * sizeof(Block);
+
+        // 记录基准映像中这些盘块的原内容，合并时据此确认映像没有变过。
+        baseFile.seekg(1LL * extent.first * sizeof(Block), ios::beg);
+        baseFile.read(buffer.data(), extentBytes);
+        if (baseFile.gcount() != extentBytes) {
+            cout << "[error] 读取映像失败。" << endl;
+            return false;
+        }
+
+        uint64_t baseChecksum = extentChecksum(buffer.data(), extentBytes);
+
+        newFile.seekg(1LL * extent.first * sizeof(Block), ios::beg);
+        newFile.read(buffer.data(), extentBytes);
+        if (newFile.gcount() != extentBytes) {
+            cout << "[error] 读取映像失败。" << endl;
+            return false;
+        }
+
+        deltaFile.write((const char*) extentHeader, sizeof(extentHeader));
+        deltaFile.write((const char*) &baseChecksum, sizeof(baseChecksum));
+        deltaFile.write(buffer.data(), extentBytes);
+    }
+
+    if (!deltaFile.good()) {
+        cout << "[error] 写入差分文件失败。" << endl;
+        return false;
+    }
+
+    cout << "[info] 变化盘块：" << changedBlocks << " / " << diskBlocks 
+        << "，区段数：" << extents.size() << endl;
+    return true;
+}
+
+bool ImageTools::applyDelta(const string& imgPath, const string& deltaPath) {
+    ifstream deltaFile(deltaPath, ios::in | ios::binary);
+    if (!deltaFile.is_open()) {
+        cout << "[error] 无法打开：" << deltaPath << endl;
+        return false;
+    }
+
+    ImageDeltaHeader header;
+    deltaFile.read((char*) &header, sizeof(header));
+    if (deltaFile.gcount() != sizeof(header)
+        || memcmp(header.magic, ImageDeltaHeader::MAGIC, sizeof(header.magic)) != 0
+        || header.blockSize != sizeof(Block)
+    ) {
+        cout << "[error] 差分文件格式错误。" << endl;
+        return false;
+    }
+
+    error_code ec;
+    unsigned long long imgSize = filesystem::file_size(imgPath, ec);
+    if (ec || imgSize != 1ULL * header.diskBlocks * sizeof(Block)) {
+        cout << "[error] 映像大小与差分文件不符。" << endl;
+        return false;
+    }
+
+    fstream imgFile(imgPath, ios::in | ios::out | ios::binary);
+    if (!imgFile.is_open()) {
+        cout << "[error] 无法打开：" << imgPath << endl;
+        return false;
+    }
+
+    // 第一遍：核对每个区段，记下内容在差分文件中的位置。任何一个区段有问题都不写入。
+    struct Extent {
+        uint32_t blockIdx;
+        uint32_t blockCount;
+        streamoff dataOffset;
+    };
+
+    vector<Extent> extents;
+    vector<char> buffer(EXTENT_BLOCKS_MAX * sizeof(Block));
+    for (uint32_t extentIdx = 0; extentIdx < header.extentCount; extentIdx++) {
+        uint32_t extentHeader[2];
+        uint64_t baseChecksum;
+        deltaFile.read((char*) extentHeader, sizeof(extentHeader));
+        deltaFile.read((char*) &baseChecksum, sizeof(baseChecksum));
+
+        uint32_t blockIdx = extentHeader[0];
+        uint32_t blockCount = extentHeader[1];
+        if (!deltaFile
+            || blockCount > EXTENT_BLOCKS_MAX
+            || (uint64_t) blockIdx + blockCount > header.diskBlocks
+        ) {
+            cout << "[error] 差分文件已损坏（区段 " << extentIdx << "）。" << endl;
+            return false;
+        }
+
+        int extentBytes = blockCount * sizeof(Block);
+        streamoff dataOffset = deltaFile.tellg();
+        deltaFile.seekg(extentBytes, ios::cur);
+
+        imgFile.seekg(1LL * blockIdx * sizeof(Block), ios::beg);
+        imgFile.read(buffer.data(), extentBytes);
+        if (imgFile.gcount() != extentBytes) {
+            cout << "[error] 无法读取：" << imgPath << endl;
+            return false;
+        }
+
+        if (extentChecksum(buffer.data(), extentBytes) != baseChecksum) {
+            cout << "[error] 映像不是生成差分文件时的基准映像（或已合并过），拒绝合并（盘块 "
+                << blockIdx << "）。" << endl;
+            return false;
+        }
+
+        extents.push_back({ blockIdx, blockCount, dataOffset });
+    }
+
+    // 差分文件应当恰好在最后一个区段之后结束。
+    deltaFile.seekg(0, ios::end);
+    if (header.extentCount > 0 && deltaFile.tellg() != extents.back().dataOffset
+        + (streamoff) extents.back().blockCount * sizeof(Block)
+    ) {
+        cout << "[error] 差分文件已损坏（长度不符）。" << endl;
+        return false;
+    }
+
+    // 第二遍：写入。
+    for (const Extent& extent : extents) {
+        int extentBytes = extent.blockCount * sizeof(Block);
+        deltaFile.clear();
+        deltaFile.seekg(extent.dataOffset, ios::beg);
+        deltaFile.read(buffer.data(), extentBytes);
+        if (deltaFile.gcount() != extentBytes) {
+            cout << "[error] 读取差分文件失败。" << endl;
+            return false;
+        }
+
+        imgFile.seekp(1LL * extent.blockIdx * sizeof(Block), ios::beg);
+        imgFile.write(buffer.data(), extentBytes);
+    }
+
+    imgFile.flush();
+    if (!imgFile.good()) {
+        cout << "[error] 写入映像失败。" << endl;
+        return false;
+    }
+
+    cout << "[info] 已合并盘块：" << header.changedBlocks << "，区段数：" << header.extentCount << endl;
+    return true;
+}
@@ -0,0 +1,88 @@
+/*
+ * 映像文件工具：稀疏克隆与导出，盘块级差分与合并。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "../MacroDefines.h"
+#include "../FileSystemAdapter.h"
+
+/**
+ * 差分文件头。
+ */
+class ImageDeltaHeader {
+public:
+    static constexpr char MAGIC[8] = {'V', '6', 'P', 'P', 'D', 'L', 'T', '3'};
+
+public:
+    char magic[8];
+
+    /** 盘块尺寸（字节）。 */
+    uint32_t blockSize;
+
+    /** 映像盘块总数。 */
+    uint32_t diskBlocks;
+
+    /** 区段数。 */
+    uint32_t extentCount;
+
+    /** 变化的盘块总数。 */
+    uint32_t changedBlocks;
+} __packed;
+
+/**
+ * 整个映像文件层面的操作。只处理盘块，不关心文件系统内部的目录结构。
+ */
+class ImageTools {
+public:
+    /**
+     * 将映像中在用的盘块导出到新的映像文件。
+     * 
+     * 输出路径以 .gz 结尾时（需要编译时启用 zlib），输出 gzip 压缩流，解压后即为完整映像；
+     * 输出路径为 "-" 时，gzip 压缩流写到标准输出。
+     * 其他情况下，输出与原映像等大的稀疏文件：只写入在用的盘块，其余部分为空洞。
+     * 
+     * @param adapter 已加载的文件系统。
+     * @param outPath 输出文件路径。不能是源映像本身。
+     * @param quiet 不输出统计信息（向标准输出写压缩流时使用）。
+     * @return 是否成功。
+     */
+    static bool exportImage(FileSystemAdapter& adapter, const std::string& outPath, bool quiet = false);
+
+    /**
+     * 逐盘块比较两个等大的映像文件，将新映像中发生变化的盘块写入差分文件。
+     * 比较过程按盘块区间分给多个线程并行执行。
+     * 
+     * 差分文件格式：ImageDeltaHeader，之后是 extentCount 个区段，
+     * 每个区段为 uint32_t 起始盘块号、uint32_t 盘块数、uint64_t 基准映像中这些盘块原内容的校验值（FNV-1a），
+     * 紧跟新的盘块内容。
+     * 
+     * @param basePath 基准映像。
+     * @param newPath 新映像。
+     * @param deltaPath 输出的差分文件。
+     * @return 是否成功。
+     */
+    static bool diffImages(
+        const std::string& basePath, const std::string& newPath, const std::string& deltaPath
+    );
+
+    /**
+     * 将差分文件原地合并到映像上。
+     * 
+     * 先核对所有区段：区段范围有效，且映像中这些盘块的内容与生成差分时的基准映像一致；
+     * 全部通过后才开始写入。只读取差分涉及的盘块，耗时与变化量成正比。
+     * 
+     * @param imgPath 映像文件。大小需要与生成差分时的基准映像一致。
+     * @param deltaPath 差分文件。
+     * @return 是否成功。
+     */
+    static bool applyDelta(const std::string& imgPath, const std::string& deltaPath);
+
+private:
+    ImageTools() {}
+    ImageTools(const ImageTools&) {}
+};
@@ -0,0 +1,879 @@
+/*
+ * tar 流的导入与导出 - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <mutex>
+#include <shared_mutex>
+#include "./FileSystemAdapter.h"
+#include "./BlockTrace.h"
+#include "./Tracer.h"
+#include "./structures/Block.h"
+#include "./structures/InodeDirectory.h"
+#include "./structures/DirectoryView.h"
+#include "./tools/TarArchive.h"
+
+using namespace std;
+using namespace std::chrono;
+
+static_assert(sizeof(TarHeader) == 512, "tar 头应为 512 字节。");
+
+/** tar 的记录大小。输出的总长度补齐到它的整数倍。 */
+static const int TAR_RECORD_SIZE = 20 * 512;
+
+/** 扩展头（pax 与 GNU 长名字）的大小上限。扩展头整个读入内存。 */
+static const long long EXTENSION_BYTES_MAX = 1 << 20;
+
+static long long paddedSize(long long size) {
+    return (size + 511) / 512 * 512;
+}
+
+/**
+ * 解析数值字段：八进制文本，或 GNU 的 base-256 编码（首字节最高位为 1）。
+ *
+ * @return 数值。base-256 编码的负数（次高位为 1）或超出 long long 范围时返回 -1。
+ */
+static long long parseNumber(const char* field, int length) {
+    if ((unsigned char) field[0] & 0x80) {
+        if ((unsigned char) field[0] & 0x40) {
+            return -1; // 负数。
+        }
+
+        long long value = (unsigned char) field[0] & 0x3f;
+        for (int idx = 1; idx < length; idx++) {
+            if (value > (LLONG_MAX >> 8)) {
+                return -1;
+            }
+
+            value = value << 8 | (unsigned char) field[idx];
+        }
+
+        return value;
+    }
+
+    long long value = 0;
+    for (int idx = 0; idx < length && field[idx] != '\0'; idx++) {
+        if (field[idx] >= '0' && field[idx] <= '7') {
+            value = value * 8 + field[idx] - '0';
+        }
+    }
+
+    return value;
+}
+
+static string fieldString(const char* field, int length) {
+    return string(field, strnlen(field, length));
+}
+
+static unsigned headerChecksum(const TarHeader& header) {
+    const unsigned char* bytes = (const unsigned char*) &header;
+    unsigned sum = 0;
+    for (int idx = 0; idx < sizeof(TarHeader); idx++) {
+        bool inChksum = idx >= offsetof(TarHeader, chksum) && idx < offsetof(TarHeader, chksum) + 8;
+        sum += inChksum ? ' ' : bytes[idx];
+    }
+
+    return sum;
+}
+
+/**
+ * 拆分成员路径。去掉开头的 / 与 ./，忽略空段与 "."。含有 ".." 时返回 false。
+ */
+static bool splitMemberPath(const string& path, vector<string>& segments) {
+    segments.clear();
+    size_t begin = 0;
+    while (begin <= path.length()) {
+        size_t end = path.find('/', begin);
+        if (end == string::npos) {
+            end = path.length();
+        }
+
+        string seg = path.substr(begin, end - begin);
+        if (seg == "..") {
+            return false;
+        } else if (!seg.empty() && seg != ".") {
+            segments.push_back(seg);
+        }
+
+        begin = end + 1;
+    }
+
+    return true;
+}
+
+/* ------------ 导入。 ------------ */
+
+/**
+ * 导入过程的状态。
+ */
+struct TarImport {
+    FileSystemAdapter& adapter;
+    istream& in;
+
+    /** 已创建或找到的目录：相对路径（以 / 连接）到 inode 号。空串为导入目标目录。 */
+    unordered_map<string, int> dirs;
+
+    /** 已导入的普通文件。用于硬链接。 */
+    unordered_map<string, int> files;
+
+    /**
+     * 目录的属性。目录增长时会被重写（并重新开放权限），所以等所有项导入后再设置。
+     */
+    struct DirAttributes {
+        int ino;
+        long long mode;
+        long long uid;
+        long long gid;
+        long long mtime;
+    };
+
+    vector<DirAttributes> dirAttributes;
+
+    vector<char> buffer;
+
+    int fileCount = 0;
+    int dirCount = 0;
+    int linkCount = 0;
+    int skipCount = 0;
+    long long dataBytes = 0;
+
+    bool readFully(char* dst, long long bytes) {
+        in.read(dst, bytes);
+        return in.gcount() == bytes;
+    }
+
+    bool skip(long long bytes) {
+        char discard[4096];
+        while (bytes > 0) {
+            long long n = min(bytes, (long long) sizeof(discard));
+            if (!readFully(discard, n)) {
+                return false;
+            }
+
+            bytes -= n;
+        }
+
+        return true;
+    }
+
+    bool readData(string& data, long long size) {
+        data.resize(paddedSize(size));
+        if (!readFully(data.data(), data.size())) {
+            return false;
+        }
+
+        data.resize(size);
+        return true;
+    }
+
+    /**
+     * 在目录中找到或新建一项。已存在且类型相同时直接使用。
+     *
+     * @return inode 号。-1 表示失败。
+     */
+    int findOrCreate(int parentIno, const string& name, Inode::FileType type) {
+        int ino = adapter.lookupEntry(parentIno, name);
+        if (ino > 0) {
+            if (adapter.inodes[ino].file_type != type) {
+                cout << "[error] 已存在类型不同的同名项：" << name << endl;
+                return -1;
+            }
+
+            return ino;
+        }
+
+        adapter.session().allocContext.parentIno = parentIno;
+        ino = adapter.getFreeInode();
+        if (ino < 0) {
+            cout << "[error] 无法获取空 inode。" << endl;
+            return -1;
+        }
+
+        adapter.inodes[ino].file_type = type;
+        if (!adapter.linkEntry(parentIno, name, ino)) {
+            adapter.freeInode(ino);
+            return -1;
+        }
+
+        if (type == Inode::FileType::DIR) {
+            dirCount++;
+        }
+
+        return ino;
+    }
+
+    /**
+     * 确保 segments 的前 count 段都是目录，缺少的逐级创建。
+     *
+     * @return 最后一段的 inode 号。-1 表示失败。
+     */
+    int ensureDirectory(const vector<string>& segments, size_t count) {
+        string key;
+        int ino = dirs[""];
+        for (size_t idx = 0; idx < count; idx++) {
+            key += "/" + segments[idx];
+            auto it = dirs.find(key);
+            if (it != dirs.end()) {
+                ino = it->second;
+                continue;
+            }
+
+            ino = findOrCreate(ino, segments[idx], Inode::FileType::DIR);
+            if (ino < 0) {
+                return -1;
+            }
+
+            dirs[key] = ino;
+        }
+
+        return ino;
+    }
+
+    /**
+     * 从流中读入 size 字节写入文件。超出文件大小上限的部分被丢弃。
+     *
+     * @return 流是否完好。
+     */
+    bool writeFileData(int ino, int parentIno, long long size, bool& written) {
+        Inode& inode = adapter.inodes[ino];
+        int writeSize = min(size, (long long) adapter.FS_FILE_SIZE_MAX);
+        long long consumed = 0;
+        bool streamOk = true;
+
+        {
+            BlockTraceTag tag(BlockTrace::TAG_FILE_WRITE);
+            unique_lock<shared_mutex> lock(adapter.inodeLock(ino));
+
+            AllocationContext& allocContext = adapter.session().allocContext;
+            allocContext.ino = ino;
+            allocContext.parentIno = parentIno;
+            allocContext.goal = 0;
+            allocContext.blocksWanted = AllocationContext::blocksForFileSize(writeSize);
+
+            written = adapter.writeInodeExtents(
+                inode,
+                writeSize,
+
+                [&] () {
+                    return adapter.getFreeBlock();
+                },
+
+                // 区段按文件内偏移递增的顺序到达，且没有空洞，正好与流的顺序一致。
+                [&] (int dataByteOffset, int blockIdx, int blockCount) {
+                    long long bytes = min(blockCount * (long long) sizeof(Block), (long long) writeSize - dataByteOffset);
+                    buffer.resize(blockCount * sizeof(Block));
+                    if (!readFully(buffer.data(), bytes)) {
+                        streamOk = false;
+                        return false;
+                    }
+
+                    consumed += bytes;
+                    memset(buffer.data() + bytes, 0, buffer.size() - bytes);
+                    return adapter.writeBlocks(buffer.data(), blockIdx, blockCount);
+                }
+            );
+        }
+
+        dataBytes += consumed;
+        if (size > writeSize) {
+            cout << "[warning] 文件超过大小上限，已截断：" << size << " 字节。" << endl;
+        }
+
+        return streamOk && skip(paddedSize(size) - consumed);
+    }
+
+    static void applyAttributes(Inode& inode, long long mode, long long uid, long long gid, long long mtime) {
+        inode.permission_owner = mode >> 6 & 7;
+        inode.permission_group = mode >> 3 & 7;
+        inode.permission_others = mode & 7;
+        inode.isuid = mode >> 11 & 1;
+        inode.isgid = mode >> 10 & 1;
+        inode.isvtx = mode >> 9 & 1;
+        inode.d_uid = uid;
+        inode.d_gid = gid;
+        inode.d_mtime = mtime;
+    }
+};
+
+/**
+ * 解析 pax 扩展头：若干条 "长度 键=值\n"。
+ */
+static void parsePaxRecords(const string& data, unordered_map<string, string>& records) {
+    size_t pos = 0;
+    while (pos < data.length()) {
+        size_t space = data.find(' ', pos);
+        if (space == string::npos) {
+            return;
+        }
+
+        long long length = atoll(data.c_str() + pos);
+        if (length <= 0 || pos + length > data.length()) {
+            return;
+        }
+
+        string record = data.substr(space + 1, pos + length - space - 1);
+        size_t eq = record.find('=');
+        if (eq != string::npos) {
+            string value = record.substr(eq + 1);
+            if (!value.empty() && value.back() == '\n') {
+                value.pop_back();
+            }
+
+            records[record.substr(0, eq)] = value;
+        }
+
+        pos += length;
+    }
+}
+
+bool TarArchive::importTar(FileSystemAdapter& adapter, istream& in, const string& targetDir) {
+    V6PP_TRACE_SCOPE("tarImport", targetDir);
+    auto beginTime = steady_clock::now();
+
+    vector<int> dirChain;
+    string dirName;
+    if (!adapter.resolvePath(targetDir, dirChain, dirName)) {
+        return false;
+    }
+
+    int targetIno = dirName.empty() ? dirChain.back() : adapter.lookupEntry(dirChain.back(), dirName);
+    if (targetIno <= 0 || adapter.inodes[targetIno].file_type != Inode::FileType::DIR) {
+        cout << "[error] 导入目标不是文件夹：" << targetDir << endl;
+        return false;
+    }
+
+    TarImport state = { adapter, in };
+    state.dirs[""] = targetIno;
+
+    // 下一项的扩展信息：pax 扩展头与 GNU 长文件名。
+    unordered_map<string, string> pax;
+    string longName;
+    string longLink;
+    int zeroHeaders = 0;
+    bool result = true;
+
+    while (true) {
+        TarHeader header;
+        if (!state.readFully((char*) &header, sizeof(header))) {
+            if (zeroHeaders == 0) {
+                cout << "[error] tar 流意外结束。" << endl;
+                result = false;
+            }
+
+            break;
+        }
+
+        if (Block::isZero((const char*) &header, sizeof(header))) {
+            if (++zeroHeaders == 2) {
+                break; // 两个全零块：归档结束。
+            }
+
+            continue;
+        }
+
+        zeroHeaders = 0;
+
+        if (parseNumber(header.chksum, sizeof(header.chksum)) != headerChecksum(header)) {
+            cout << "[error] tar 头校验和错误。" << endl;
+            result = false;
+            break;
+        }
+
+        long long size = parseNumber(header.size, sizeof(header.size));
+        string path = fieldString(header.name, sizeof(header.name));
+        if (memcmp(header.magic, "ustar", 5) == 0 && header.prefix[0] != '\0') {
+            path = fieldString(header.prefix, sizeof(header.prefix)) + "/" + path;
+        }
+
+        string linkPath = fieldString(header.linkname, sizeof(header.linkname));
+        long long mode = parseNumber(header.mode, sizeof(header.mode));
+        long long uid = parseNumber(header.uid, sizeof(header.uid));
+        long long gid = parseNumber(header.gid, sizeof(header.gid));
+        long long mtime = parseNumber(header.mtime, sizeof(header.mtime));
+
+        // 扩展头本身：读入后作用于下一项。
+        if (header.typeflag == 'x' || header.typeflag == 'g' || header.typeflag == 'L' || header.typeflag == 'K') {
+            if (size < 0 || size > EXTENSION_BYTES_MAX) {
+                cout << "[error] tar 扩展头的大小无效：" << size << endl;
+                result = false;
+                break;
+            }
+
+            string data;
+            if (!state.readData(data, size)) {
+                cout << "[error] tar 流意外结束。" << endl;
+                result = false;
+                break;
+            }
+
+            if (header.typeflag == 'x') {
+                parsePaxRecords(data, pax);
+            } else if (header.typeflag == 'L') {
+                longName = data.c_str();
+            } else if (header.typeflag == 'K') {
+                longLink = data.c_str();
+            }
+
+            continue; // 全局扩展头（g）不影响导入的内容。
+        }
+
+        if (!longName.empty()) {
+            path = longName;
+        }
+
+        if (!longLink.empty()) {
+            linkPath = longLink;
+        }
+
+        if (pax.count("path")) {
+            path = pax["path"];
+        }
+
+        if (pax.count("linkpath")) {
+            linkPath = pax["linkpath"];
+        }
+
+        if (pax.count("size")) {
+            size = atoll(pax["size"].c_str());
+        }
+
+        if (pax.count("mtime")) {
+            mtime = atoll(pax["mtime"].c_str());
+        }
+
+        if (pax.count("uid")) {
+            uid = atoll(pax["uid"].c_str());
+        }
+
+        if (pax.count("gid")) {
+            gid = atoll(pax["gid"].c_str());
+        }
+
+        pax.clear();
+        longName.clear();
+        longLink.clear();
+
+        if (size < 0 || mode < 0 || uid < 0 || gid < 0 || mtime < 0) {
+            cout << "[error] tar 头中的数值无效：" << path << endl;
+            result = false;
+            break;
+        }
+
+        char type = header.typeflag;
+        bool hasData = type == '0' || type == '\0' || type == '7';
+        long long dataToSkip = hasData ? paddedSize(size) : 0;
+
+        vector<string> segments;
+        if (!splitMemberPath(path, segments)) {
+            cout << "[warning] 跳过含有 .. 的路径：" << path << endl;
+            state.skipCount++;
+            if (!state.skip(dataToSkip)) {
+                result = false;
+                break;
+            }
+
+            continue;
+        }
+
+        if (type == '5') { // 目录。
+            int ino = state.ensureDirectory(segments, segments.size());
+            if (ino < 0) {
+                state.skipCount++;
+            } else if (!segments.empty()) {
+                state.dirAttributes.push_back({ ino, mode, uid, gid, mtime });
+            }
+
+            continue;
+        }
+
+        if (segments.empty()) {
+            state.skipCount++;
+            if (!state.skip(dataToSkip)) {
+                result = false;
+                break;
+            }
+
+            continue;
+        }
+
+        int parentIno = state.ensureDirectory(segments, segments.size() - 1);
+        const string& name = segments.back();
+        string key;
+        for (const string& seg : segments) {
+            key += "/" + seg;
+        }
+
+        if (parentIno < 0) {
+            state.skipCount++;
+            if (!state.skip(dataToSkip)) {
+                result = false;
+                break;
+            }
+
+            continue;
+        }
+
+        if (hasData) { // 普通文件。
+            int ino = state.findOrCreate(parentIno, name, Inode::FileType::NORMAL);
+            if (ino < 0) {
+                state.skipCount++;
+                if (!state.skip(dataToSkip)) {
+                    result = false;
+                    break;
+                }
+
+                continue;
+            }
+
+            bool written;
+            if (!state.writeFileData(ino, parentIno, size, written)) {
+                cout << "[error] tar 流意外结束：" << path << endl;
+                result = false;
+                break;
+            }
+
+            if (!written) {
+                cout << "[error] 写入失败（可能的原因：盘满）：" << path << endl;
+                result = false;
+                break;
+            }
+
+            TarImport::applyAttributes(adapter.inodes[ino], mode, uid, gid, mtime);
+            state.files[key] = ino;
+            state.fileCount++;
+
+        } else if (type == '1') { // 硬链接。
+            vector<string> targetSegments;
+            string targetKey;
+            splitMemberPath(linkPath, targetSegments);
+            for (const string& seg : targetSegments) {
+                targetKey += "/" + seg;
+            }
+
+            auto it = state.files.find(targetKey);
+            if (it == state.files.end() || !adapter.linkEntry(parentIno, name, it->second)) {
+                cout << "[warning] 无法建立硬链接：" << path << " -> " << linkPath << endl;
+                state.skipCount++;
+                continue;
+            }
+
+            adapter.inodes[it->second].d_nlink++;
+            state.files[key] = it->second;
+            state.linkCount++;
+
+        } else if (type == '3' || type == '4') { // 设备文件。
+            Inode::FileType devType = type == '3' ? Inode::FileType::CHAR_DEV : Inode::FileType::BLOCK_DEV;
+            int ino = state.findOrCreate(parentIno, name, devType);
+            if (ino < 0) {
+                state.skipCount++;
+                continue;
+            }
+
+            TarImport::applyAttributes(adapter.inodes[ino], mode, uid, gid, mtime);
+            state.fileCount++;
+
+        } else {
+            cout << "[warning] 跳过不支持的类型 '" << type << "'：" << path << endl;
+            state.skipCount++;
+            if (!state.skip(paddedSize(size))) {
+                result = false;
+                break;
+            }
+        }
+    }
+
+    for (const TarImport::DirAttributes& attr : state.dirAttributes) {
+        TarImport::applyAttributes(adapter.inodes[attr.ino], attr.mode, attr.uid, attr.gid, attr.mtime);
+    }
+
+    adapter.metadataDirty = true;
+
+    double seconds = duration_cast<microseconds>(steady_clock::now() - beginTime).count() / 1e6;
+    cout << "[info] tar 导入：文件 " << state.fileCount << "，目录 " << state.dirCount
+        << "，硬链接 " << state.linkCount << "，跳过 " << state.skipCount
+        << "，数据 " << state.dataBytes << " 字节，耗时 " << seconds << " s。" << endl;
+
+    return result;
+}
+
+/* ------------ 导出。 ------------ */
+
+/**
+ * 写出一个头。路径放不进 ustar 的 name 与 prefix 时，先写出 pax 扩展头。
+ *
+ * @return 写出的字节数。
+ */
+static long long writeHeader(
+    ostream& out, const string& path, char type, const Inode& inode, long long size, const string& linkPath
+) {
+    TarHeader header;
+    memset(&header, 0, sizeof(header));
+
+    string paxData;
+    auto addPaxRecord = [&] (const string& key, const string& value) {
+        // 长度字段包含它自身的位数。
+        string body = " " + key + "=" + value + "\n";
+        int length = body.length() + 1;
+        while (to_string(length).length() + body.length() != length) {
+            length++;
+        }
+
+        paxData += to_string(length) + body;
+    };
+
+    if (path.length() <= sizeof(header.name)) {
+        memcpy(header.name, path.data(), path.length());
+    } else {
+        // 在某个 / 处拆成 prefix 与 name。
+        size_t split = path.rfind('/', sizeof(header.prefix));
+        if (split != string::npos && split > 0 && path.length() - split - 1 <= sizeof(header.name)
+            && path.length() - split - 1 > 0
+        ) {
+            memcpy(header.prefix, path.data(), split);
+            memcpy(header.name, path.data() + split + 1, path.length() - split - 1);
+        } else {
+            addPaxRecord("path", path);
+            memcpy(header.name, path.data(), sizeof(header.name));
+        }
+    }
+
+    if (linkPath.length() > sizeof(header.linkname)) {
+        addPaxRecord("linkpath", linkPath);
+    } else {
+        memcpy(header.linkname, linkPath.data(), linkPath.length());
+    }
+
+    int mode = inode.permission_owner << 6 | inode.permission_group << 3 | inode.permission_others
+        | inode.isuid << 11 | inode.isgid << 10 | inode.isvtx << 9;
+
+    snprintf(header.mode, sizeof(header.mode), "%07o", mode);
+    snprintf(header.uid, sizeof(header.uid), "%07o", (unsigned) inode.d_uid);
+    snprintf(header.gid, sizeof(header.gid), "%07o", (unsigned) inode.d_gid);
+    snprintf(header.size, sizeof(header.size), "%011llo", size);
+    snprintf(header.mtime, sizeof(header.mtime), "%011o", (unsigned) inode.d_mtime);
+    header.typeflag = type;
+    memcpy(header.magic, "ustar", 6);
+    memcpy(header.version, "00", 2);
+    snprintf(header.devmajor, sizeof(header.devmajor), "%07o", 0);
+    snprintf(header.devminor, sizeof(header.devminor), "%07o", 0);
+
+    if (!paxData.empty()) {
+        TarHeader paxHeader = header;
+        memset(paxHeader.name, 0, sizeof(paxHeader.name));
+        memset(paxHeader.prefix, 0, sizeof(paxHeader.prefix));
+        memset(paxHeader.linkname, 0, sizeof(paxHeader.linkname));
+        snprintf(paxHeader.name, sizeof(paxHeader.name), "PaxHeaders/%.80s",
+            path.substr(path.rfind('/', path.length() - 2) + 1).c_str());
+        snprintf(paxHeader.size, sizeof(paxHeader.size), "%011llo", (long long) paxData.length());
+        paxHeader.typeflag = 'x';
+        snprintf(paxHeader.chksum, sizeof(paxHeader.chksum), "%06o", headerChecksum(paxHeader));
+        paxHeader.chksum[7] = ' ';
+
+        out.write((const char*) &paxHeader, sizeof(paxHeader));
+        paxData.resize(paddedSize(paxData.length()), '\0');
+        out.write(paxData.data(), paxData.length());
+    }
+
+    long long bytes = sizeof(TarHeader) + (paxData.empty() ? 0 : sizeof(TarHeader) + paxData.length());
+
+    snprintf(header.chksum, sizeof(header.chksum), "%06o", headerChecksum(header));
+    header.chksum[7] = ' ';
+    out.write((const char*) &header, sizeof(header));
+    return bytes;
+}
+
+/**
+ * 写出文件数据。盘块号连续的数据块一次读入，空洞输出为 0。末尾补齐到 512 字节。
+ */
+static bool writeFileData(FileSystemAdapter& adapter, Inode& inode, ostream& out, vector<char>& buffer) {
+    BlockTraceTag tag(BlockTrace::TAG_FILE_READ);
+    long long fileSize = inode.d_size;
+    int runBlockIdx = 0;
+    int runByteOffset = 0;
+    int runBlockCount = 0;
+    bool ok = true;
+
+    auto flushRun = [&] () {
+        if (runBlockCount == 0) {
+            return;
+        }
+
+        buffer.resize(runBlockCount * sizeof(Block));
+        if (runBlockIdx == 0) {
+            memset(buffer.data(), 0, buffer.size());
+        } else if (!adapter.readBlocks(buffer.data(), runBlockIdx, runBlockCount)) {
+            ok = false;
+        }
+
+        // 最后一块中文件末尾之后的内容是盘块里的旧数据，补齐部分输出为 0。
+        long long bytes = min((long long) buffer.size(), fileSize - runByteOffset);
+        memset(buffer.data() + bytes, 0, paddedSize(bytes) - bytes);
+        out.write(buffer.data(), paddedSize(bytes));
+        runBlockCount = 0;
+    };
+
+    adapter.iterateOverInodeDataBlocks(
+        inode,
+
+        [&] (int dataByteOffset, int blockIdx) {
+            bool contiguous = runBlockCount > 0
+                && runBlockCount < FileSystemAdapter::EXTENT_BLOCKS_MAX
+                && (blockIdx == 0 ? runBlockIdx == 0 : runBlockIdx != 0 && blockIdx == runBlockIdx + runBlockCount);
+
+            if (!contiguous) {
+                flushRun();
+                runBlockIdx = blockIdx;
+                runByteOffset = dataByteOffset;
+            }
+
+            runBlockCount++;
+        },
+
+        [] (int prevBlockIdx) {
+            return prevBlockIdx;
+        },
+
+        [&] (Inode&, int, const char*) {
+            ok = false;
+        },
+
+        [] (...) {},
+
+        [] (...) {}
+    );
+
+    flushRun();
+    return ok;
+}
+
+bool TarArchive::exportTar(FileSystemAdapter& adapter, const string& srcPath, ostream& out) {
+    V6PP_TRACE_SCOPE("tarExport", srcPath);
+    auto beginTime = steady_clock::now();
+
+    vector<int> chain;
+    string name;
+    if (!adapter.resolvePath(srcPath, chain, name)) {
+        return false;
+    }
+
+    int rootIno = name.empty() ? chain.back() : adapter.lookupEntry(chain.back(), name);
+    if (rootIno <= 0) {
+        cout << "[error] 找不到：" << srcPath << endl;
+        return false;
+    }
+
+    struct ExportItem {
+        string path;
+        int ino;
+    };
+
+    vector<ExportItem> dirItems;
+    vector<ExportItem> fileItems;
+    const int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+
+    if (adapter.inodes[rootIno].file_type != Inode::FileType::DIR) {
+        fileItems.push_back({ name, rootIno });
+    } else {
+        // 按层列出子树。目录路径以 / 结尾。
+        vector<bool> visited(inodeCount, false);
+        vector<ExportItem> frontier = { { "", rootIno } };
+        visited[rootIno] = true;
+
+        while (!frontier.empty()) {
+            vector<ExportItem> next;
+            for (const ExportItem& dirItem : frontier) {
+                shared_lock<shared_mutex> lock(adapter.inodeLock(dirItem.ino));
+                DirectoryView dir(adapter.inodes[dirItem.ino], adapter);
+
+                dir.forEach([&] (const DirectoryEntry& entry) {
+                    if (entry.m_ino == 0 || entry.m_ino >= inodeCount) {
+                        return;
+                    }
+
+                    string path = dirItem.path + string(entry.m_name, strnlen(entry.m_name, DirectoryEntry::DIRSIZE));
+                    if (adapter.inodes[entry.m_ino].file_type != Inode::FileType::DIR) {
+                        fileItems.push_back({ path, (int) entry.m_ino });
+                    } else if (!visited[entry.m_ino]) {
+                        visited[entry.m_ino] = true;
+                        next.push_back({ path + "/", (int) entry.m_ino });
+                    }
+                });
+            }
+
+            dirItems.insert(dirItems.end(), next.begin(), next.end());
+            frontier.swap(next);
+        }
+    }
+
+    // 文件按第一个数据块排序，使读取大致按盘块顺序进行。同一 inode 的目录项相邻，第一项之后导出为硬链接。
+    auto firstBlock = [&] (int ino) {
+        const Inode& inode = adapter.inodes[ino];
+        return inode.d_size > 0 ? inode.direct_index[0] : 0u;
+    };
+
+    stable_sort(fileItems.begin(), fileItems.end(), [&] (const ExportItem& a, const ExportItem& b) {
+        uint32_t blockA = firstBlock(a.ino);
+        uint32_t blockB = firstBlock(b.ino);
+        return blockA != blockB ? blockA < blockB : a.ino < b.ino;
+    });
+
+    long long headerBytes = 0;
+    for (const ExportItem& item : dirItems) {
+        headerBytes += writeHeader(out, item.path, '5', adapter.inodes[item.ino], 0, "");
+    }
+
+    vector<char> buffer;
+    unordered_map<int, string> exported;
+    long long dataBytes = 0;
+    long long dataBytesPadded = 0;
+    bool result = true;
+
+    for (const ExportItem& item : fileItems) {
+        Inode& inode = adapter.inodes[item.ino];
+
+        auto linked = exported.find(item.ino);
+        if (linked != exported.end()) {
+            headerBytes += writeHeader(out, item.path, '1', inode, 0, linked->second);
+            continue;
+        }
+
+        exported[item.ino] = item.path;
+
+        if (inode.file_type == Inode::FileType::CHAR_DEV || inode.file_type == Inode::FileType::BLOCK_DEV) {
+            headerBytes += writeHeader(out, item.path, inode.file_type == Inode::FileType::CHAR_DEV ? '3' : '4', inode, 0, "");
+            continue;
+        }
+
+        shared_lock<shared_mutex> lock(adapter.inodeLock(item.ino));
+        headerBytes += writeHeader(out, item.path, '0', inode, inode.d_size, "");
+        if (!writeFileData(adapter, inode, out, buffer)) {
+            cout << "[error] 读取失败：" << item.path << endl;
+            result = false;
+        }
+
+        dataBytes += inode.d_size;
+        dataBytesPadded += paddedSize(inode.d_size);
+    }
+
+    // 结尾：两个全零块，再补齐到记录大小。
+    vector<char> zeros(TAR_RECORD_SIZE, 0);
+    long long total = headerBytes + dataBytesPadded + 2 * sizeof(TarHeader);
+    out.write(zeros.data(), 2 * sizeof(TarHeader) + (TAR_RECORD_SIZE - total % TAR_RECORD_SIZE) % TAR_RECORD_SIZE);
+    out.flush();
+
+    double seconds = duration_cast<microseconds>(steady_clock::now() - beginTime).count() / 1e6;
+    cout << "[info] tar 导出：文件 " << fileItems.size() << "，目录 " << dirItems.size()
+        << "，数据 " << dataBytes << " 字节，耗时 " << seconds << " s。" << endl;
+
+    return result && out.good();
+}
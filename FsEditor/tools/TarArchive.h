@@ -0,0 +1,71 @@
+/*
+ * tar 流的导入与导出。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <string>
+#include <iostream>
+#include "../MacroDefines.h"
+#include "../FileSystemAdapter.h"
+
+/**
+ * ustar 格式的 tar 头。512 字节。
+ */
+class TarHeader {
+public:
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+} __packed;
+
+/**
+ * tar 流与映像内目录树之间的转换。
+ *
+ * 导入：边读边写，不使用临时文件。目录与文件在对应的头到达时创建（缺少的上级目录自动补上），
+ * 目录项追加到目录末尾，每次只写一个盘块；文件数据按区段从流中读入并直接写到申请到的盘块。
+ * 支持 ustar、pax 扩展头（path、linkpath、size、mtime、uid、gid）与 GNU 长文件名；
+ * 普通文件、目录、硬链接与设备文件会被导入，符号链接等 V6++ 不支持的类型被跳过。
+ *
+ * 导出：先按层列出子树中的所有项，目录在前，文件按第一个数据块的盘块号排序，
+ * 使读取大致按盘块顺序进行；文件中盘块号连续的部分一次读入。同一 inode 的后续目录项导出为硬链接。
+ * 路径放不进 ustar 头时使用 pax 扩展头。
+ */
+class TarArchive {
+public:
+    /**
+     * 从 tar 流导入。
+     *
+     * @param adapter 已加载、可写的文件系统。
+     * @param in tar 流。
+     * @param targetDir 导入到的目录（文件系统内路径）。
+     * @return 是否成功读完整个流。个别项被跳过不算失败。
+     */
+    static bool importTar(FileSystemAdapter& adapter, std::istream& in, const std::string& targetDir);
+
+    /**
+     * 将文件或目录导出为 tar 流。目录导出时，成员路径相对于该目录。
+     *
+     * @param adapter 已加载的文件系统。
+     * @param srcPath 要导出的文件或目录（文件系统内路径）。
+     * @param out 输出流。
+     * @return 是否成功。
+     */
+    static bool exportTar(FileSystemAdapter& adapter, const std::string& srcPath, std::ostream& out);
+};
@@ -0,0 +1,548 @@
+/*
+ * 目录树的遍历：递归列出、查找、du 与 df - 实现。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include "./FileSystemAdapter.h"
+#include "./Tracer.h"
+#include "./structures/Block.h"
+#include "./structures/DirectoryView.h"
+#include "./tools/TreeWalk.h"
+
+using namespace std;
+
+TreeWalk::TreeWalk(FileSystemAdapter& adapter, ostream& out) : adapter(adapter), out(out) {
+
+}
+
+bool TreeWalk::walk(const string& path) {
+    V6PP_TRACE_SCOPE("treeWalk", path);
+    nodes.clear();
+
+    vector<int> chain;
+    string name;
+    if (!adapter.resolvePath(path, chain, name)) {
+        return false;
+    }
+
+    int rootIno = name.empty() ? chain.back() : adapter.lookupEntry(chain.back(), name);
+    if (rootIno <= 0) {
+        cout << "[error] 找不到：" << path << endl;
+        return false;
+    }
+
+    rootPath = path.empty() ? "." : path;
+    while (rootPath.length() > 1 && rootPath.back() == '/') {
+        rootPath.pop_back();
+    }
+
+    const int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    vector<bool> expanded(inodeCount, false);
+
+    Node root = { rootIno, -1, 0 };
+    memset(root.name, 0, sizeof(root.name));
+    nodes.push_back(root);
+
+    vector<int> frontier;
+    if (adapter.inodes[rootIno].file_type == Inode::FileType::DIR) {
+        frontier.push_back(0);
+        expanded[rootIno] = true;
+    }
+
+    while (!frontier.empty()) {
+        // 同一层的目录按盘块顺序读取。
+        sort(frontier.begin(), frontier.end(), [&] (int a, int b) {
+            const Inode& inodeA = adapter.inodes[nodes[a].ino];
+            const Inode& inodeB = adapter.inodes[nodes[b].ino];
+            return inodeA.direct_index[0] < inodeB.direct_index[0];
+        });
+
+        vector<int> next;
+        for (int dirIdx : frontier) {
+            int dirIno = nodes[dirIdx].ino;
+            int depth = nodes[dirIdx].depth + 1;
+            int firstChild = nodes.size();
+
+            shared_lock<shared_mutex> lock(adapter.inodeLock(dirIno));
+            DirectoryView dir(adapter.inodes[dirIno], adapter);
+
+            dir.forEach([&] (const DirectoryEntry& entry) {
+                if (entry.m_ino == 0 || entry.m_ino >= inodeCount) {
+                    return;
+                }
+
+                Node node = { (int) entry.m_ino, dirIdx, depth };
+                memcpy(node.name, entry.m_name, sizeof(node.name));
+                nodes.push_back(node);
+
+                if (adapter.inodes[entry.m_ino].file_type == Inode::FileType::DIR && !expanded[entry.m_ino]) {
+                    expanded[entry.m_ino] = true;
+                    next.push_back(nodes.size() - 1);
+                }
+            });
+
+            nodes[dirIdx].firstChild = firstChild;
+            nodes[dirIdx].childCount = nodes.size() - firstChild;
+        }
+
+        frontier.swap(next);
+    }
+
+    return true;
+}
+
+void TreeWalk::write(const string& text) {
+    buffer += text;
+    if (buffer.length() >= FLUSH_BYTES) {
+        flush();
+    }
+}
+
+void TreeWalk::flush() {
+    out.write(buffer.data(), buffer.length());
+    out.flush();
+    buffer.clear();
+}
+
+void TreeWalk::appendPath(string& dst, int idx) const {
+    if (idx == 0) {
+        dst += rootPath;
+        return;
+    }
+
+    appendPath(dst, nodes[idx].parent);
+    if (dst.back() != '/') {
+        dst += '/';
+    }
+
+    dst.append(nodes[idx].name, strnlen(nodes[idx].name, DirectoryEntry::DIRSIZE));
+}
+
+void TreeWalk::appendListLine(const Node& node) {
+    const Inode& inode = adapter.inodes[node.ino];
+
+    char mode[11];
+    switch (inode.file_type) {
+        case Inode::FileType::BLOCK_DEV:
+            mode[0] = 'b';
+            break;
+
+        case Inode::FileType::CHAR_DEV:
+            mode[0] = 'c';
+            break;
+
+        case Inode::FileType::DIR:
+            mode[0] = 'd';
+            break;
+
+        case Inode::FileType::NORMAL:
+            mode[0] = '-';
+            break;
+
+        default:
+            mode[0] = '?';
+            break;
+    }
+
+    int permissions[] = { inode.permission_owner, inode.permission_group, inode.permission_others };
+    for (int i = 0; i < 3; i++) {
+        mode[1 + i * 3] = (permissions[i] & 4) ? 'r' : '-';
+        mode[2 + i * 3] = (permissions[i] & 2) ? 'w' : '-';
+        mode[3 + i * 3] = (permissions[i] & 1) ? 'x' : '-';
+    }
+
+    mode[10] = '\0';
+
+    // 列与 ls 相同。
+    char line[128];
+    int length = snprintf(
+        line, sizeof(line), "%s%4u%3u :%3u%8u%12u.m%12u.a ",
+        mode, (unsigned) inode.d_nlink, (unsigned) inode.d_gid, (unsigned) inode.d_uid,
+        (unsigned) inode.d_size, (unsigned) inode.d_mtime, (unsigned) inode.d_atime
+    );
+
+    buffer.append(line, length);
+    buffer.append(node.name, strnlen(node.name, DirectoryEntry::DIRSIZE));
+    buffer += '\n';
+}
+
+void TreeWalk::list() {
+    V6PP_TRACE_SCOPE("treeList", rootPath);
+    string path;
+    bool firstDir = true;
+
+    for (int idx = 0; idx < nodes.size(); idx++) {
+        const Node& dirNode = nodes[idx];
+        if (dirNode.firstChild < 0) {
+            if (idx == 0) { // 起点不是目录。
+                appendListLine(dirNode);
+            }
+
+            continue;
+        }
+
+        if (!firstDir) {
+            buffer += '\n';
+        }
+
+        firstDir = false;
+        path.clear();
+        appendPath(path, idx);
+        buffer += path;
+        buffer += ":\n";
+
+        for (int child = dirNode.firstChild; child < dirNode.firstChild + dirNode.childCount; child++) {
+            appendListLine(nodes[child]);
+        }
+
+        if (buffer.length() >= FLUSH_BYTES) {
+            flush();
+        }
+    }
+
+    flush();
+}
+
+/**
+ * 通配符匹配：* 匹配任意串，? 匹配一个字符，[...] 匹配集合（支持 a-z 范围与开头的 ! 或 ^ 取反）。
+ * 遇到 * 时记下回溯点，失配后让 * 多吞一个字符，不需要递归。
+ */
+static bool globMatch(const char* pattern, const char* name) {
+    const char* starPattern = nullptr;
+    const char* starName = nullptr;
+
+    while (*name != '\0') {
+        if (*pattern == '*') {
+            starPattern = ++pattern;
+            starName = name;
+            continue;
+        }
+
+        bool matched = false;
+        const char* nextPattern = pattern + 1;
+
+        if (*pattern == '?') {
+            matched = true;
+        } else if (*pattern == '[') {
+            const char* p = pattern + 1;
+            bool negate = *p == '!' || *p == '^';
+            if (negate) {
+                p++;
+            }
+
+            bool inSet = false;
+            bool first = true;
+            while (*p != '\0' && (first || *p != ']')) {
+                first = false;
+                if (p[1] == '-' && p[2] != '\0' && p[2] != ']') {
+                    inSet |= *name >= p[0] && *name <= p[2];
+                    p += 3;
+                } else {
+                    inSet |= *name == *p;
+                    p++;
+                }
+            }
+
+            if (*p == ']') {
+                matched = inSet != negate;
+                nextPattern = p + 1;
+            } else { // 没有闭合，按普通字符处理。
+                matched = *name == '[';
+            }
+        } else {
+            matched = *pattern == *name;
+        }
+
+        if (matched && *pattern != '\0') {
+            pattern = nextPattern;
+            name++;
+        } else if (starPattern != nullptr) {
+            pattern = starPattern;
+            name = ++starName;
+        } else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*') {
+        pattern++;
+    }
+
+    return *pattern == '\0';
+}
+
+int TreeWalk::find(const string& expression) {
+    V6PP_TRACE_SCOPE("treeFind", expression);
+
+    // 解析表达式。
+    string namePattern;
+    int type = -1;
+    int sizeCompare = 0; // -1：小于，0：等于，1：大于。
+    long long sizeUnit = 0;
+    long long sizeValue = -1;
+    int maxDepth = -1;
+
+    istringstream tokens(expression);
+    string token;
+    while (tokens >> token) {
+        string arg;
+        if (!(tokens >> arg)) {
+            cout << "[error] 缺少参数：" << token << endl;
+            return -1;
+        }
+
+        if (token == "-name") {
+            namePattern = arg;
+        } else if (token == "-type") {
+            if (arg == "f") {
+                type = Inode::FileType::NORMAL;
+            } else if (arg == "d") {
+                type = Inode::FileType::DIR;
+            } else if (arg == "c") {
+                type = Inode::FileType::CHAR_DEV;
+            } else if (arg == "b") {
+                type = Inode::FileType::BLOCK_DEV;
+            } else {
+                cout << "[error] 未知的类型：" << arg << endl;
+                return -1;
+            }
+        } else if (token == "-size") {
+            if (arg[0] == '+' || arg[0] == '-') {
+                sizeCompare = arg[0] == '+' ? 1 : -1;
+                arg = arg.substr(1);
+            }
+
+            sizeUnit = sizeof(Block);
+            switch (arg.empty() ? '\0' : arg.back()) {
+                case 'c':
+                    sizeUnit = 1;
+                    break;
+
+                case 'k':
+                    sizeUnit = 1024;
+                    break;
+
+                case 'M':
+                    sizeUnit = 1024 * 1024;
+                    break;
+            }
+
+            try {
+                sizeValue = stoll(arg);
+            } catch (...) {
+                cout << "[error] 无效的大小：" << arg << endl;
+                return -1;
+            }
+        } else if (token == "-maxdepth") {
+            try {
+                maxDepth = stoi(arg);
+            } catch (...) {
+                cout << "[error] 无效的层数：" << arg << endl;
+                return -1;
+            }
+        } else {
+            cout << "[error] 未知的条件：" << token << endl;
+            return -1;
+        }
+    }
+
+    int matchCount = 0;
+    string path;
+    char name[DirectoryEntry::DIRSIZE + 1];
+
+    for (int idx = 0; idx < nodes.size(); idx++) {
+        const Node& node = nodes[idx];
+        const Inode& inode = adapter.inodes[node.ino];
+
+        if (maxDepth >= 0 && node.depth > maxDepth) {
+            break; // 按层排列，之后的都更深。
+        }
+
+        if (type >= 0 && inode.file_type != type) {
+            continue;
+        }
+
+        if (sizeValue >= 0) {
+            // 与 find 相同，按单位向上取整后比较。
+            long long size = (inode.d_size + sizeUnit - 1) / sizeUnit;
+            if ((sizeCompare == 0 && size != sizeValue)
+                || (sizeCompare > 0 && size <= sizeValue)
+                || (sizeCompare < 0 && size >= sizeValue)
+            ) {
+                continue;
+            }
+        }
+
+        if (!namePattern.empty()) {
+            if (idx == 0) {
+                continue; // 起点没有自己的目录项。
+            }
+
+            memcpy(name, node.name, DirectoryEntry::DIRSIZE);
+            name[DirectoryEntry::DIRSIZE] = '\0';
+            if (!globMatch(namePattern.c_str(), name)) {
+                continue;
+            }
+        }
+
+        path.clear();
+        appendPath(path, idx);
+        path += '\n';
+        write(path);
+        matchCount++;
+    }
+
+    flush();
+    return matchCount;
+}
+
+int TreeWalk::countBlocks(int ino) {
+    Inode& inode = adapter.inodes[ino];
+    if (inode.file_type == Inode::FileType::CHAR_DEV || inode.file_type == Inode::FileType::BLOCK_DEV) {
+        return 0;
+    }
+
+    if (!inode.ilarg) {
+        // 小文件只有直接索引，不需要读盘。
+        int dataBlocks = min(6, (int) ((inode.d_size + sizeof(Block) - 1) / sizeof(Block)));
+        int count = 0;
+        for (int idx = 0; idx < dataBlocks; idx++) {
+            count += inode.direct_index[idx] != 0;
+        }
+
+        return count;
+    }
+
+    shared_lock<shared_mutex> lock(adapter.inodeLock(ino));
+    int count = 0;
+    adapter.iterateOverInodeDataBlocks(
+        inode,
+
+        [&] (int dataByteOffset, int blockIdx) {
+            count += blockIdx != 0;
+        },
+
+        [] (int prevBlockIdx) {
+            return prevBlockIdx;
+        },
+
+        [] (Inode&, int, const char*) {},
+
+        [] (...) {},
+
+        [&] (const char* pBlock, int blockIndex) {
+            count++; // 索引块。
+        }
+    );
+
+    return count;
+}
+
+void TreeWalk::du() {
+    V6PP_TRACE_SCOPE("treeDu", rootPath);
+
+    const int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    vector<bool> counted(inodeCount, false);
+    vector<long long> totalBlocks(nodes.size(), 0);
+    vector<long long> totalBytes(nodes.size(), 0);
+
+    // 大文件需要读索引块。先按索引块的位置排序，使读取按盘块顺序进行。
+    vector<int> order(nodes.size());
+    for (int idx = 0; idx < nodes.size(); idx++) {
+        order[idx] = idx;
+    }
+
+    auto firstIndexBlock = [&] (int idx) {
+        const Inode& inode = adapter.inodes[nodes[idx].ino];
+        return inode.ilarg ? inode.indirect_index[0] : 0u;
+    };
+
+    stable_sort(order.begin(), order.end(), [&] (int a, int b) {
+        return firstIndexBlock(a) < firstIndexBlock(b);
+    });
+
+    for (int idx : order) {
+        int ino = nodes[idx].ino;
+        if (counted[ino]) {
+            continue;
+        }
+
+        counted[ino] = true;
+        totalBlocks[idx] = countBlocks(ino);
+        totalBytes[idx] = adapter.inodes[ino].d_size;
+    }
+
+    // 父节点在子节点之前，倒序累加即可。
+    for (int idx = nodes.size() - 1; idx > 0; idx--) {
+        totalBlocks[nodes[idx].parent] += totalBlocks[idx];
+        totalBytes[nodes[idx].parent] += totalBytes[idx];
+    }
+
+    char line[64];
+    string path;
+    for (int idx = nodes.size() - 1; idx >= 0; idx--) {
+        if (idx > 0 && nodes[idx].firstChild < 0) {
+            continue; // 只输出目录。
+        }
+
+        int length = snprintf(line, sizeof(line), "%8lld %12lld  ", totalBlocks[idx], totalBytes[idx]);
+        path.assign(line, length);
+        appendPath(path, idx);
+        path += '\n';
+        write(path);
+    }
+
+    flush();
+}
+
+void TreeWalk::df(FileSystemAdapter& adapter, ostream& out) {
+    lock_guard<recursive_mutex> allocLock(adapter.allocMutex);
+    const SuperBlock& sb = adapter.superBlock;
+
+    long long freeBlocks = 0;
+    if (adapter.allocPolicy != nullptr) {
+        // 空闲盘块由策略的位图管理，磁盘上的空闲表要到 sync 才重新生成。
+        freeBlocks = adapter.allocPolicy->freeBlocks();
+    } else {
+        // s_free 栈与空闲盘块链。s_free[0] 为下一个链接块（0 表示链尾），链接块本身也是空闲盘块。
+        uint32_t nfree = sb.s_nfree;
+        uint32_t freeEntries[100];
+        memcpy(freeEntries, (const char*) &sb + offsetof(SuperBlock, s_free), sizeof(freeEntries));
+        Block chainBlock;
+
+        while (nfree > 0 && nfree <= 100) {
+            freeBlocks += nfree - 1;
+            uint32_t next = freeEntries[0];
+            if (next < sb.data_zone_begin || next >= sb.data_zone_begin + sb.data_zone_blocks) {
+                break;
+            }
+
+            freeBlocks++;
+            adapter.readBlock(chainBlock, next);
+            memcpy(&nfree, chainBlock.bytes, sizeof(uint32_t));
+            memcpy(freeEntries, chainBlock.bytes + sizeof(uint32_t), sizeof(freeEntries));
+        }
+    }
+
+    const int inodeCount = sizeof(adapter.inodes) / sizeof(Inode);
+    int usedInodes = 0;
+    for (int idx = 0; idx < inodeCount; idx++) {
+        usedInodes += adapter.inodes[idx].ialloc;
+    }
+
+    long long totalBlocks = sb.data_zone_blocks;
+    long long usedBlocks = totalBlocks - freeBlocks;
+
+    out << "[info] 盘块（" << sizeof(Block) << " 字节）：总计 " << totalBlocks << "，已用 " << usedBlocks
+        << "，可用 " << freeBlocks << "（使用率 " << (totalBlocks > 0 ? usedBlocks * 100 / totalBlocks : 0) << "%）。" << endl;
+    out << "[info] inode：总计 " << inodeCount << "，已用 " << usedInodes
+        << "，可用 " << inodeCount - usedInodes << "（使用率 " << usedInodes * 100 / inodeCount << "%）。" << endl;
+}
@@ -0,0 +1,107 @@
+/*
+ * 目录树的遍历：递归列出、查找、du 与 df。
+ * 2051565 龚天遥
+ * 创建于 2026年10月19日。
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "../FileSystemAdapter.h"
+#include "../structures/InodeDirectory.h"
+
+/**
+ * 目录树的快照与基于它的查询。
+ *
+ * walk 从起点出发按层遍历：同一层的目录按第一个数据块的盘块号排序后依次读取，
+ * 目录项只记录 inode 号、名字与父节点，不构造 InodeDirectory，也不复制路径字符串。
+ * 同一目录的子节点在快照中相邻，父节点总在子节点之前。
+ *
+ * 输出先写入内存缓冲区，攒够一批再写到输出流，不逐行刷新。
+ */
+class TreeWalk {
+public:
+    /** 快照中的一项。 */
+    struct Node {
+        int ino;
+
+        /** 父节点下标。起点为 -1。 */
+        int parent;
+
+        int depth;
+
+        /** 子节点的起始下标与个数。只对展开过的目录有效。 */
+        int firstChild = -1;
+        int childCount = 0;
+
+        char name[DirectoryEntry::DIRSIZE];
+    };
+
+public:
+    TreeWalk(FileSystemAdapter& adapter, std::ostream& out = std::cout);
+
+    /**
+     * 遍历 path 之下的整棵树。
+     *
+     * @return 路径是否存在。
+     */
+    bool walk(const std::string& path);
+
+    /**
+     * 递归列出（相当于 ls -lR）。每个目录输出一段，格式与 ls 相同。
+     */
+    void list();
+
+    /**
+     * 查找。表达式由以下条件组成，全部满足才输出：
+     *   -name 模式：名字匹配通配符（* ? [...]）。
+     *   -type f|d|c|b：文件类型。
+     *   -size [+-]N[c|k|M]：大小大于、小于或等于 N。不带单位时以 512 字节的盘块计。
+     *   -maxdepth N：最多向下 N 层。
+     *
+     * @return 匹配的项数。表达式有误时返回 -1。
+     */
+    int find(const std::string& expression);
+
+    /**
+     * 相当于 du：逐个目录输出占用的盘块数（含索引块）与文件大小之和，子目录先于父目录，
+     * 最后一行是起点的合计。硬链接的 inode 只计一次。
+     */
+    void du();
+
+    /**
+     * 相当于 df：数据区与 inode 区的总量、已用与可用。空闲盘块数沿空闲盘块链统计；
+     * 设置了分配策略时以策略的空闲位图为准（磁盘上的空闲表要到 sync 才更新）。
+     */
+    static void df(FileSystemAdapter& adapter, std::ostream& out = std::cout);
+
+public:
+    std::vector<Node> nodes;
+
+private:
+    /** 占用的盘块数（数据块与索引块，不计空洞）。 */
+    int countBlocks(int ino);
+
+    /** 节点的路径。以起点的路径开头。 */
+    void appendPath(std::string& buffer, int idx) const;
+
+    /** 把一行 ls 格式的内容追加到缓冲区。 */
+    void appendListLine(const Node& node);
+
+    void write(const std::string& text);
+    void flush();
+
+private:
+    FileSystemAdapter& adapter;
+    std::ostream& out;
+
+    /** 起点的路径，原样输出。 */
+    std::string rootPath;
+
+    std::string buffer;
+
+    /** 缓冲区超过该大小时写到输出流。 */
+    static const size_t FLUSH_BYTES = 64 * 1024;
+};